@@ -42,6 +42,7 @@ namespace DFR_UI
             this.frMaximum = new System.Windows.Forms.RadioButton();
             this.frBalanced = new System.Windows.Forms.RadioButton();
             this.frMinimum = new System.Windows.Forms.RadioButton();
+            this.frAutomatic = new System.Windows.Forms.RadioButton();
             this.frDebug = new System.Windows.Forms.RadioButton();
             this.invertYAxis = new System.Windows.Forms.CheckBox();
             this.forceFixed = new System.Windows.Forms.CheckBox();
@@ -120,6 +121,7 @@ namespace DFR_UI
             this.flowLayoutPanel2.Controls.Add(this.frMaximum);
             this.flowLayoutPanel2.Controls.Add(this.frBalanced);
             this.flowLayoutPanel2.Controls.Add(this.frMinimum);
+            this.flowLayoutPanel2.Controls.Add(this.frAutomatic);
             this.flowLayoutPanel2.Controls.Add(this.frDebug);
             this.flowLayoutPanel2.Controls.Add(this.invertYAxis);
             this.flowLayoutPanel2.Controls.Add(this.forceFixed);
@@ -196,16 +198,29 @@ namespace DFR_UI
             this.frMinimum.UseVisualStyleBackColor = true;
             this.frMinimum.CheckedChanged += new System.EventHandler(this.frMinimum_CheckedChanged);
             // 
+            // frAutomatic
+            // 
+            this.frAutomatic.Enabled = false;
+            this.frAutomatic.Location = new System.Drawing.Point(322, 25);
+            this.frAutomatic.Margin = new System.Windows.Forms.Padding(2);
+            this.frAutomatic.Name = "frAutomatic";
+            this.frAutomatic.Size = new System.Drawing.Size(74, 16);
+            this.frAutomatic.TabIndex = 5;
+            this.frAutomatic.TabStop = true;
+            this.frAutomatic.Text = "Automatic";
+            this.frAutomatic.UseVisualStyleBackColor = true;
+            this.frAutomatic.CheckedChanged += new System.EventHandler(this.frAutomatic_CheckedChanged);
+            // 
             // frDebug
             // 
             this.frDebug.AutoSize = true;
             this.frDebug.Enabled = false;
-            this.frDebug.Location = new System.Drawing.Point(322, 25);
+            this.frDebug.Location = new System.Drawing.Point(400, 25);
             this.frDebug.Margin = new System.Windows.Forms.Padding(2);
             this.frDebug.Name = "frDebug";
-            this.frDebug.Padding = new System.Windows.Forms.Padding(33, 0, 0, 0);
-            this.frDebug.Size = new System.Drawing.Size(120, 17);
-            this.frDebug.TabIndex = 5;
+            this.frDebug.Padding = new System.Windows.Forms.Padding(12, 0, 0, 0);
+            this.frDebug.Size = new System.Drawing.Size(99, 17);
+            this.frDebug.TabIndex = 6;
             this.frDebug.TabStop = true;
             this.frDebug.Text = "Debug Mode";
             this.frDebug.UseVisualStyleBackColor = true;
@@ -220,7 +235,7 @@ namespace DFR_UI
             this.invertYAxis.Margin = new System.Windows.Forms.Padding(10, 8, 3, 3);
             this.invertYAxis.Name = "invertYAxis";
             this.invertYAxis.Size = new System.Drawing.Size(317, 17);
-            this.invertYAxis.TabIndex = 6;
+            this.invertYAxis.TabIndex = 7;
             this.invertYAxis.Text = "Invert vertical axis (corrects eye tracking in some applications)";
             this.invertYAxis.UseVisualStyleBackColor = true;
             this.invertYAxis.CheckedChanged += new System.EventHandler(this.invertYAxis_CheckedChanged);
@@ -234,7 +249,7 @@ namespace DFR_UI
             this.forceFixed.Margin = new System.Windows.Forms.Padding(10, 8, 3, 3);
             this.forceFixed.Name = "forceFixed";
             this.forceFixed.Size = new System.Drawing.Size(202, 17);
-            this.forceFixed.TabIndex = 7;
+            this.forceFixed.TabIndex = 8;
             this.forceFixed.Text = "Ignore eye tracking (when supported)";
             this.forceFixed.UseVisualStyleBackColor = true;
             this.forceFixed.CheckedChanged += new System.EventHandler(this.forceFixed_CheckedChanged);
@@ -247,7 +262,7 @@ namespace DFR_UI
             this.frameTimeLabel.Margin = new System.Windows.Forms.Padding(10, 8, 3, 0);
             this.frameTimeLabel.Name = "frameTimeLabel";
             this.frameTimeLabel.Size = new System.Drawing.Size(0, 13);
-            this.frameTimeLabel.TabIndex = 8;
+            this.frameTimeLabel.TabIndex = 9;
             // 
             // timer1
             // 
@@ -287,6 +302,7 @@ namespace DFR_UI
         private System.Windows.Forms.RadioButton frMaximum;
         private System.Windows.Forms.RadioButton frBalanced;
         private System.Windows.Forms.RadioButton frMinimum;
+        private System.Windows.Forms.RadioButton frAutomatic;
         private System.Windows.Forms.RadioButton frDebug;
         private System.Windows.Forms.Label appLabel;
         private System.Windows.Forms.Button reattach;
@@ -27,6 +27,7 @@ namespace DFR_UI
         string PathToMagicAttach;
         uint AttachedApplication = 0;
         Microsoft.Win32.RegistryKey SettingsKey;
+        SharedSettings SharedSettings;
 
         private void MainForm_Load(object sender, EventArgs e)
         {
@@ -106,6 +107,7 @@ namespace DFR_UI
             }
 
             SettingsKey = Microsoft.Win32.Registry.CurrentUser.CreateSubKey("SOFTWARE\\FR-Utility");
+            SharedSettings = new SharedSettings();
             switch ((int)SettingsKey.GetValue("mode", 0))
             {
                 case 0:
@@ -123,15 +125,27 @@ namespace DFR_UI
                 case 4:
                     frDebug.Checked = true;
                     break;
+                case 5:
+                    frAutomatic.Checked = true;
+                    break;
             }
             invertYAxis.Checked = (int)SettingsKey.GetValue("invert_y_axis", 0) == 0 ? false : true;
             forceFixed.Checked = (int)SettingsKey.GetValue("ignore_eye_tracking", 0) == 0 ? false : true;
+            PublishSettings();
+        }
+
+        // The registry holds the settings across sessions, the shared memory delivers the changes to the running games.
+        void PublishSettings()
+        {
+            SharedSettings.Publish((uint)(int)SettingsKey.GetValue("mode", 0),
+                (int)SettingsKey.GetValue("ignore_eye_tracking", 0) != 0,
+                (int)SettingsKey.GetValue("invert_y_axis", 0) != 0);
         }
 
         void SetEnabled(bool enabled)
         {
             reattach.Enabled = labelMode.Enabled = frOff.Enabled = frMaximum.Enabled = frBalanced.Enabled =
-                frMinimum.Enabled = frDebug.Enabled = invertYAxis.Enabled = forceFixed.Enabled = enabled;
+                frMinimum.Enabled = frAutomatic.Enabled = frDebug.Enabled = invertYAxis.Enabled = forceFixed.Enabled = enabled;
             if (!enabled)
             {
                 frameTimeLabel.Text = "";
@@ -229,27 +243,58 @@ namespace DFR_UI
 
         private void frOff_CheckedChanged(object sender, EventArgs e)
         {
-            SettingsKey.SetValue("mode", 0);
+            // Also called for the button being unchecked, which must not publish a transient mode.
+            if (frOff.Checked)
+            {
+                SettingsKey.SetValue("mode", 0);
+                PublishSettings();
+            }
         }
 
         private void frMaximum_CheckedChanged(object sender, EventArgs e)
         {
-            SettingsKey.SetValue("mode", 1);
+            if (frMaximum.Checked)
+            {
+                SettingsKey.SetValue("mode", 1);
+                PublishSettings();
+            }
         }
 
         private void frBalanced_CheckedChanged(object sender, EventArgs e)
         {
-            SettingsKey.SetValue("mode", 2);
+            if (frBalanced.Checked)
+            {
+                SettingsKey.SetValue("mode", 2);
+                PublishSettings();
+            }
         }
 
         private void frMinimum_CheckedChanged(object sender, EventArgs e)
         {
-            SettingsKey.SetValue("mode", 3);
+            if (frMinimum.Checked)
+            {
+                SettingsKey.SetValue("mode", 3);
+                PublishSettings();
+            }
+        }
+
+        // The level from the profile of the title, as measured by the foveation benchmark, or balanced until then.
+        private void frAutomatic_CheckedChanged(object sender, EventArgs e)
+        {
+            if (frAutomatic.Checked)
+            {
+                SettingsKey.SetValue("mode", 5);
+                PublishSettings();
+            }
         }
 
         private void frDebug_CheckedChanged(object sender, EventArgs e)
         {
-            SettingsKey.SetValue("mode", 4);
+            if (frDebug.Checked)
+            {
+                SettingsKey.SetValue("mode", 4);
+                PublishSettings();
+            }
         }
 
         private void reattach_Click(object sender, EventArgs e)
@@ -260,11 +305,13 @@ namespace DFR_UI
         private void invertYAxis_CheckedChanged(object sender, EventArgs e)
         {
             SettingsKey.SetValue("invert_y_axis", invertYAxis.Checked ? 1 : 0);
+            PublishSettings();
         }
 
         private void forceFixed_CheckedChanged(object sender, EventArgs e)
         {
             SettingsKey.SetValue("ignore_eye_tracking", forceFixed.Checked ? 1 : 0);
+            PublishSettings();
         }
 
         // https://stackoverflow.com/questions/968935/compare-binary-files-in-c-sharp
@@ -0,0 +1,54 @@
+﻿using System;
+using System.IO.MemoryMappedFiles;
+using System.Threading;
+
+namespace DFR_UI
+{
+    // Publishes the settings to the processes with PvrEmu injected, so that they do not need to watch the registry.
+    // The layout must match SDK\PvrEmu\pvremu_settings_shm.h.
+    class SharedSettings : IDisposable
+    {
+        const string Name = "Local\\PvrEmuSettings";
+        const uint Magic = 0x53525650; // 'PVRS'
+        const uint Version = 1;
+        const int Size = 40;
+        const int GenerationOffset = 16;
+        const int ValuesOffset = 24;
+
+        MemoryMappedFile Mapping;
+        MemoryMappedViewAccessor View;
+
+        public SharedSettings()
+        {
+            Mapping = MemoryMappedFile.CreateOrOpen(Name, Size);
+            View = Mapping.CreateViewAccessor(0, Size);
+
+            // Readers ignore the block until the header is complete.
+            View.Write(0, 0u);
+            Thread.MemoryBarrier();
+            View.Write(4, Version);
+            View.Write(8, (uint)Size);
+            Thread.MemoryBarrier();
+            View.Write(0, Magic);
+        }
+
+        public void Publish(uint mode, bool ignoreEyeTracking, bool invertYAxis)
+        {
+            // The generation is odd while the values are being written.
+            var generation = View.ReadUInt64(GenerationOffset) | 1;
+            View.Write(GenerationOffset, generation);
+            Thread.MemoryBarrier();
+            View.Write(ValuesOffset, mode);
+            View.Write(ValuesOffset + 4, ignoreEyeTracking ? 1u : 0u);
+            View.Write(ValuesOffset + 8, invertYAxis ? 1u : 0u);
+            Thread.MemoryBarrier();
+            View.Write(GenerationOffset, generation + 1);
+        }
+
+        public void Dispose()
+        {
+            View.Dispose();
+            Mapping.Dispose();
+        }
+    }
+}
@@ -0,0 +1,100 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+// Plugin interface for eye trackers that are not built into PvrEmu.
+//
+// A plugin is a DLL placed in %LOCALAPPDATA%\PvrEmu\plugins. It exports a single function, named
+// PVREMU_EYE_TRACKER_PLUGIN_ENTRY, returning a description of the plugin. Plugins are probed along with the built-in
+// trackers (after them, but before the OSC fallback).
+//
+// All functions but create() and destroy() are called from the render thread of the game and must not block.
+
+// First, see the feature-test macro in it.
+#include "pvremu_clock.h"
+
+#include <stdint.h>
+
+#ifdef _WIN32
+#define PVREMU_PLUGIN_EXPORT __declspec(dllexport)
+#define PVREMU_PLUGIN_CALL __cdecl
+#else
+#define PVREMU_PLUGIN_EXPORT __attribute__((visibility("default")))
+#define PVREMU_PLUGIN_CALL
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Increase when making a change that older hosts or plugins cannot handle. Adding fields at the end of the structures
+// below is not such a change: check struct_size instead.
+#define PVREMU_EYE_TRACKER_PLUGIN_ABI_VERSION 1
+
+#define PVREMU_EYE_TRACKER_PLUGIN_ENTRY "pvremu_get_eye_tracker_plugin"
+
+typedef struct pvremu_gaze_sample {
+    // Set by the host to the size of the structure it knows.
+    uint32_t struct_size;
+
+    // Unit vector of the combined gaze, in head space (X right, Y up, -Z forward).
+    float gaze[3];
+
+    // From 0 (unusable) to 1.
+    float confidence;
+
+    // When the sample was captured, in nanoseconds on the monotonic clock of the system (see pvremu_now_ns()), or 0
+    // if unknown.
+    int64_t timestamp_ns;
+} pvremu_gaze_sample;
+
+typedef struct pvremu_eye_tracker_plugin {
+    // PVREMU_EYE_TRACKER_PLUGIN_ABI_VERSION and sizeof(pvremu_eye_tracker_plugin) of the plugin.
+    uint32_t abi_version;
+    uint32_t struct_size;
+
+    // Name shown in the log. Forcing the tracker (the "eye_tracker" setting) and the tracker cache use the file name
+    // instead, as "Plugin:<file name without extension>", since they must work without loading the plugin.
+    const char* name;
+
+    // Return NULL if the device is not present. May block for a short time (the host applies a timeout).
+    void*(PVREMU_PLUGIN_CALL* create)(void);
+
+    // Return non-zero on success.
+    int(PVREMU_PLUGIN_CALL* start)(void* instance);
+    void(PVREMU_PLUGIN_CALL* stop)(void* instance);
+
+    // Write the latest sample into the storage of the host. Return non-zero if the sample is valid.
+    int(PVREMU_PLUGIN_CALL* poll_sample)(void* instance, pvremu_gaze_sample* sample);
+
+    void(PVREMU_PLUGIN_CALL* destroy)(void* instance);
+} pvremu_eye_tracker_plugin;
+
+// The entry point receives the ABI version of the host, and returns NULL if it cannot work with it.
+typedef const pvremu_eye_tracker_plugin*(PVREMU_PLUGIN_CALL* pvremu_get_eye_tracker_plugin_fn)(
+    uint32_t host_abi_version);
+
+#ifdef __cplusplus
+}
+#endif
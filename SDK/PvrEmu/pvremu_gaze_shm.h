@@ -0,0 +1,220 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+// Shared memory layout for publishing gaze to PvrEmu, and a header-only producer.
+//
+// The producer creates a named shared memory region holding a header and a ring of slots. Each slot is protected by a
+// sequence number (seqlock): it is odd while the slot is being written, and 2 * (index + 1) once sample number `index`
+// is complete. The producer never waits for the readers, and readers never wait for the producer: they read the
+// newest slot, and simply retry with the previous one if it is being overwritten.
+//
+// Usage:
+//   pvremu::GazeProducer producer;
+//   if (producer.open()) {
+//       pvremu::GazeSample sample{};
+//       ...
+//       producer.publish(sample);
+//   }
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "pvremu_clock.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace pvremu {
+
+#ifdef _WIN32
+    constexpr const char* GazeSharedMemoryName = "Local\\PvrEmuGaze";
+#else
+    constexpr const char* GazeSharedMemoryName = "/pvremu_gaze";
+#endif
+
+    constexpr uint32_t GazeSharedMemoryMagic = 0x47525650; // 'PVRG'
+    constexpr uint32_t GazeSharedMemoryVersion = 1;
+    constexpr uint32_t GazeSlotCount = 16;
+
+    enum GazeSampleFlags : uint32_t {
+        GazeSampleFlags_LeftValid = 1 << 0,
+        GazeSampleFlags_RightValid = 1 << 1,
+    };
+
+    struct GazeSample {
+        // See pvremu_now_ns().
+        int64_t timestampNs;
+
+        // Unit vectors, in head space (X right, Y up, -Z forward). 0 is the left eye, 1 is the right eye.
+        float gaze[2][3];
+
+        // From 0 (closed) to 1 (open).
+        float openness[2];
+
+        // From 0 (unusable) to 1.
+        float confidence[2];
+
+        uint32_t flags;
+    };
+
+    struct GazeSlot {
+        std::atomic<uint64_t> sequence;
+        GazeSample sample;
+    };
+
+    struct GazeSharedMemory {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t slotCount;
+        uint32_t slotSize;
+
+        // Number of samples published so far.
+        std::atomic<uint64_t> writeIndex;
+
+        GazeSlot slots[GazeSlotCount];
+    };
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "The shared memory requires lock-free atomics");
+
+    // Wait-free read of the newest complete sample. Returns false if there is none yet.
+    inline bool readNewestGazeSample(const GazeSharedMemory& shm, GazeSample& sample, uint64_t* index = nullptr) {
+        const uint64_t writeIndex = shm.writeIndex.load(std::memory_order_acquire);
+
+        // If the newest slot is being overwritten (we were preempted for a whole turn of the ring), fall back to the
+        // previous one. This bounds the work regardless of the producer.
+        for (uint64_t i = writeIndex; i > 0 && i + 2 > writeIndex; i--) {
+            const GazeSlot& slot = shm.slots[(i - 1) % GazeSlotCount];
+            const uint64_t expected = 2 * i;
+            if (slot.sequence.load(std::memory_order_acquire) != expected) {
+                continue;
+            }
+            std::memcpy(&sample, &slot.sample, sizeof(sample));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) == expected) {
+                if (index) {
+                    *index = i;
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    class GazeProducer {
+      public:
+        GazeProducer() = default;
+        GazeProducer(const GazeProducer&) = delete;
+        GazeProducer& operator=(const GazeProducer&) = delete;
+
+        ~GazeProducer() {
+            close();
+        }
+
+        // The name only needs to be changed for private channels. PvrEmu reads from GazeSharedMemoryName.
+        bool open(const char* name = GazeSharedMemoryName) {
+            close();
+
+#ifdef _WIN32
+            m_mapping =
+                CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof(GazeSharedMemory), name);
+            if (!m_mapping) {
+                return false;
+            }
+            m_shm = static_cast<GazeSharedMemory*>(
+                MapViewOfFile(m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(GazeSharedMemory)));
+#else
+            const int fd = shm_open(name, O_CREAT | O_RDWR, 0600);
+            if (fd < 0) {
+                return false;
+            }
+            if (ftruncate(fd, sizeof(GazeSharedMemory)) == 0) {
+                void* view = mmap(nullptr, sizeof(GazeSharedMemory), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                m_shm = view != MAP_FAILED ? static_cast<GazeSharedMemory*>(view) : nullptr;
+            }
+            ::close(fd);
+#endif
+            if (!m_shm) {
+                close();
+                return false;
+            }
+
+            // Readers ignore the region until the header is complete.
+            m_shm->magic = 0;
+            std::atomic_thread_fence(std::memory_order_release);
+            m_shm->version = GazeSharedMemoryVersion;
+            m_shm->slotCount = GazeSlotCount;
+            m_shm->slotSize = sizeof(GazeSlot);
+            m_nextIndex = m_shm->writeIndex.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            m_shm->magic = GazeSharedMemoryMagic;
+            return true;
+        }
+
+        void close() {
+#ifdef _WIN32
+            if (m_shm) {
+                UnmapViewOfFile(m_shm);
+            }
+            if (m_mapping) {
+                CloseHandle(m_mapping);
+                m_mapping = nullptr;
+            }
+#else
+            if (m_shm) {
+                munmap(m_shm, sizeof(GazeSharedMemory));
+            }
+#endif
+            m_shm = nullptr;
+        }
+
+        // Only one thread may publish.
+        void publish(const GazeSample& sample) {
+            if (!m_shm) {
+                return;
+            }
+
+            const uint64_t index = ++m_nextIndex;
+            GazeSlot& slot = m_shm->slots[(index - 1) % GazeSlotCount];
+            slot.sequence.store(2 * index - 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            std::memcpy(&slot.sample, &sample, sizeof(sample));
+            slot.sequence.store(2 * index, std::memory_order_release);
+            m_shm->writeIndex.store(index, std::memory_order_release);
+        }
+
+      private:
+        GazeSharedMemory* m_shm{nullptr};
+        uint64_t m_nextIndex{0};
+#ifdef _WIN32
+        HANDLE m_mapping{nullptr};
+#endif
+    };
+
+} // namespace pvremu
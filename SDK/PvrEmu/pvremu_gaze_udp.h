@@ -0,0 +1,242 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+// Binary UDP protocol for publishing gaze to PvrEmu over the network, and a header-only sender.
+//
+// Each datagram carries exactly one sample, in a fixed-size little-endian packet (see GazePacketLayout below). Unlike
+// OSC, there is no string addressing or padding to parse. Senders may target a multicast group, so that a single
+// bridge feeds every process with PvrEmu injected on the machine (or on the network). On Windows, link with ws2_32.lib.
+//
+// Usage:
+//   pvremu::GazeUdpSender sender;
+//   if (sender.open(pvremu::GazeUdpDefaultMulticastGroup, pvremu::GazeUdpDefaultPort)) {
+//       pvremu::GazeSample sample{};
+//       ...
+//       sender.send(sample);
+//   }
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "pvremu_gaze_shm.h"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace pvremu {
+
+    constexpr uint32_t GazePacketMagic = 0x55525650; // 'PVRU'
+    constexpr uint16_t GazePacketVersion = 1;
+
+    constexpr uint16_t GazeUdpDefaultPort = 9100;
+
+    // Administratively scoped (RFC 2365), not routed beyond the local network.
+    constexpr const char* GazeUdpDefaultMulticastGroup = "239.255.80.86";
+
+    // Byte offsets of the fields in a packet. All values are little-endian, floats are IEEE 754 single precision.
+    enum GazePacketLayout : size_t {
+        GazePacketLayout_Magic = 0,       // uint32
+        GazePacketLayout_Version = 4,     // uint16
+        GazePacketLayout_Size = 6,        // uint16, GazePacketSize
+        GazePacketLayout_Sequence = 8,    // uint32, incremented for each packet, wraps around
+        GazePacketLayout_Flags = 12,      // uint32, GazeSampleFlags
+        GazePacketLayout_Timestamp = 16,  // int64, capture time, see pvremu_now_ns()
+        GazePacketLayout_Gaze = 24,       // float[2][3]
+        GazePacketLayout_Openness = 48,   // float[2]
+        GazePacketLayout_Confidence = 56, // float[2]
+        GazePacketSize = 64,
+    };
+
+    namespace detail {
+
+        inline void writeLittleEndian(uint8_t* data, uint64_t value, size_t size) {
+            for (size_t i = 0; i < size; i++) {
+                data[i] = (uint8_t)(value >> (8 * i));
+            }
+        }
+
+        inline uint64_t readLittleEndian(const uint8_t* data, size_t size) {
+            uint64_t value = 0;
+            for (size_t i = 0; i < size; i++) {
+                value |= (uint64_t)data[i] << (8 * i);
+            }
+            return value;
+        }
+
+        inline void writeFloats(uint8_t* data, const float* values, size_t count) {
+            for (size_t i = 0; i < count; i++) {
+                uint32_t bits;
+                std::memcpy(&bits, &values[i], sizeof(bits));
+                writeLittleEndian(data + 4 * i, bits, 4);
+            }
+        }
+
+        inline void readFloats(const uint8_t* data, float* values, size_t count) {
+            for (size_t i = 0; i < count; i++) {
+                const uint32_t bits = (uint32_t)readLittleEndian(data + 4 * i, 4);
+                std::memcpy(&values[i], &bits, sizeof(bits));
+            }
+        }
+
+    } // namespace detail
+
+    inline void encodeGazePacket(const GazeSample& sample, uint32_t sequence, uint8_t (&packet)[GazePacketSize]) {
+        detail::writeLittleEndian(packet + GazePacketLayout_Magic, GazePacketMagic, 4);
+        detail::writeLittleEndian(packet + GazePacketLayout_Version, GazePacketVersion, 2);
+        detail::writeLittleEndian(packet + GazePacketLayout_Size, GazePacketSize, 2);
+        detail::writeLittleEndian(packet + GazePacketLayout_Sequence, sequence, 4);
+        detail::writeLittleEndian(packet + GazePacketLayout_Flags, sample.flags, 4);
+        detail::writeLittleEndian(packet + GazePacketLayout_Timestamp, (uint64_t)sample.timestampNs, 8);
+        detail::writeFloats(packet + GazePacketLayout_Gaze, &sample.gaze[0][0], 6);
+        detail::writeFloats(packet + GazePacketLayout_Openness, sample.openness, 2);
+        detail::writeFloats(packet + GazePacketLayout_Confidence, sample.confidence, 2);
+    }
+
+    // Returns false if the datagram is not a packet of this version.
+    inline bool decodeGazePacket(const uint8_t* data, size_t size, GazeSample& sample, uint32_t& sequence) {
+        if (size != GazePacketSize ||
+            detail::readLittleEndian(data + GazePacketLayout_Magic, 4) != GazePacketMagic ||
+            detail::readLittleEndian(data + GazePacketLayout_Version, 2) != GazePacketVersion ||
+            detail::readLittleEndian(data + GazePacketLayout_Size, 2) != GazePacketSize) {
+            return false;
+        }
+
+        sequence = (uint32_t)detail::readLittleEndian(data + GazePacketLayout_Sequence, 4);
+        sample.flags = (uint32_t)detail::readLittleEndian(data + GazePacketLayout_Flags, 4);
+        sample.timestampNs = (int64_t)detail::readLittleEndian(data + GazePacketLayout_Timestamp, 8);
+        detail::readFloats(data + GazePacketLayout_Gaze, &sample.gaze[0][0], 6);
+        detail::readFloats(data + GazePacketLayout_Openness, sample.openness, 2);
+        detail::readFloats(data + GazePacketLayout_Confidence, sample.confidence, 2);
+        return true;
+    }
+
+    // Whether sequence number `a` comes after `b`, accounting for wrap-around.
+    inline bool isGazeSequenceNewer(uint32_t a, uint32_t b) {
+        return (int32_t)(a - b) > 0;
+    }
+
+    class GazeUdpSender {
+      public:
+        GazeUdpSender() = default;
+        GazeUdpSender(const GazeUdpSender&) = delete;
+        GazeUdpSender& operator=(const GazeUdpSender&) = delete;
+
+        ~GazeUdpSender() {
+            close();
+        }
+
+        // The address may be unicast (eg: "127.0.0.1") or a multicast group. The time-to-live only applies to multicast,
+        // 1 keeps the packets on the local network.
+        bool open(const char* address, uint16_t port, int multicastTtl = 1) {
+            close();
+
+#ifdef _WIN32
+            WSADATA wsaData;
+            if (WSAStartup(MAKEWORD(2, 2), &wsaData)) {
+                return false;
+            }
+            m_isWinsockStarted = true;
+#endif
+
+            m_destination = {};
+            m_destination.sin_family = AF_INET;
+            m_destination.sin_port = htons(port);
+            if (inet_pton(AF_INET, address, &m_destination.sin_addr) != 1) {
+                close();
+                return false;
+            }
+
+            m_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+            if (m_socket == InvalidSocket) {
+                close();
+                return false;
+            }
+
+            // Deliver to the listeners on this machine too.
+            const int ttl = multicastTtl;
+            const int loopback = 1;
+            setsockopt(m_socket, IPPROTO_IP, IP_MULTICAST_TTL, reinterpret_cast<const char*>(&ttl), sizeof(ttl));
+            setsockopt(
+                m_socket, IPPROTO_IP, IP_MULTICAST_LOOP, reinterpret_cast<const char*>(&loopback), sizeof(loopback));
+            return true;
+        }
+
+        void close() {
+            if (m_socket != InvalidSocket) {
+#ifdef _WIN32
+                closesocket(m_socket);
+#else
+                ::close(m_socket);
+#endif
+                m_socket = InvalidSocket;
+            }
+#ifdef _WIN32
+            if (m_isWinsockStarted) {
+                WSACleanup();
+                m_isWinsockStarted = false;
+            }
+#endif
+        }
+
+        // Only one thread may send. Fills in the sequence number.
+        bool send(const GazeSample& sample) {
+            if (m_socket == InvalidSocket) {
+                return false;
+            }
+
+            uint8_t packet[GazePacketSize];
+            encodeGazePacket(sample, m_nextSequence++, packet);
+            return sendto(m_socket,
+                          reinterpret_cast<const char*>(packet),
+                          (int)sizeof(packet),
+                          0,
+                          reinterpret_cast<const sockaddr*>(&m_destination),
+                          sizeof(m_destination)) == (int)sizeof(packet);
+        }
+
+      private:
+#ifdef _WIN32
+        using Socket = SOCKET;
+        static constexpr Socket InvalidSocket = INVALID_SOCKET;
+        bool m_isWinsockStarted{false};
+#else
+        using Socket = int;
+        static constexpr Socket InvalidSocket = -1;
+#endif
+
+        Socket m_socket{InvalidSocket};
+        sockaddr_in m_destination{};
+        uint32_t m_nextSequence{0};
+    };
+
+} // namespace pvremu
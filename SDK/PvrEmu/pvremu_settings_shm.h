@@ -0,0 +1,290 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+// Shared memory block through which the settings application (DFR-UI) publishes the settings to every process with
+// PvrEmu injected.
+//
+// The block holds a generation counter and the values, protected as a seqlock: the generation is odd while the values
+// are being written, and even otherwise. Readers check for changes with a single atomic load of the generation, and
+// only copy the values when it moved. Processes that cannot open the block fall back to the registry.
+//
+// Usage (publisher):
+//   pvremu::SettingsPublisher publisher;
+//   if (publisher.open()) {
+//       pvremu::SettingsValues values{};
+//       ...
+//       publisher.publish(values);
+//   }
+//
+// Usage (reader):
+//   pvremu::SettingsReader reader;
+//   if (reader.open()) {
+//       pvremu::SettingsValues values;
+//       if (reader.poll(values)) {
+//           // Apply the new values.
+//       }
+//   }
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace pvremu {
+
+#ifdef _WIN32
+    constexpr const char* SettingsSharedMemoryName = "Local\\PvrEmuSettings";
+#else
+    constexpr const char* SettingsSharedMemoryName = "/pvremu_settings";
+#endif
+
+    constexpr uint32_t SettingsSharedMemoryMagic = 0x53525650; // 'PVRS'
+    constexpr uint32_t SettingsSharedMemoryVersion = 1;
+
+    // Same meaning as the values under HKCU\SOFTWARE\FR-Utility.
+    struct SettingsValues {
+        // 0 is off, 1 to 3 are the foveation levels (from maximum to minimum), 4 is the debug mode, 5 is the automatic
+        // mode (the level from the profile of the title).
+        uint32_t mode;
+
+        // Use fixed foveation even if there is eye tracking.
+        uint32_t ignoreEyeTracking;
+
+        uint32_t invertYAxis;
+    };
+
+    // The layout is shared with DFR-UI (C#), see the offsets below.
+    struct SettingsSharedMemory {
+        uint32_t magic;
+        uint32_t version;
+
+        // sizeof(SettingsSharedMemory) for the publisher.
+        uint32_t size;
+        uint32_t reserved;
+
+        std::atomic<uint64_t> generation;
+
+        SettingsValues values;
+    };
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "The shared memory requires lock-free atomics");
+    static_assert(offsetof(SettingsSharedMemory, generation) == 16, "Layout is shared with DFR-UI");
+    static_assert(offsetof(SettingsSharedMemory, values) == 24, "Layout is shared with DFR-UI");
+
+    namespace detail {
+
+        // Map the block, either to publish (read-write, created if needed) or to read.
+        inline void* mapSettings(const char* name, bool isPublisher, void** handle) {
+#ifdef _WIN32
+            HANDLE mapping = isPublisher ? CreateFileMappingA(INVALID_HANDLE_VALUE,
+                                                              nullptr,
+                                                              PAGE_READWRITE,
+                                                              0,
+                                                              sizeof(SettingsSharedMemory),
+                                                              name)
+                                         : OpenFileMappingA(FILE_MAP_READ, FALSE, name);
+            if (!mapping) {
+                return nullptr;
+            }
+            void* view = MapViewOfFile(
+                mapping, isPublisher ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ, 0, 0, sizeof(SettingsSharedMemory));
+            if (!view) {
+                CloseHandle(mapping);
+                return nullptr;
+            }
+            *handle = mapping;
+            return view;
+#else
+            *handle = nullptr;
+            const int fd = shm_open(name, isPublisher ? O_CREAT | O_RDWR : O_RDONLY, 0600);
+            if (fd < 0) {
+                return nullptr;
+            }
+            void* view = nullptr;
+            if (!isPublisher || ftruncate(fd, sizeof(SettingsSharedMemory)) == 0) {
+                view = mmap(nullptr,
+                            sizeof(SettingsSharedMemory),
+                            isPublisher ? PROT_READ | PROT_WRITE : PROT_READ,
+                            MAP_SHARED,
+                            fd,
+                            0);
+            }
+            ::close(fd);
+            return view != MAP_FAILED ? view : nullptr;
+#endif
+        }
+
+        inline void unmapSettings(const void* view, void* handle) {
+#ifdef _WIN32
+            if (view) {
+                UnmapViewOfFile(view);
+            }
+            if (handle) {
+                CloseHandle(handle);
+            }
+#else
+            (void)handle;
+            if (view) {
+                munmap(const_cast<void*>(view), sizeof(SettingsSharedMemory));
+            }
+#endif
+        }
+
+    } // namespace detail
+
+    class SettingsPublisher {
+      public:
+        SettingsPublisher() = default;
+        SettingsPublisher(const SettingsPublisher&) = delete;
+        SettingsPublisher& operator=(const SettingsPublisher&) = delete;
+
+        ~SettingsPublisher() {
+            close();
+        }
+
+        // The name only needs to be changed for private channels. PvrEmu reads from SettingsSharedMemoryName.
+        bool open(const char* name = SettingsSharedMemoryName) {
+            close();
+
+            m_shm = static_cast<SettingsSharedMemory*>(detail::mapSettings(name, true, &m_handle));
+            if (!m_shm) {
+                return false;
+            }
+
+            // Readers ignore the block until the header is complete.
+            m_shm->magic = 0;
+            std::atomic_thread_fence(std::memory_order_release);
+            m_shm->version = SettingsSharedMemoryVersion;
+            m_shm->size = sizeof(SettingsSharedMemory);
+            std::atomic_thread_fence(std::memory_order_release);
+            m_shm->magic = SettingsSharedMemoryMagic;
+            return true;
+        }
+
+        void close() {
+            detail::unmapSettings(m_shm, m_handle);
+            m_shm = nullptr;
+            m_handle = nullptr;
+        }
+
+        // Only one thread (and one process) may publish.
+        void publish(const SettingsValues& values) {
+            if (!m_shm) {
+                return;
+            }
+
+            // Resume from the generation of a previous publisher, readers must see the counter move forward.
+            const uint64_t generation = m_shm->generation.load(std::memory_order_relaxed) | 1;
+            m_shm->generation.store(generation, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            std::memcpy(&m_shm->values, &values, sizeof(values));
+            m_shm->generation.store(generation + 1, std::memory_order_release);
+        }
+
+      private:
+        SettingsSharedMemory* m_shm{nullptr};
+        void* m_handle{nullptr};
+    };
+
+    class SettingsReader {
+      public:
+        SettingsReader() = default;
+        SettingsReader(const SettingsReader&) = delete;
+        SettingsReader& operator=(const SettingsReader&) = delete;
+
+        ~SettingsReader() {
+            close();
+        }
+
+        // Returns false if no publisher is running.
+        bool open(const char* name = SettingsSharedMemoryName) {
+            close();
+
+            m_shm = static_cast<const SettingsSharedMemory*>(detail::mapSettings(name, false, &m_handle));
+            if (!m_shm) {
+                return false;
+            }
+            if (m_shm->magic != SettingsSharedMemoryMagic || m_shm->version != SettingsSharedMemoryVersion ||
+                m_shm->size < sizeof(SettingsSharedMemory)) {
+                close();
+                return false;
+            }
+            return true;
+        }
+
+        void close() {
+            detail::unmapSettings(m_shm, m_handle);
+            m_shm = nullptr;
+            m_handle = nullptr;
+            m_lastGeneration = 0;
+        }
+
+        bool isOpen() const {
+            return m_shm;
+        }
+
+        // Returns true (and the values) when they were published since the last successful call. Wait-free. When called
+        // from several threads, more than one of them may see the same change.
+        bool poll(SettingsValues& values) {
+            if (!m_shm) {
+                return false;
+            }
+
+            const uint64_t generation = m_shm->generation.load(std::memory_order_acquire);
+            if (generation == m_lastGeneration.load(std::memory_order_relaxed) || (generation & 1)) {
+                // Unchanged, or being written (we will get it on the next call).
+                return false;
+            }
+
+            SettingsValues copy;
+            std::memcpy(&copy, &m_shm->values, sizeof(copy));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (m_shm->generation.load(std::memory_order_relaxed) != generation) {
+                return false;
+            }
+
+            values = copy;
+            m_lastGeneration.store(generation, std::memory_order_relaxed);
+            return true;
+        }
+
+      private:
+        const SettingsSharedMemory* m_shm{nullptr};
+        void* m_handle{nullptr};
+        std::atomic<uint64_t> m_lastGeneration{0};
+    };
+
+} // namespace pvremu
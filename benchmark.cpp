@@ -0,0 +1,179 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "log.h"
+using namespace openxr_api_layer::log;
+
+#include "benchmark.h"
+
+namespace openxr_api_layer {
+
+    namespace {
+
+        constexpr auto StartDelay = std::chrono::seconds(30);
+        constexpr auto WindowDuration = std::chrono::seconds(10);
+        constexpr uint32_t RoundCount = 3;
+
+        // The first frames of a window may still have been rendered with the previous mode.
+        constexpr auto SettleDuration = std::chrono::seconds(2);
+
+        // Off, minimum, balanced, maximum.
+        constexpr uint32_t BenchmarkModes[] = {0, 3, 2, 1};
+        constexpr uint32_t BenchmarkModeCount = (uint32_t)std::size(BenchmarkModes);
+
+        constexpr uint64_t MinFramesPerMode = 100;
+
+        // Below this saving (on the median GPU frame time), foveation is not worth its artifacts.
+        constexpr float MinUsefulSaving = 0.05f;
+
+        // The least aggressive mode that gets this fraction of the best saving is recommended.
+        constexpr float SufficientSavingRatio = 2.f / 3;
+
+        // The reduction of the median GPU frame time compared to foveation off.
+        float getSaving(const std::array<DurationHistogram, 4>& frameTimes, uint32_t mode) {
+            const float baselineMs = frameTimes[0].getPercentile(0.5f);
+            return baselineMs > 0 ? 1.f - frameTimes[mode].getPercentile(0.5f) / baselineMs : 0.f;
+        }
+
+    } // namespace
+
+    std::optional<uint32_t> recommendFoveationMode(const std::array<DurationHistogram, 4>& frameTimes) {
+        float bestSaving = 0.f;
+        for (const uint32_t mode : BenchmarkModes) {
+            if (frameTimes[mode].getCount() < MinFramesPerMode) {
+                return {};
+            }
+            bestSaving = std::max(bestSaving, getSaving(frameTimes, mode));
+        }
+
+        if (bestSaving < MinUsefulSaving) {
+            return 0;
+        }
+
+        // Modes go from the least aggressive to the most aggressive.
+        for (uint32_t i = 1; i < BenchmarkModeCount; i++) {
+            if (getSaving(frameTimes, BenchmarkModes[i]) >= bestSaving * SufficientSavingRatio) {
+                return BenchmarkModes[i];
+            }
+        }
+        return 0;
+    }
+
+    FoveationBenchmark::FoveationBenchmark(std::function<void(const BenchmarkResult&)> onCompleted)
+        : m_onCompleted(std::move(onCompleted)) {
+    }
+
+    void FoveationBenchmark::start() {
+        int64_t expected = 0;
+        const int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
+        if (m_startTime.compare_exchange_strong(expected, now)) {
+            Log(fmt::format("Foveation benchmark starting in {}s, for {}s\n",
+                            std::chrono::duration_cast<std::chrono::seconds>(StartDelay).count(),
+                            std::chrono::duration_cast<std::chrono::seconds>(WindowDuration).count() *
+                                BenchmarkModeCount * RoundCount));
+        }
+    }
+
+    std::optional<uint32_t> FoveationBenchmark::getMode() const {
+        const auto window = getWindow(std::chrono::steady_clock::now());
+        if (!window) {
+            return {};
+        }
+        return window->mode;
+    }
+
+    std::optional<FoveationBenchmark::Window>
+    FoveationBenchmark::getWindow(std::chrono::steady_clock::time_point time) const {
+        const int64_t startTime = m_startTime.load(std::memory_order_relaxed);
+        if (!startTime) {
+            return {};
+        }
+
+        const auto elapsed =
+            time - std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(startTime)) - StartDelay;
+        if (elapsed.count() < 0) {
+            return {};
+        }
+        const uint64_t windowIndex = elapsed / WindowDuration;
+        if (windowIndex >= BenchmarkModeCount * RoundCount) {
+            return {};
+        }
+
+        Window window;
+        window.mode = BenchmarkModes[windowIndex % BenchmarkModeCount];
+        window.isSettled = elapsed % WindowDuration >= SettleDuration;
+        return window;
+    }
+
+    void FoveationBenchmark::recordGpuFrame(float gpuMs) {
+        if (m_isCompleted || !m_startTime.load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        const auto window = getWindow(now);
+        if (window) {
+            if (window->isSettled) {
+                m_result.frameTimes[window->mode].add(gpuMs);
+            }
+        } else if (getWindow(now - WindowDuration)) {
+            // We just went past the last window.
+            complete();
+        }
+    }
+
+    void FoveationBenchmark::complete() {
+        m_isCompleted = true;
+        m_result.recommendedMode = recommendFoveationMode(m_result.frameTimes);
+
+        const float baselineMs = m_result.frameTimes[0].getPercentile(0.5f);
+        Log("Foveation benchmark completed:\n");
+        for (const uint32_t mode : BenchmarkModes) {
+            const DurationHistogram& frameTimes = m_result.frameTimes[mode];
+            Log(fmt::format("  {}: {} frames, p50 {:.2f}ms, p90 {:.2f}ms{}\n",
+                            getFoveationModeName(mode),
+                            frameTimes.getCount(),
+                            frameTimes.getPercentile(0.5f),
+                            frameTimes.getPercentile(0.9f),
+                            mode ? fmt::format(", {:+.1f}% vs off", -getSaving(m_result.frameTimes, mode) * 100.f)
+                                 : ""));
+        }
+        if (m_result.recommendedMode) {
+            Log(fmt::format("  Recommended: {}\n", getFoveationModeName(m_result.recommendedMode.value())));
+        } else {
+            Log("  Not enough frames to recommend a mode\n");
+        }
+
+        TraceLoggingWrite(g_traceProvider,
+                          "FoveationBenchmark",
+                          TLArg(baselineMs, "OffMs"),
+                          TLArg(m_result.frameTimes[3].getPercentile(0.5f), "MinimumMs"),
+                          TLArg(m_result.frameTimes[2].getPercentile(0.5f), "BalancedMs"),
+                          TLArg(m_result.frameTimes[1].getPercentile(0.5f), "MaximumMs"),
+                          TLArg((int)m_result.recommendedMode.value_or(-1), "RecommendedMode"));
+
+        m_onCompleted(m_result);
+    }
+
+} // namespace openxr_api_layer
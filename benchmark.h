@@ -0,0 +1,76 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "session_report.h"
+
+namespace openxr_api_layer {
+
+    struct BenchmarkResult {
+        // GPU frame times measured with each foveation mode (off, maximum, balanced, minimum).
+        std::array<DurationHistogram, 4> frameTimes;
+
+        // The mode to use for the title (0 if foveation does not help), or nothing when there was not enough data to
+        // tell.
+        std::optional<uint32_t> recommendedMode;
+    };
+
+    // The least aggressive mode that gets at least 2/3 of the best saving on the median GPU frame time. Off when no mode
+    // saves 5%, and nothing when a mode has less than 100 frames.
+    std::optional<uint32_t> recommendFoveationMode(const std::array<DurationHistogram, 4>& frameTimes);
+
+    // Cycles the foveation mode through off, minimum, balanced and maximum in fixed windows during gameplay, and
+    // measures the GPU frame times with each of them. The modes are interleaved over several rounds, so that each mode
+    // sees a similar mix of scenes.
+    class FoveationBenchmark {
+      public:
+        FoveationBenchmark(std::function<void(const BenchmarkResult&)> onCompleted);
+
+        // Start the clock. The first windows begin after a delay, to skip the loading screens.
+        void start();
+
+        // The mode to use instead of the one from the settings, while the benchmark is running.
+        std::optional<uint32_t> getMode() const;
+
+        // Called with each GPU frame time, shortly after the frame was rendered.
+        void recordGpuFrame(float gpuMs);
+
+      private:
+        struct Window {
+            uint32_t mode;
+            bool isSettled;
+        };
+        std::optional<Window> getWindow(std::chrono::steady_clock::time_point time) const;
+        void complete();
+
+        const std::function<void(const BenchmarkResult&)> m_onCompleted;
+
+        // In steady_clock ticks, 0 until started.
+        std::atomic<int64_t> m_startTime{0};
+
+        // Only accessed by the thread recording the frames.
+        BenchmarkResult m_result;
+        bool m_isCompleted{false};
+    };
+
+} // namespace openxr_api_layer
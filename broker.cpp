@@ -0,0 +1,251 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "pch.h"
+
+#include "log.h"
+using namespace openxr_api_layer::log;
+
+#include <trackers.h>
+#include <pvremu_gaze_shm.h>
+
+#include "broker.h"
+#include "eye_tracker.h"
+#include "shared_memory.h"
+
+namespace openxr_api_layer {
+
+    namespace {
+
+        // Held by the broker process for as long as it publishes. Windows releases it if the process dies.
+        constexpr const char* BrokerMutexName = "Local\\PvrEmuGazeBrokerOwner";
+
+        // Not the name used by in-house producers, since the broker may itself be reading from one of them.
+        constexpr const char* BrokerSharedMemoryName = "Local\\PvrEmuGazeBroker";
+
+        // Trackers update at up to a few hundred Hz.
+        constexpr auto PollPeriod = std::chrono::milliseconds(2);
+
+        // Samples older than this mean that the tracker stopped.
+        constexpr auto MaxSampleAge = std::chrono::milliseconds(500);
+
+        // An unchanged gaze is still republished this often, so that the readers do not see it expire.
+        constexpr auto RepublishPeriod = std::chrono::milliseconds(100);
+
+        // How long a reader waits for a broker that just started to create the shared memory.
+        constexpr auto ReaderOpenTimeout = std::chrono::seconds(1);
+
+        class BrokerEyeTracker : public LocalEyeTracker {
+          public:
+            BrokerEyeTracker(wil::unique_handle mutex) : m_mutex(std::move(mutex)) {
+                // A mutex is owned by a thread, so the publisher thread is the one to acquire and release it.
+                std::promise<bool> ownership;
+                std::future<bool> isOwner = ownership.get_future();
+                m_publisherThread = std::thread(
+                    [this, ownership = std::move(ownership)]() mutable { publisherThread(std::move(ownership)); });
+                m_isOwner = isOwner.get();
+            }
+
+            ~BrokerEyeTracker() override {
+                m_stopPublisher = true;
+                m_publisherThread.join();
+            }
+
+            bool isOwner() const {
+                return m_isOwner;
+            }
+
+            void setTracker(std::unique_ptr<IEyeTracker> tracker, const std::string& name) {
+                m_trackerName = name;
+                std::atomic_store(&m_tracker, std::shared_ptr<IEyeTracker>(std::move(tracker)));
+            }
+
+            void start(XrSession session) override {
+                if (const auto tracker = std::atomic_load(&m_tracker)) {
+                    tracker->start(session);
+                }
+            }
+
+            void stop() override {
+                if (const auto tracker = std::atomic_load(&m_tracker)) {
+                    tracker->stop();
+                }
+            }
+
+            std::string getName() const override {
+                return fmt::format("Gaze broker ({})", m_trackerName);
+            }
+
+            // The tracker is only queried by the publisher thread, we return what it published last.
+            bool getGazeSample(EyeGazeSample& sample) override {
+                std::unique_lock lock(m_latestMutex);
+                if (!m_hasLatest || std::chrono::steady_clock::now() - m_latest.time >= MaxSampleAge) {
+                    return false;
+                }
+                sample = m_latest;
+                return true;
+            }
+
+          private:
+            void publisherThread(std::promise<bool> ownership) {
+                TraceLocalActivity(local);
+
+                const DWORD wait = WaitForSingleObject(m_mutex.get(), 0);
+                bool isOwner = wait == WAIT_OBJECT_0 || wait == WAIT_ABANDONED;
+                if (isOwner && !m_producer.open(BrokerSharedMemoryName)) {
+                    Log("Failed to create the gaze broker shared memory\n");
+                    ReleaseMutex(m_mutex.get());
+                    isOwner = false;
+                }
+                ownership.set_value(isOwner);
+                if (!isOwner) {
+                    return;
+                }
+
+                TraceLoggingWriteStart(local, "GazeBroker_Publisher");
+
+                // The default timer resolution is too coarse for our poll period.
+                wil::unique_handle timer(CreateWaitableTimerExW(
+                    nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS));
+
+                uint64_t publishedCount = 0;
+                EyeGazeSample previous;
+                while (!m_stopPublisher) {
+                    LARGE_INTEGER dueTime;
+                    dueTime.QuadPart = -std::chrono::duration_cast<std::chrono::nanoseconds>(PollPeriod).count() / 100;
+                    if (timer && SetWaitableTimer(timer.get(), &dueTime, 0, nullptr, nullptr, FALSE)) {
+                        WaitForSingleObject(timer.get(), INFINITE);
+                    } else {
+                        std::this_thread::sleep_for(PollPeriod);
+                    }
+
+                    const auto tracker = std::atomic_load(&m_tracker);
+                    EyeGazeSample sample;
+                    if (!tracker || !openxr_api_layer::getGazeSample(*tracker, sample)) {
+                        continue;
+                    }
+
+                    // Most trackers update slower than we poll, only publish new data. Many of them stamp the sample
+                    // with the time of the query rather than of the capture, so only the gaze tells new data apart.
+                    if (sample.gaze.x == previous.gaze.x && sample.gaze.y == previous.gaze.y &&
+                        sample.gaze.z == previous.gaze.z && sample.time - previous.time < RepublishPeriod) {
+                        continue;
+                    }
+                    previous = sample;
+
+                    pvremu::GazeSample shmSample{};
+                    shmSample.timestampNs =
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(sample.time.time_since_epoch()).count();
+                    for (uint32_t eye = 0; eye < 2; eye++) {
+                        shmSample.gaze[eye][0] = sample.gaze.x;
+                        shmSample.gaze[eye][1] = sample.gaze.y;
+                        shmSample.gaze[eye][2] = sample.gaze.z;
+                        shmSample.openness[eye] = 1.f;
+                        shmSample.confidence[eye] = sample.confidence;
+                    }
+                    shmSample.flags = pvremu::GazeSampleFlags_LeftValid | pvremu::GazeSampleFlags_RightValid;
+                    m_producer.publish(shmSample);
+                    publishedCount++;
+
+                    std::unique_lock lock(m_latestMutex);
+                    m_latest = sample;
+                    m_hasLatest = true;
+                }
+
+                m_producer.close();
+                ReleaseMutex(m_mutex.get());
+
+                TraceLoggingWriteStop(local, "GazeBroker_Publisher", TLArg(publishedCount, "PublishedCount"));
+            }
+
+            const wil::unique_handle m_mutex;
+            bool m_isOwner{false};
+
+            std::string m_trackerName;
+            std::shared_ptr<IEyeTracker> m_tracker;
+
+            // Only accessed by the publisher thread.
+            pvremu::GazeProducer m_producer;
+
+            std::mutex m_latestMutex;
+            EyeGazeSample m_latest;
+            bool m_hasLatest{false};
+
+            std::thread m_publisherThread;
+            std::atomic<bool> m_stopPublisher{false};
+        };
+
+    } // namespace
+
+    ProbeResult selectBrokeredEyeTracker(const std::function<ProbeResult()>& selectEyeTracker) {
+        TraceLocalActivity(local);
+
+        TraceLoggingWriteStart(local, "SelectBrokeredEyeTracker");
+
+        ProbeResult result;
+        wil::unique_handle mutex(CreateMutexA(nullptr, FALSE, BrokerMutexName));
+        if (!mutex) {
+            Log("Failed to create the gaze broker mutex: %d\n", GetLastError());
+            result = selectEyeTracker();
+            TraceLoggingWriteStop(local, "SelectBrokeredEyeTracker", TLArg("Standalone", "Role"));
+            return result;
+        }
+
+        auto broker = std::make_unique<BrokerEyeTracker>(std::move(mutex));
+        if (broker->isOwner()) {
+            Log("Acting as the gaze broker\n");
+            ProbeResult selected = selectEyeTracker();
+            if (selected.tracker) {
+                broker->setTracker(std::move(selected.tracker), selected.name);
+                result.name = selected.name;
+                result.tracker = std::move(broker);
+            }
+            // Otherwise, let another process try its luck.
+
+            TraceLoggingWriteStop(local,
+                                  "SelectBrokeredEyeTracker",
+                                  TLArg("Broker", "Role"),
+                                  TLArg(result.name.c_str(), "Tracker"));
+            return result;
+        }
+        broker.reset();
+
+        // The broker may still be creating the shared memory.
+        const auto deadline = std::chrono::steady_clock::now() + ReaderOpenTimeout;
+        while (!(result.tracker = createNamedSharedMemoryEyeTracker(BrokerSharedMemoryName, "Gaze broker reader")) &&
+               std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        if (result.tracker) {
+            Log("Reading gaze from the broker\n");
+            result.name = "Gaze broker reader";
+        } else {
+            Log("The gaze broker is not publishing\n");
+        }
+
+        TraceLoggingWriteStop(
+            local, "SelectBrokeredEyeTracker", TLArg("Reader", "Role"), TLArg(!!result.tracker, "Found"));
+        return result;
+    }
+
+} // namespace openxr_api_layer
@@ -0,0 +1,466 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "pch.h"
+
+#include "log.h"
+using namespace openxr_api_layer::log;
+
+#include <trackers.h>
+
+#include "comparison.h"
+
+namespace openxr_api_layer {
+
+    namespace {
+
+        // Keep at most 30 minutes of data at 90Hz.
+        constexpr size_t MaxRecords = 30 * 60 * 90;
+
+        // Resolution of the cross-correlation, and the range of latencies we search.
+        constexpr double CorrelationStep = 0.002;
+        constexpr int MaxLagSteps = 100;
+
+        // Do not interpolate over gaps longer than this (eg: blinks).
+        constexpr double MaxInterpolationGap = 0.05;
+
+        // The latency is estimated at the end of the session on the most recent part of the capture only, to bound the
+        // cost of the cross-correlation (about 0.15s for 5 minutes).
+        constexpr double SessionLatencyWindow = 300.0;
+
+        // Minimum overlap (in steps) and correlation for the latency estimate to be trusted.
+        constexpr size_t MinCorrelationOverlap = 500;
+        constexpr double MinCorrelation = 0.5;
+
+        double angleDegrees(const XrVector3f& a, const XrVector3f& b) {
+            const double dot = std::clamp((double)a.x * b.x + (double)a.y * b.y + (double)a.z * b.z, -1.0, 1.0);
+            return std::acos(dot) * 180.0 / M_PI;
+        }
+
+        // Gaze angles sampled at a fixed rate, for the cross-correlation.
+        struct ResampledTrace {
+            std::vector<double> yaw;
+            std::vector<double> pitch;
+            std::vector<bool> isValid;
+        };
+
+        ResampledTrace resample(const std::vector<GazeComparisonRecord>& records, size_t trace, size_t count) {
+            ResampledTrace result;
+            result.yaw.resize(count);
+            result.pitch.resize(count);
+            result.isValid.resize(count);
+
+            const double start = records.front().time;
+            size_t next = 1;
+            for (size_t i = 0; i < count; i++) {
+                const double t = start + i * CorrelationStep;
+                while (next < records.size() - 1 && records[next].time <= t) {
+                    next++;
+                }
+                const auto& a = records[next - 1];
+                const auto& b = records[next];
+                if (!a.isValid[trace] || !b.isValid[trace] || b.time - a.time > MaxInterpolationGap ||
+                    b.time <= a.time) {
+                    continue;
+                }
+
+                const double alpha = std::clamp((t - a.time) / (b.time - a.time), 0.0, 1.0);
+                const auto angles = [](const XrVector3f& v, double& yaw, double& pitch) {
+                    yaw = std::atan2(v.x, -v.z) * 180.0 / M_PI;
+                    pitch = std::atan2(v.y, std::sqrt(v.x * v.x + v.z * v.z)) * 180.0 / M_PI;
+                };
+                double yawA, pitchA, yawB, pitchB;
+                angles(a.gaze[trace], yawA, pitchA);
+                angles(b.gaze[trace], yawB, pitchB);
+                result.yaw[i] = yawA + (yawB - yawA) * alpha;
+                result.pitch[i] = pitchA + (pitchB - pitchA) * alpha;
+                result.isValid[i] = true;
+            }
+
+            return result;
+        }
+
+        // Pearson correlation of both angles between a[i] and b[i + lag].
+        double correlate(const ResampledTrace& a, const ResampledTrace& b, int lag, size_t& overlap) {
+            double n = 0;
+            double sum[2][2]{}, sumSquares[2][2]{}, sumProducts[2]{};
+            const size_t count = a.yaw.size();
+            for (size_t i = std::max(0, -lag); i < count && i + lag < count; i++) {
+                const size_t j = i + lag;
+                if (!a.isValid[i] || !b.isValid[j]) {
+                    continue;
+                }
+
+                const double values[2][2] = {{a.yaw[i], a.pitch[i]}, {b.yaw[j], b.pitch[j]}};
+                for (size_t axis = 0; axis < 2; axis++) {
+                    for (size_t trace = 0; trace < 2; trace++) {
+                        sum[trace][axis] += values[trace][axis];
+                        sumSquares[trace][axis] += values[trace][axis] * values[trace][axis];
+                    }
+                    sumProducts[axis] += values[0][axis] * values[1][axis];
+                }
+                n++;
+            }
+
+            overlap = (size_t)n;
+            if (n < 2) {
+                return 0;
+            }
+
+            double covariance = 0, variance[2]{};
+            for (size_t axis = 0; axis < 2; axis++) {
+                covariance += sumProducts[axis] - sum[0][axis] * sum[1][axis] / n;
+                for (size_t trace = 0; trace < 2; trace++) {
+                    variance[trace] += sumSquares[trace][axis] - sum[trace][axis] * sum[trace][axis] / n;
+                }
+            }
+            if (variance[0] <= 0 || variance[1] <= 0) {
+                return 0;
+            }
+            return covariance / std::sqrt(variance[0] * variance[1]);
+        }
+
+    } // namespace
+
+    GazeComparisonReport analyzeGazeComparison(const std::vector<GazeComparisonRecord>& records) {
+        GazeComparisonReport report;
+        report.recordCount = records.size();
+        if (records.size() < 2) {
+            return report;
+        }
+        report.duration = records.back().time - records.front().time;
+
+        std::vector<double> divergences;
+        size_t validCount[2]{};
+        for (const auto& record : records) {
+            for (size_t trace = 0; trace < 2; trace++) {
+                validCount[trace] += record.isValid[trace] ? 1 : 0;
+            }
+            if (record.isValid[0] && record.isValid[1]) {
+                divergences.push_back(angleDegrees(record.gaze[0], record.gaze[1]));
+            }
+        }
+        for (size_t trace = 0; trace < 2; trace++) {
+            report.validity[trace] = (double)validCount[trace] / records.size();
+        }
+        report.bothValid = (double)divergences.size() / records.size();
+
+        if (!divergences.empty()) {
+            std::sort(divergences.begin(), divergences.end());
+            double total = 0;
+            for (const double divergence : divergences) {
+                total += divergence;
+            }
+            report.meanDivergence = total / divergences.size();
+            report.medianDivergence = divergences[divergences.size() / 2];
+            report.p95Divergence = divergences[std::min(divergences.size() - 1, divergences.size() * 95 / 100)];
+            report.maxDivergence = divergences.back();
+        }
+
+        return report;
+    }
+
+    void estimateGazeLatency(const std::vector<GazeComparisonRecord>& records, GazeComparisonReport& report) {
+        report.latencyMs.reset();
+        report.correlation = 0;
+        if (records.size() < 2) {
+            return;
+        }
+
+        const size_t steps = (size_t)((records.back().time - records.front().time) / CorrelationStep) + 1;
+        const ResampledTrace traces[2] = {resample(records, 0, steps), resample(records, 1, steps)};
+        std::vector<double> correlations(2 * MaxLagSteps + 1);
+        std::optional<int> bestLag;
+        for (int lag = -MaxLagSteps; lag <= MaxLagSteps; lag++) {
+            size_t overlap;
+            correlations[lag + MaxLagSteps] = correlate(traces[0], traces[1], lag, overlap);
+            if (overlap >= MinCorrelationOverlap &&
+                (!bestLag || correlations[lag + MaxLagSteps] > correlations[bestLag.value() + MaxLagSteps])) {
+                bestLag = lag;
+            }
+        }
+
+        if (bestLag) {
+            const int index = bestLag.value() + MaxLagSteps;
+            const double correlation = correlations[index];
+            report.correlation = correlation;
+            if (correlation >= MinCorrelation) {
+                // Refine between the steps with a parabola through the peak and its neighbors.
+                double offset = 0;
+                if (index > 0 && index < (int)correlations.size() - 1) {
+                    const double left = correlations[index - 1];
+                    const double right = correlations[index + 1];
+                    const double denominator = left - 2 * correlation + right;
+                    if (denominator < 0) {
+                        offset = std::clamp(0.5 * (left - right) / denominator, -0.5, 0.5);
+                    }
+                }
+                report.latencyMs = (bestLag.value() + offset) * CorrelationStep * 1000;
+            }
+        }
+    }
+
+    std::string formatGazeComparisonReport(const GazeComparisonReport& report) {
+        std::string result;
+        result += fmt::format("A: {}\nB: {}\n", report.names[0], report.names[1]);
+        result += fmt::format("Samples: {} over {:.1f}s\n", report.recordCount, report.duration);
+        result += fmt::format("Validity: A {:.1f}%, B {:.1f}%, both {:.1f}%\n",
+                              report.validity[0] * 100,
+                              report.validity[1] * 100,
+                              report.bothValid * 100);
+        result += fmt::format("Divergence (deg): mean {:.2f}, median {:.2f}, p95 {:.2f}, max {:.2f}\n",
+                              report.meanDivergence,
+                              report.medianDivergence,
+                              report.p95Divergence,
+                              report.maxDivergence);
+        if (report.latencyMs) {
+            result += fmt::format("Latency of B relative to A: {:.1f}ms (correlation {:.2f})\n",
+                                  report.latencyMs.value(),
+                                  report.correlation.value_or(0));
+        } else if (report.correlation) {
+            result += fmt::format("Latency of B relative to A: unknown (correlation {:.2f})\n",
+                                  report.correlation.value());
+        } else {
+            result += "Latency of B relative to A: not estimated\n";
+        }
+        return result;
+    }
+
+    bool writeGazeCapture(const std::filesystem::path& path,
+                          const std::string (&names)[2],
+                          const std::vector<GazeComparisonRecord>& records) {
+        std::ofstream file(path, std::ios_base::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+
+        file << "# A: " << names[0] << "\n# B: " << names[1] << "\n";
+        file << "time,a_valid,a_x,a_y,a_z,b_valid,b_x,b_y,b_z\n";
+        for (const auto& record : records) {
+            file << fmt::format("{:.6f},{},{:.6f},{:.6f},{:.6f},{},{:.6f},{:.6f},{:.6f}\n",
+                                record.time,
+                                record.isValid[0] ? 1 : 0,
+                                record.gaze[0].x,
+                                record.gaze[0].y,
+                                record.gaze[0].z,
+                                record.isValid[1] ? 1 : 0,
+                                record.gaze[1].x,
+                                record.gaze[1].y,
+                                record.gaze[1].z);
+        }
+        return !file.fail();
+    }
+
+    bool readGazeCapture(const std::filesystem::path& path,
+                         std::string (&names)[2],
+                         std::vector<GazeComparisonRecord>& records) {
+        std::ifstream file(path);
+        if (!file.is_open()) {
+            return false;
+        }
+
+        records.clear();
+        std::string line;
+        while (std::getline(file, line)) {
+            if (line.rfind("# A: ", 0) == 0) {
+                names[0] = line.substr(5);
+            } else if (line.rfind("# B: ", 0) == 0) {
+                names[1] = line.substr(5);
+            } else if (!line.empty() && line[0] != '#') {
+                GazeComparisonRecord record;
+                int isValid[2]{};
+                if (sscanf(line.c_str(),
+                           "%lf,%d,%f,%f,%f,%d,%f,%f,%f",
+                           &record.time,
+                           &isValid[0],
+                           &record.gaze[0].x,
+                           &record.gaze[0].y,
+                           &record.gaze[0].z,
+                           &isValid[1],
+                           &record.gaze[1].x,
+                           &record.gaze[1].y,
+                           &record.gaze[1].z) == 9) {
+                    record.isValid[0] = isValid[0];
+                    record.isValid[1] = isValid[1];
+                    records.push_back(record);
+                }
+            }
+        }
+        return !records.empty();
+    }
+
+    ComparisonEyeTracker::ComparisonEyeTracker(ProbeResult first,
+                                               ProbeResult second,
+                                               const std::filesystem::path& reportPath,
+                                               std::optional<std::filesystem::path> capturePath)
+        : m_reportPath(reportPath), m_capturePath(std::move(capturePath)) {
+        m_trackers[0] = std::move(first.tracker);
+        m_trackers[1] = std::move(second.tracker);
+        m_names[0] = std::move(first.name);
+        m_names[1] = std::move(second.name);
+        m_startTime = std::chrono::steady_clock::now();
+        m_records.reserve(MaxRecords);
+    }
+
+    ComparisonEyeTracker::~ComparisonEyeTracker() {
+        TraceLocalActivity(local);
+
+        TraceLoggingWriteStart(local, "ComparisonEyeTracker_Report", TLArg(m_records.size(), "Count"));
+
+        GazeComparisonReport report = analyzeGazeComparison(m_records);
+        if (!m_records.empty()) {
+            const double windowStart = m_records.back().time - SessionLatencyWindow;
+            const auto first = std::lower_bound(
+                m_records.cbegin(),
+                m_records.cend(),
+                windowStart,
+                [](const GazeComparisonRecord& record, double time) { return record.time < time; });
+            estimateGazeLatency(std::vector<GazeComparisonRecord>(first, m_records.cend()), report);
+        }
+        report.names[0] = m_names[0];
+        report.names[1] = m_names[1];
+        const std::string text = formatGazeComparisonReport(report);
+        Log(fmt::format("Eye tracker comparison:\n{}", text));
+
+        std::ofstream file(m_reportPath, std::ios_base::trunc);
+        if (file.is_open()) {
+            file << text;
+            Log(fmt::format("Comparison report written to {}\n", m_reportPath.string()));
+        }
+
+        if (m_capturePath) {
+            if (writeGazeCapture(m_capturePath.value(), m_names, m_records)) {
+                Log(fmt::format("Comparison capture written to {}\n", m_capturePath.value().string()));
+            } else {
+                Log(fmt::format("Failed to write {}\n", m_capturePath.value().string()));
+            }
+        }
+
+        TraceLoggingWriteStop(local, "ComparisonEyeTracker_Report", TLArg(report.meanDivergence, "MeanDivergence"));
+    }
+
+    void ComparisonEyeTracker::start(XrSession session) {
+        for (auto& tracker : m_trackers) {
+            tracker->start(session);
+        }
+    }
+
+    void ComparisonEyeTracker::stop() {
+        for (auto& tracker : m_trackers) {
+            tracker->stop();
+        }
+    }
+
+    std::string ComparisonEyeTracker::getName() const {
+        return fmt::format("Comparison ({} vs {})", m_names[0], m_names[1]);
+    }
+
+    bool ComparisonEyeTracker::getGazeSample(EyeGazeSample& sample) {
+        const auto now = std::chrono::steady_clock::now();
+
+        EyeGazeSample samples[2];
+        GazeComparisonRecord record;
+        record.time = std::chrono::duration<double>(now - m_startTime).count();
+        for (size_t i = 0; i < 2; i++) {
+            record.isValid[i] = openxr_api_layer::getGazeSample(*m_trackers[i], samples[i]);
+            record.gaze[i] = samples[i].gaze;
+        }
+        if (m_records.size() < MaxRecords) {
+            m_records.push_back(record);
+        }
+
+        // The first tracker drives foveation.
+        sample = samples[0];
+        return record.isValid[0];
+    }
+
+    ReplayEyeTracker::ReplayEyeTracker(const std::filesystem::path& path, size_t trace) : m_trace(trace) {
+        std::string names[2];
+        readGazeCapture(path, names, m_records);
+        m_name = fmt::format("Replay of {} ({})", names[trace], path.filename().string());
+        m_startTime = std::chrono::steady_clock::now();
+    }
+
+    void ReplayEyeTracker::start(XrSession session) {
+        m_startTime = std::chrono::steady_clock::now();
+    }
+
+    void ReplayEyeTracker::stop() {
+    }
+
+    std::string ReplayEyeTracker::getName() const {
+        return m_name;
+    }
+
+    bool ReplayEyeTracker::getGazeSample(EyeGazeSample& sample) {
+        if (m_records.empty()) {
+            return false;
+        }
+
+        // Loop over the capture.
+        const auto now = std::chrono::steady_clock::now();
+        const double duration = m_records.back().time - m_records.front().time;
+        double elapsed = std::chrono::duration<double>(now - m_startTime).count();
+        if (duration > 0) {
+            elapsed = std::fmod(elapsed, duration);
+        }
+        const double time = m_records.front().time + elapsed;
+
+        auto it = std::upper_bound(m_records.cbegin(),
+                                   m_records.cend(),
+                                   time,
+                                   [](double time, const GazeComparisonRecord& record) { return time < record.time; });
+        const auto& record = *(it != m_records.cbegin() ? it - 1 : it);
+        if (!record.isValid[m_trace]) {
+            return false;
+        }
+
+        sample.gaze = record.gaze[m_trace];
+        sample.confidence = 1.f;
+        sample.time = now - std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                std::chrono::duration<double>(time - record.time));
+        return true;
+    }
+
+    std::unique_ptr<IEyeTracker> createReplayEyeTracker(const std::string& specification) {
+        const std::string prefix = "Replay:";
+        if (specification.rfind(prefix, 0) != 0) {
+            return nullptr;
+        }
+
+        std::string path = specification.substr(prefix.size());
+        size_t trace = 0;
+        const size_t separator = path.rfind('|');
+        if (separator != std::string::npos) {
+            trace = path.substr(separator + 1) == "B" ? 1 : 0;
+            path = path.substr(0, separator);
+        }
+
+        if (!std::filesystem::exists(path)) {
+            Log(fmt::format("Cannot open capture file {}\n", path));
+            return nullptr;
+        }
+        return std::make_unique<ReplayEyeTracker>(path, trace);
+    }
+
+} // namespace openxr_api_layer
@@ -0,0 +1,123 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include "eye_tracker.h"
+#include "probe.h"
+
+namespace openxr_api_layer {
+
+    // One poll of both trackers being compared. Times are relative to the beginning of the capture.
+    struct GazeComparisonRecord {
+        double time{0};
+        bool isValid[2]{};
+        XrVector3f gaze[2]{};
+    };
+
+    struct GazeComparisonReport {
+        std::string names[2];
+        size_t recordCount{0};
+        double duration{0};
+
+        // Fraction of the polls with valid data.
+        double validity[2]{};
+        double bothValid{0};
+
+        // Angle between the two gazes when both are valid, in degrees.
+        double meanDivergence{0};
+        double medianDivergence{0};
+        double p95Divergence{0};
+        double maxDivergence{0};
+
+        // How much the second tracker lags behind the first one (negative if it is ahead), from the cross-correlation
+        // of the gaze angles. Only meaningful if the correlation is high enough. Not set until estimateGazeLatency()
+        // is run, which the comparison mode does on the last 5 minutes of the session.
+        std::optional<double> latencyMs;
+        std::optional<double> correlation;
+    };
+
+    // These do not depend on the platform or on a headset, and can be used to compare recorded traces offline.
+    GazeComparisonReport analyzeGazeComparison(const std::vector<GazeComparisonRecord>& records);
+    // The cross-correlation is costly (it scans +/-200ms in 2ms steps over the whole capture, about 0.3s per 10
+    // minutes), so it is not part of analyzeGazeComparison().
+    void estimateGazeLatency(const std::vector<GazeComparisonRecord>& records, GazeComparisonReport& report);
+    std::string formatGazeComparisonReport(const GazeComparisonReport& report);
+    bool writeGazeCapture(const std::filesystem::path& path,
+                          const std::string (&names)[2],
+                          const std::vector<GazeComparisonRecord>& records);
+    bool readGazeCapture(const std::filesystem::path& path,
+                         std::string (&names)[2],
+                         std::vector<GazeComparisonRecord>& records);
+
+    // Diagnostic mode running two trackers at once. The first tracker drives foveation, and a report comparing both
+    // trackers, including their relative latency, is written when the tracker is destroyed. The capture is optional,
+    // for offline analysis with the gaze-compare tool.
+    class ComparisonEyeTracker : public LocalEyeTracker {
+      public:
+        ComparisonEyeTracker(ProbeResult first,
+                             ProbeResult second,
+                             const std::filesystem::path& reportPath,
+                             std::optional<std::filesystem::path> capturePath);
+        ~ComparisonEyeTracker() override;
+
+        void start(XrSession session) override;
+        void stop() override;
+
+        std::string getName() const override;
+        bool getGazeSample(EyeGazeSample& sample) override;
+
+      private:
+        std::unique_ptr<IEyeTracker> m_trackers[2];
+        std::string m_names[2];
+        const std::filesystem::path m_reportPath;
+        const std::optional<std::filesystem::path> m_capturePath;
+
+        std::chrono::steady_clock::time_point m_startTime;
+        std::vector<GazeComparisonRecord> m_records;
+    };
+
+    // Plays back one of the two traces of a capture file, with the original timing.
+    class ReplayEyeTracker : public LocalEyeTracker {
+      public:
+        ReplayEyeTracker(const std::filesystem::path& path, size_t trace);
+
+        void start(XrSession session) override;
+        void stop() override;
+
+        std::string getName() const override;
+        bool getGazeSample(EyeGazeSample& sample) override;
+
+      private:
+        const size_t m_trace;
+        std::string m_name;
+        std::vector<GazeComparisonRecord> m_records;
+
+        std::chrono::steady_clock::time_point m_startTime;
+    };
+
+    // Create a replay tracker from a "Replay:<path>" or "Replay:<path>|B" specification. Returns nullptr if the file
+    // cannot be read.
+    std::unique_ptr<IEyeTracker> createReplayEyeTracker(const std::string& specification);
+
+} // namespace openxr_api_layer
@@ -0,0 +1,109 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "log.h"
+using namespace openxr_api_layer::log;
+
+#include "confidence.h"
+
+namespace openxr_api_layer {
+
+    namespace {
+
+        // Time constant of the smoothing. Short enough to react within a blink.
+        constexpr auto SmoothingTimeConstant = std::chrono::milliseconds(100);
+
+        // Step back below the low threshold of a step, and recover above its high threshold.
+        struct StepThresholds {
+            float low;
+            float high;
+        };
+        constexpr StepThresholds Steps[] = {{0.6f, 0.75f}, {0.3f, 0.45f}};
+        constexpr uint32_t MaxSteps = (uint32_t)std::size(Steps);
+
+        // Confidence must stay recovered this long before stepping up again.
+        constexpr auto RecoveryHoldTime = std::chrono::milliseconds(500);
+
+        // Modes 1 to 3 are the foveation levels, from the most aggressive (maximum) to the least (minimum).
+        constexpr uint32_t MostAggressiveMode = 1;
+        constexpr uint32_t LeastAggressiveMode = 3;
+
+    } // namespace
+
+    void ConfidenceModulator::update(float confidence, std::chrono::steady_clock::time_point time) {
+        const float dt =
+            m_lastUpdateTime ? std::chrono::duration<float>(time - m_lastUpdateTime.value()).count() : 0.f;
+        m_lastUpdateTime = time;
+
+        const float alpha = 1.f - std::exp(-dt / std::chrono::duration<float>(SmoothingTimeConstant).count());
+        m_smoothedConfidence += alpha * (std::clamp(confidence, 0.f, 1.f) - m_smoothedConfidence);
+
+        // Stepping back happens right away, but stepping up waits for the confidence to hold.
+        uint32_t steps = m_steps.load(std::memory_order_relaxed);
+        const uint32_t previousSteps = steps;
+        while (steps < MaxSteps && m_smoothedConfidence < Steps[steps].low) {
+            steps++;
+        }
+        if (steps == previousSteps && steps > 0) {
+            if (m_smoothedConfidence > Steps[steps - 1].high) {
+                if (!m_recoveryStartTime) {
+                    m_recoveryStartTime = time;
+                }
+                if (time - m_recoveryStartTime.value() >= RecoveryHoldTime) {
+                    steps--;
+                }
+            } else {
+                m_recoveryStartTime.reset();
+            }
+        }
+        if (steps == previousSteps) {
+            return;
+        }
+
+        m_recoveryStartTime.reset();
+        m_steps.store(steps, std::memory_order_relaxed);
+
+        TraceLoggingWrite(g_traceProvider,
+                          "ConfidenceModulator_Step",
+                          TLArg(m_smoothedConfidence, "Confidence"),
+                          TLArg(steps, "Steps"));
+    }
+
+    void ConfidenceModulator::reset() {
+        m_lastUpdateTime.reset();
+        m_smoothedConfidence = 1.f;
+        m_recoveryStartTime.reset();
+        if (m_steps.exchange(0, std::memory_order_relaxed)) {
+            TraceLoggingWrite(g_traceProvider, "ConfidenceModulator_Reset");
+        }
+    }
+
+    uint32_t ConfidenceModulator::adjustMode(uint32_t mode) const {
+        if (mode < MostAggressiveMode || mode > LeastAggressiveMode) {
+            return mode;
+        }
+        return std::min(mode + m_steps.load(std::memory_order_relaxed), LeastAggressiveMode);
+    }
+
+} // namespace openxr_api_layer
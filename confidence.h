@@ -0,0 +1,52 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+namespace openxr_api_layer {
+
+    // Steps the foveation level back to a less aggressive one while the gaze confidence is low (partial blinks, glare,
+    // calibration drift), and up again once it recovers. The confidence is smoothed, and the thresholds to step back
+    // and to recover are apart, so that the level does not flicker.
+    class ConfidenceModulator {
+      public:
+        // Called from the render thread with each valid gaze sample. Invalid samples (blinks, lost tracking) must not be
+        // passed in: the confidence holds until the tracker reports one again.
+        void update(float confidence, std::chrono::steady_clock::time_point time);
+
+        // Called from the render thread when the gaze is not used, to go back to the requested level.
+        void reset();
+
+        // The mode to use in place of the one from the settings. Safe to call from any thread.
+        uint32_t adjustMode(uint32_t mode) const;
+
+      private:
+        // Only accessed by the render thread.
+        std::optional<std::chrono::steady_clock::time_point> m_lastUpdateTime;
+        float m_smoothedConfidence{1.f};
+        std::optional<std::chrono::steady_clock::time_point> m_recoveryStartTime;
+
+        // How many levels we stepped back.
+        std::atomic<uint32_t> m_steps{0};
+    };
+
+} // namespace openxr_api_layer
@@ -26,8 +26,28 @@
 using namespace openxr_api_layer::log;
 
 #include <trackers.h>
+#include <pvremu_gaze_udp.h>
+#include <pvremu_settings_shm.h>
 using namespace openxr_api_layer;
 
+#include "broker.h"
+#include "comparison.h"
+#include "confidence.h"
+#include "benchmark.h"
+#include "eye_tracker.h"
+#include "frame_timing.h"
+#include "fusion.h"
+#include "headset.h"
+#include "osc_eye_tracker.h"
+#include "plugin.h"
+#include "probe.h"
+#include "saccade.h"
+#include "session_report.h"
+#include "shared_memory.h"
+#include "supervisor.h"
+#include "timeline.h"
+#include "udp_gaze.h"
+
 //
 // Log file helpers.
 //
@@ -42,10 +62,17 @@ namespace openxr_api_layer::log {
 
     namespace {
 
+        std::mutex logMutex;
         std::ofstream logStream;
 
+        // Lines logged before the log file is opened (eg: from DllMain), written out once it is.
+        constexpr size_t MaxEarlyLogSize = 64 * 1024;
+        std::string earlyLog;
+
         // Utility logging function.
         void InternalLog(const char* fmt, va_list va) {
+            std::unique_lock lock(logMutex);
+
             const std::time_t now = std::time(nullptr);
 
             char buf[1024];
@@ -55,9 +82,25 @@ namespace openxr_api_layer::log {
             if (logStream.is_open()) {
                 logStream << buf;
                 logStream.flush();
+            } else if (earlyLog.size() < MaxEarlyLogSize) {
+                earlyLog += buf;
             }
         }
 
+        void OpenLogFile(const std::filesystem::path& path) {
+            std::unique_lock lock(logMutex);
+
+            if (!logStream.is_open()) {
+                logStream.open(path, std::ios_base::ate);
+            }
+            if (logStream.is_open()) {
+                logStream << earlyLog;
+                logStream.flush();
+            }
+            earlyLog.clear();
+            earlyLog.shrink_to_fit();
+        }
+
     } // namespace
 
     void Log(const char* fmt, ...) {
@@ -75,17 +118,129 @@ namespace openxr_api_layer::log {
 
 namespace {
 
-    std::unique_ptr<IEyeTracker> eyeTracker;
+    std::unique_ptr<TrackerSupervisor> eyeTrackerSupervisor;
+
+    // How long the shutdown waits for the probes that are still running in the background.
+    constexpr auto ProbeShutdownTimeout = std::chrono::milliseconds(3000);
 
+    // DFR-UI publishes the settings in shared memory. The registry watcher is only used when it does not.
+    pvremu::SettingsReader sharedSettings;
     wil::unique_registry_watcher registryWatcher;
     std::atomic<uint32_t> mode = 0;
     std::atomic<bool> ignoreEyeTracking = 0;
+
+    // The "Automatic" mode of DFR-UI: the level from the profile of the title, or balanced until the title has one.
+    constexpr uint32_t AutomaticMode = 5;
+    constexpr uint32_t DefaultAutomaticMode = 2;
     std::atomic<bool> invertYAxis = 0;
 
+    std::atomic<bool> isFoveationActive = false;
+    SessionReport sessionReport;
+
     std::chrono::time_point<std::chrono::steady_clock> lastGoodEyeTrackingDataTime{};
     std::optional<pvrEyeTrackingInfo> lastGoodEyeTrackingInfo;
 
+    // Where we remember the last successful eye tracker for each headset (by driver version).
+    const char* const TrackerCacheKey = "SOFTWARE\\FR-Utility\\tracker_cache";
+
+    // Where we store what we learned about each title (by executable name).
+    const char* const ProfilesKey = "SOFTWARE\\FR-Utility\\profiles";
+    std::unique_ptr<FoveationBenchmark> foveationBenchmark;
+
+    // The foveation mode that the benchmark recommended for the title, or -1 if it did not run (yet).
+    std::atomic<int32_t> profileMode = -1;
+
+    std::unique_ptr<ConfidenceModulator> confidenceModulator;
+    std::unique_ptr<SaccadeDetector> saccadeDetector;
+
     vr::IVRSystem* openvrSystem = nullptr;
+    vr::IVRCompositor* openvrCompositor = nullptr;
+    std::unique_ptr<GpuFrameSampler> gpuFrameSampler;
+    std::string headsetDriverVersion;
+    std::unique_ptr<HeadsetProperties> headsetProperties;
+
+    // The tracker SDKs are delay-loaded, so that each game only pays for the ones that are actually probed.
+    const char* const TrackerSdkModules[] = {
+        "VarjoLib.dll",
+        "jsoncpp.dll",
+#ifdef _DEBUG
+        "libzmq-mt-gd-4_3_3.dll",
+#else
+        "libzmq-mt-4_3_3.dll",
+#endif
+    };
+
+    // DllMain runs under the loader lock, possibly while MagicAttach is injecting us into a running game. It only
+    // records when it happened, and everything else is deferred to initializeServices().
+    FoveationTimeline foveationTimeline;
+    std::once_flag servicesInitialized;
+
+    std::filesystem::path getLocalAppDataPath() {
+        return std::filesystem::path(getenv("LOCALAPPDATA")) / "PvrEmu";
+    }
+
+    std::string getApplicationName() {
+        char path[_MAX_PATH];
+        GetModuleFileNameA(nullptr, path, sizeof(path));
+        return std::filesystem::path(path).filename().string();
+    }
+
+    size_t getWorkingSetSize() {
+        PROCESS_MEMORY_COUNTERS counters{};
+        counters.cb = sizeof(counters);
+        return K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) ? counters.WorkingSetSize
+                                                                                          : 0;
+    }
+
+    std::string getLoadedTrackerSdks() {
+        std::string loaded;
+        for (const char* module : TrackerSdkModules) {
+            if (GetModuleHandleA(module)) {
+                loaded += (loaded.empty() ? "" : ", ") + std::string(module);
+            }
+        }
+        return !loaded.empty() ? loaded : "none";
+    }
+
+    // Register the trace provider and open the log file. Called on the first call into the DLL.
+    void initializeServices() {
+        std::call_once(servicesInitialized, []() {
+            const auto firstCallTime = std::chrono::steady_clock::now();
+
+            TraceLoggingRegister(g_traceProvider);
+
+            const auto localAppData = getLocalAppDataPath();
+            CreateDirectoryA(localAppData.string().c_str(), nullptr);
+
+            // Start logging to file, with whatever was logged until now.
+            OpenLogFile(localAppData / "PvrEmu.log");
+
+            char path[_MAX_PATH];
+            GetModuleFileNameA(nullptr, path, sizeof(path));
+            Log("Hello World from '%s'!\n", path);
+
+            const auto firstCallDelay =
+                foveationTimeline.getTimeTo(FoveationPhase::GetInterface).value_or(std::chrono::milliseconds(0));
+            const auto initDuration =
+                std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - firstCallTime);
+
+            // Thanks to delay-loading, none of the tracker SDKs should be loaded at this point (unless the game uses
+            // them). Use the ETW image load events (see PvrEmu.wprp) to measure the time spent in the loader.
+            const std::string loadedSdks = getLoadedTrackerSdks();
+            TraceLoggingWrite(g_traceProvider,
+                              "ProcessAttach",
+                              TLArg(getWorkingSetSize(), "WorkingSet"),
+                              TLArg(loadedSdks.c_str(), "LoadedSdks"),
+                              TLArg(firstCallDelay.count(), "FirstCallDelayMs"),
+                              TLArg(initDuration.count(), "InitDurationUs"));
+            Log(fmt::format("Attached with a working set of {}KB, tracker SDKs loaded: {}\n",
+                            getWorkingSetSize() / 1024,
+                            loadedSdks));
+            Log(fmt::format("First call {}ms after attach, initialization took {}us\n",
+                            firstCallDelay.count(),
+                            initDuration.count()));
+        });
+    }
 
     void updateMode() {
         DWORD data{};
@@ -132,22 +287,305 @@ namespace {
         }
     }
 
+    // Called every frame. This is a single atomic load when the settings did not change.
+    void refreshSharedSettings() {
+        pvremu::SettingsValues values;
+        if (sharedSettings.poll(values)) {
+            mode.store(values.mode);
+            ignoreEyeTracking.store(values.ignoreEyeTracking);
+            invertYAxis.store(values.invertYAxis);
+        }
+    }
+
+    std::string readStringSetting(const char* subkey, const char* name) {
+        char data[256]{};
+        DWORD dataSize = sizeof(data);
+        const LONG retCode = ::RegGetValueA(HKEY_CURRENT_USER,
+                                            subkey,
+                                            name,
+                                            RRF_SUBKEY_WOW6464KEY | RRF_RT_REG_SZ,
+                                            nullptr,
+                                            data,
+                                            &dataSize);
+        return retCode == ERROR_SUCCESS ? data : "";
+    }
+
+    std::optional<DWORD> readOptionalDwordSetting(const char* subkey, const char* name) {
+        DWORD data{};
+        DWORD dataSize = sizeof(data);
+        const LONG retCode = ::RegGetValueA(HKEY_CURRENT_USER,
+                                            subkey,
+                                            name,
+                                            RRF_SUBKEY_WOW6464KEY | RRF_RT_REG_DWORD,
+                                            nullptr,
+                                            &data,
+                                            &dataSize);
+        if (retCode != ERROR_SUCCESS) {
+            return {};
+        }
+        return data;
+    }
+
+    DWORD readDwordSetting(const char* subkey, const char* name) {
+        return readOptionalDwordSetting(subkey, name).value_or(0);
+    }
+
+    void writeStringSetting(const char* subkey, const char* name, const std::string& value) {
+        // This may fail with UWP applications not able to write to the registry.
+        ::RegSetKeyValueA(HKEY_CURRENT_USER, subkey, name, REG_SZ, value.c_str(), (DWORD)value.size() + 1);
+    }
+
+    void writeDwordSetting(const char* subkey, const char* name, DWORD value) {
+        // This may fail with UWP applications not able to write to the registry.
+        ::RegSetKeyValueA(HKEY_CURRENT_USER, subkey, name, REG_DWORD, &value, sizeof(value));
+    }
+
+    std::string getProfileKey() {
+        return std::string(ProfilesKey) + "\\" + getApplicationName();
+    }
+
+    // The mode recommended by the benchmark in a previous session of the title (0 if foveation did not help), or -1 if
+    // the benchmark did not run for the title.
+    int32_t readProfileMode() {
+        const auto recommendedMode = readOptionalDwordSetting(getProfileKey().c_str(), "recommended_mode");
+        return recommendedMode && recommendedMode.value() <= 3 ? (int32_t)recommendedMode.value() : -1;
+    }
+
+    // The mode from the settings, unless the benchmark is overriding it. A level picked in the settings is always
+    // used, the profile of the title only applies in automatic mode.
+    uint32_t getRequestedMode() {
+        if (foveationBenchmark) {
+            if (const auto benchmarkMode = foveationBenchmark->getMode()) {
+                return benchmarkMode.value();
+            }
+        }
+        const uint32_t settingsMode = mode.load();
+        if (settingsMode == AutomaticMode) {
+            const int32_t recommendedMode = profileMode.load();
+            return recommendedMode >= 0 ? recommendedMode : DefaultAutomaticMode;
+        }
+        return settingsMode;
+    }
+
+    // The requested mode, possibly stepped back while the gaze confidence is low, and more aggressive during saccades.
+    uint32_t getEffectiveMode() {
+        uint32_t effectiveMode = getRequestedMode();
+
+        // The benchmark needs the exact modes.
+        if (foveationBenchmark && foveationBenchmark->getMode()) {
+            return effectiveMode;
+        }
+
+        if (confidenceModulator) {
+            effectiveMode = confidenceModulator->adjustMode(effectiveMode);
+        }
+
+        // Perception is suppressed during a saccade. Balanced and minimum (modes 2 and 3) go one level further.
+        if (saccadeDetector && saccadeDetector->isInSaccade() && (effectiveMode == 2 || effectiveMode == 3)) {
+            effectiveMode--;
+        }
+
+        return effectiveMode;
+    }
+
+    ProbeResult selectEyeTracker() {
+        std::vector<TrackerProbe> eyeTrackers;
+
+        // Initialize the eye tracker. We probe all trackers at once, but prioritize from "strongest check" to "weakest
+        // check".
+
+        // 1) Omnicept uses a background service, it is not likely to be installed if the device is not used.
+        eyeTrackers.push_back({"Omnicept", createOmniceptEyeTracker, std::chrono::milliseconds(3000)});
+
+        // 2) Virtual Desktop driver for SteamVR shall only be loaded if the streamer app is opened.
+        eyeTrackers.push_back({"Virtual Desktop", createVirtualDesktopEyeTracker, std::chrono::milliseconds(1000)});
+
+        // 3) PSVR2 Toolkit driver for SteamVR shall only be loaded if the toolkit is loaded.
+        eyeTrackers.push_back({"PSVR2 Toolkit", createPsvr2ToolkitEyeTracker, std::chrono::milliseconds(1000)});
+
+        // 4) Varjo only loads if Varjo Base is running.
+        eyeTrackers.push_back({"Varjo", createVarjoEyeTracker, std::chrono::milliseconds(2000)});
+
+        // 5) Shared memory only exists while an in-house tracker process publishes to it.
+        eyeTrackers.push_back({"Shared memory", createSharedMemoryEyeTracker, std::chrono::milliseconds(500)});
+
+        // 6) Out-of-tree trackers, each with their own device check.
+        for (auto& probe : discoverEyeTrackerPlugins(getLocalAppDataPath() / "plugins")) {
+            eyeTrackers.push_back(std::move(probe));
+        }
+
+        // 7) Our binary UDP protocol cannot tell whether a sender exists either, so it is only probed when configured.
+        const DWORD udpGazePort = readDwordSetting("SOFTWARE\\FR-Utility", "gaze_udp_port");
+        std::string udpGazeGroup = readStringSetting("SOFTWARE\\FR-Utility", "gaze_udp_group");
+        if (udpGazeGroup.empty()) {
+            udpGazeGroup = pvremu::GazeUdpDefaultMulticastGroup;
+        }
+        const TrackerProbe udpGazeProbe{
+            "UDP gaze",
+            [udpGazePort, udpGazeGroup]() {
+                return createUdpGazeEyeTracker(udpGazePort ? (uint16_t)udpGazePort : pvremu::GazeUdpDefaultPort,
+                                               udpGazeGroup);
+            },
+            std::chrono::milliseconds(1000),
+            false};
+        if (udpGazePort) {
+            eyeTrackers.push_back(udpGazeProbe);
+        }
+
+        const TrackerProbe steamLinkProbe{"Steam Link", createSteamLinkEyeTracker, std::chrono::milliseconds(1000)};
+        // OSC always succeeds, so we never remember it as the tracker for this headset.
+        const DWORD oscPort = readDwordSetting("SOFTWARE\\FR-Utility", "osc_port");
+        const TrackerProbe oscProbe{
+            "VRChat OSC",
+            [oscPort]() { return createOscEyeTracker(oscPort ? (uint16_t)oscPort : DefaultOscPort); },
+            std::chrono::milliseconds(1000),
+            false};
+        if (headsetDriverVersion.rfind("SL,", 0) == 0) {
+            // 8) Steam Link doesn't have any check, so use the driver version property to detect whether we should
+            // enable it.
+            eyeTrackers.push_back(steamLinkProbe);
+        } else {
+            // 9) If Steam Link is undetected, we fall back to OSC for use with Bigscreen and Project Babble solutions.
+            eyeTrackers.push_back(oscProbe);
+        }
+
+        const auto findProbe = [&](const std::string& name) -> const TrackerProbe* {
+            for (const auto& probe : eyeTrackers) {
+                if (probe.name == name) {
+                    return &probe;
+                }
+            }
+            // Allow forcing any of the fallbacks regardless of the headset or settings.
+            for (const auto* probe : {&udpGazeProbe, &steamLinkProbe, &oscProbe}) {
+                if (probe->name == name) {
+                    return probe;
+                }
+            }
+            return nullptr;
+        };
+
+        const auto probingStart = std::chrono::steady_clock::now();
+        const char* probingPath = "uncached";
+        ProbeResult selected;
+
+        // The user may pin the tracker to use and skip probing entirely.
+        const std::string forcedTracker = readStringSetting("SOFTWARE\\FR-Utility", "eye_tracker");
+        const TrackerProbe* forcedProbe = !forcedTracker.empty() ? findProbe(forcedTracker) : nullptr;
+
+        // Diagnostic mode to compare two trackers (or recorded traces) side by side.
+        const std::string comparedTrackers = readStringSetting("SOFTWARE\\FR-Utility", "eye_tracker_compare");
+        const size_t comparedSeparator = comparedTrackers.find(';');
+        if (comparedSeparator != std::string::npos) {
+            probingPath = "comparison";
+            ProbeResult compared[2];
+            const std::string comparedNames[2] = {comparedTrackers.substr(0, comparedSeparator),
+                                                  comparedTrackers.substr(comparedSeparator + 1)};
+            for (size_t i = 0; i < 2; i++) {
+                if (comparedNames[i].rfind("Replay:", 0) == 0) {
+                    compared[i] = {createReplayEyeTracker(comparedNames[i]), comparedNames[i], false};
+                } else if (const TrackerProbe* probe = findProbe(comparedNames[i])) {
+                    compared[i] = probeEyeTrackers({*probe});
+                }
+                if (!compared[i].tracker) {
+                    Log(fmt::format("Cannot compare with unavailable eye tracker: {}\n", comparedNames[i]));
+                }
+            }
+
+            if (compared[0].tracker && compared[1].tracker) {
+                const auto localAppData = getLocalAppDataPath();
+                const std::string suffix =
+                    fmt::format("{}", std::chrono::system_clock::now().time_since_epoch().count());
+                std::optional<std::filesystem::path> capturePath;
+                if (readDwordSetting("SOFTWARE\\FR-Utility", "eye_tracker_compare_capture")) {
+                    capturePath = localAppData / ("gaze_capture_" + suffix + ".csv");
+                }
+                const auto reportPath = localAppData / ("comparison_" + suffix + ".txt");
+                selected.tracker = std::make_unique<ComparisonEyeTracker>(
+                    std::move(compared[0]), std::move(compared[1]), reportPath, capturePath);
+                selected.name = "Comparison";
+            }
+        } else if (forcedProbe) {
+            probingPath = "forced";
+            Log(fmt::format("Using forced eye tracker: {}\n", forcedTracker));
+            selected = {createEyeTracker(*forcedProbe), forcedProbe->name, false};
+        } else if (forcedTracker.rfind("Replay:", 0) == 0) {
+            probingPath = "forced";
+            Log(fmt::format("Using forced eye tracker: {}\n", forcedTracker));
+            selected = {createReplayEyeTracker(forcedTracker), forcedTracker, false};
+        } else if (forcedTracker == "None") {
+            probingPath = "forced";
+            Log("Eye tracking is disabled by the settings\n");
+        } else {
+            if (!forcedTracker.empty()) {
+                Log(fmt::format("Unknown forced eye tracker: {}\n", forcedTracker));
+            }
+
+            // Try the tracker that was last successful with this headset first.
+            const std::string cachedTracker = readStringSetting(TrackerCacheKey, headsetDriverVersion.c_str());
+            const TrackerProbe* cachedProbe = !cachedTracker.empty() ? findProbe(cachedTracker) : nullptr;
+
+            // With fusion, we want every tracker that works rather than the first one.
+            const DWORD fusionMode = readDwordSetting("SOFTWARE\\FR-Utility", "eye_tracker_fusion");
+            const bool useFusion = fusionMode == (DWORD)FusionEyeTracker::Mode::Select ||
+                                   fusionMode == (DWORD)FusionEyeTracker::Mode::Blend;
+            if (useFusion) {
+                probingPath = "fusion";
+                std::vector<ProbeResult> sources = probeAllEyeTrackers(eyeTrackers);
+                if (sources.size() > 1) {
+                    selected.tracker =
+                        std::make_unique<FusionEyeTracker>(std::move(sources), (FusionEyeTracker::Mode)fusionMode);
+                    selected.name = "Fusion";
+                } else if (!sources.empty()) {
+                    selected = std::move(sources[0]);
+                }
+            } else if (cachedProbe) {
+                probingPath = "cached";
+                selected = probeEyeTrackers({*cachedProbe});
+            }
+
+            if (!selected.tracker && !useFusion) {
+                probingPath = "uncached";
+                selected = probeEyeTrackers(eyeTrackers);
+                if (selected.isCacheable && selected.name != cachedTracker) {
+                    writeStringSetting(TrackerCacheKey, headsetDriverVersion.c_str(), selected.name);
+                }
+            }
+        }
+
+        const auto probingDuration =
+            std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - probingStart);
+        TraceLoggingWrite(g_traceProvider,
+                          "EyeTrackerSelection",
+                          TLArg(probingPath, "Path"),
+                          TLArg(probingDuration.count(), "DurationMs"));
+        Log(fmt::format("Eye tracker selection took {}ms ({})\n", probingDuration.count(), probingPath));
+
+        return selected;
+    }
+
     pvrResult emulate_initialise() {
         TraceLocalActivity(local);
 
         TraceLoggingWriteStart(local, "PVR_initialize");
 
-        // Watch for changes in the registry.
-        try {
-            wil::unique_hkey keyToWatch;
-            if (RegOpenKeyExW(
-                    HKEY_CURRENT_USER, L"SOFTWARE\\FR-Utility", 0, KEY_WOW64_64KEY | KEY_READ, keyToWatch.put()) ==
-                ERROR_SUCCESS) {
-                registryWatcher = wil::make_registry_watcher(
-                    std::move(keyToWatch), true, [&](wil::RegistryChangeKind changeType) { updateMode(); });
+        foveationTimeline.mark(FoveationPhase::Initialise);
+        sessionReport.start();
+
+        // Watch for changes in the registry, unless DFR-UI publishes them for us.
+        if (sharedSettings.open()) {
+            Log("Reading settings from shared memory\n");
+        } else {
+            try {
+                wil::unique_hkey keyToWatch;
+                if (RegOpenKeyExW(
+                        HKEY_CURRENT_USER, L"SOFTWARE\\FR-Utility", 0, KEY_WOW64_64KEY | KEY_READ, keyToWatch.put()) ==
+                    ERROR_SUCCESS) {
+                    registryWatcher = wil::make_registry_watcher(
+                        std::move(keyToWatch), true, [&](wil::RegistryChangeKind changeType) { updateMode(); });
+                }
+            } catch (std::exception&) {
+                // Ignore errors that can happen with UWP applications not able to write to the registry.
             }
-        } catch (std::exception&) {
-            // Ignore errors that can happen with UWP applications not able to write to the registry.
         }
 
         // Retrieve the IVRSystem. If we are in this function now, then it means someone initialized it at some point.
@@ -159,6 +597,7 @@ namespace {
             if (pfnVR_GetGenericInterface) {
                 vr::EVRInitError error;
                 openvrSystem = (vr::IVRSystem*)pfnVR_GetGenericInterface("IVRSystem_022", &error);
+                openvrCompositor = (vr::IVRCompositor*)pfnVR_GetGenericInterface(vr::IVRCompositor_Version, &error);
             }
         }
 
@@ -166,49 +605,93 @@ namespace {
             Log("Unable to retrieve IVRSystem, projection may be inaccurate\n");
         }
 
-        char systemName[256];
-        openvrSystem->GetStringTrackedDeviceProperty(
-            vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_DriverVersion_String, systemName, sizeof(systemName));
-
-        std::vector<std::function<std::unique_ptr<IEyeTracker>()>> eyeTrackers;
-
-        // Initialize the eye tracker. We try in order from "strongest check" to "weakest check".
+        // Opt-in, since stepping back the level is visible.
+        if (readDwordSetting("SOFTWARE\\FR-Utility", "confidence_modulation")) {
+            confidenceModulator = std::make_unique<ConfidenceModulator>();
+            Log("Foveation level follows the gaze confidence\n");
+        }
+        if (readDwordSetting("SOFTWARE\\FR-Utility", "saccade_foveation")) {
+            saccadeDetector = std::make_unique<SaccadeDetector>();
+            Log("Foveation follows the saccades\n");
+        }
 
-        // 1) Omnicept uses a background service, it is not likely to be installed if the device is not used.
-        eyeTrackers.push_back(createOmniceptEyeTracker);
+        // The benchmark cycles through the modes and measures the GPU frame times, then stores the recommended mode in
+        // the profile of the title. It only runs once per title, the following sessions use the stored mode in automatic
+        // mode.
+        profileMode = readProfileMode();
+        if (profileMode >= 0) {
+            Log(fmt::format("Foveation mode from the profile of the title (used in automatic mode): {}\n",
+                            getFoveationModeName(profileMode.load())));
+        } else if (readDwordSetting("SOFTWARE\\FR-Utility", "foveation_benchmark") && openvrCompositor) {
+            foveationBenchmark = std::make_unique<FoveationBenchmark>([](const BenchmarkResult& result) {
+                if (result.recommendedMode) {
+                    writeDwordSetting(getProfileKey().c_str(), "recommended_mode", result.recommendedMode.value());
+                    profileMode = (int32_t)result.recommendedMode.value();
+                }
+            });
+        }
 
-        // 2) Virtual Desktop driver for SteamVR shall only be loaded if the streamer app is opened.
-        eyeTrackers.push_back(createVirtualDesktopEyeTracker);
+        // Collect the GPU frame times, to tell how much each foveation level helps.
+        if (openvrCompositor) {
+            std::function<void(float)> frameListener;
+            if (foveationBenchmark) {
+                frameListener = [](float gpuMs) { foveationBenchmark->recordGpuFrame(gpuMs); };
+            }
+            gpuFrameSampler = std::make_unique<GpuFrameSampler>(
+                createCompositorFrameTimingSource(openvrCompositor),
+                []() { return FoveationState{getEffectiveMode(), isFoveationActive.load()}; },
+                frameListener);
+        } else {
+            Log("Unable to retrieve IVRCompositor, GPU frame times will not be reported\n");
+        }
 
-        // 3) PSVR2 Toolkit driver for SteamVR shall only be loaded if the toolkit is loaded.
-        eyeTrackers.push_back(createPsvr2ToolkitEyeTracker);
+        // Compute the eye render info upfront, so that LibMagic's queries are just a copy from the cache.
+        headsetProperties = std::make_unique<HeadsetProperties>(openvrSystem);
 
-        // 4) Varjo only loads if Varjo Base is running.
-        eyeTrackers.push_back(createVarjoEyeTracker);
+        char systemName[256]{};
+        if (openvrSystem) {
+            openvrSystem->GetStringTrackedDeviceProperty(
+                vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_DriverVersion_String, systemName, sizeof(systemName));
+        }
+        headsetDriverVersion = systemName;
 
-        if (systemName[0] == 'S' && systemName[1] == 'L' && systemName[2] == ',') {
-            // 5) Steam Link doesn't have any check, so use the driver version property to detect whether we should
-            // enable it.
-            eyeTrackers.push_back(createSteamLinkEyeTracker);
-        } else {
-            // 6) If Steam Link is undetected, we fall back to OSC for use with Bigscreen and Project Babble solutions.
-            eyeTrackers.push_back(createVRChatOSCEyeTracker);
+        // With the broker, only one process connects to the tracker and the others read its samples.
+        std::function<ProbeResult()> select = selectEyeTracker;
+        if (readDwordSetting("SOFTWARE\\FR-Utility", "gaze_broker")) {
+            select = []() { return selectBrokeredEyeTracker(selectEyeTracker); };
         }
 
-        for (uint32_t i = 0; !eyeTracker && i < std::size(eyeTrackers); i++) {
-            eyeTracker = eyeTrackers[i]();
+        const size_t workingSetBeforeProbing = getWorkingSetSize();
+        ProbeResult result = select();
+        const size_t workingSetAfterProbing = getWorkingSetSize();
+        foveationTimeline.mark(FoveationPhase::TrackerSelected);
+        {
+            const std::string loadedSdks = getLoadedTrackerSdks();
+            TraceLoggingWrite(g_traceProvider,
+                              "TrackerFootprint",
+                              TLArg(workingSetBeforeProbing, "WorkingSetBefore"),
+                              TLArg(workingSetAfterProbing, "WorkingSetAfter"),
+                              TLArg(loadedSdks.c_str(), "LoadedSdks"));
+            Log(fmt::format("Working set: {}KB before probing, {}KB after, tracker SDKs loaded: {}\n",
+                            workingSetBeforeProbing / 1024,
+                            workingSetAfterProbing / 1024,
+                            loadedSdks));
         }
 
-        if (eyeTracker) {
+        if (result.tracker) {
             TraceLoggingWrite(
-                g_traceProvider, "EyeTracker", TLArg(getTrackerType(eyeTracker->getType()).c_str(), "Type"));
-            Log(fmt::format("Using eye tracking: {}\n", getTrackerType(eyeTracker->getType())));
+                g_traceProvider, "EyeTracker", TLArg(getTrackerName(*result.tracker).c_str(), "Type"));
+            Log(fmt::format("Using eye tracking: {}\n", getTrackerName(*result.tracker)));
         } else {
             Log("No supported eye tracking device found\n");
         }
 
-        // Initial reading of the settings.
+        // The supervisor replaces the tracker if it stops working during the session.
+        eyeTrackerSupervisor = std::make_unique<TrackerSupervisor>(select, std::move(result));
+
+        // Initial reading of the settings. The shared memory (if any) has the most recent values.
         updateMode();
+        refreshSharedSettings();
 
         TraceLoggingWriteStop(local, "PVR_initialize");
 
@@ -221,7 +704,25 @@ namespace {
 
         TraceLoggingWriteStart(local, "PVR_shutdown");
 
-        eyeTracker.reset();
+        foveationTimeline.reportIncomplete();
+
+        if (eyeTrackerSupervisor) {
+            const std::shared_ptr<IEyeTracker> eyeTracker = eyeTrackerSupervisor->getTracker();
+            sessionReport.write(getApplicationName(),
+                                eyeTracker ? getTrackerName(*eyeTracker) : "none",
+                                gpuFrameSampler ? gpuFrameSampler->getFrameTimes() : GpuFrameTimes{},
+                                getLocalAppDataPath() / "sessions.jsonl");
+        }
+        gpuFrameSampler.reset();
+        foveationBenchmark.reset();
+        confidenceModulator.reset();
+        saccadeDetector.reset();
+
+        eyeTrackerSupervisor.reset();
+        headsetProperties.reset();
+
+        // Probes that missed their deadline may still be running, and they must not outlive the DLL.
+        joinProbeThreads(ProbeShutdownTimeout);
 
         Log("Terminated\n");
 
@@ -233,9 +734,15 @@ namespace {
 
         TraceLoggingWriteStart(local, "PVR_createHmd");
 
+        foveationTimeline.mark(FoveationPhase::CreateHmd);
+
+        if (foveationBenchmark) {
+            foveationBenchmark->start();
+        }
+
         // Initialize eye tracking.
-        if (eyeTracker) {
-            eyeTracker->start(XR_NULL_HANDLE);
+        if (eyeTrackerSupervisor) {
+            eyeTrackerSupervisor->start();
         }
 
         // Any fake handle.
@@ -258,35 +765,11 @@ namespace {
 
         TraceLoggingWriteStart(local, "PVR_getEyeRenderInfo", TLArg((int)eye, "eye"));
 
-        // It's unclear exactly which fields LibMagic actually needs, so we just populate them all.
-        // Refine parameters if we can. This will produce a better outcome (proper eye convergence).
-        if (openvrSystem) {
-            float bottom, left, right, top;
-            // Note that top and bottom are swapped (empirical mistake in OpenVR?).
-            openvrSystem->GetProjectionRaw((vr::EVREye)eye, &left, &right, &bottom, &top);
-            outInfo->Fov.DownTan = (float)abs(bottom);
-            outInfo->Fov.LeftTan = (float)abs(left);
-            outInfo->Fov.RightTan = (float)abs(right);
-            outInfo->Fov.UpTan = (float)abs(top);
-        } else {
-            outInfo->Fov.DownTan = outInfo->Fov.LeftTan = outInfo->Fov.RightTan = outInfo->Fov.UpTan =
-                (float)tan(M_PI_4);
+        // We should always have initialized the cache in emulate_initialise(), but be robust against misuse.
+        if (!headsetProperties) {
+            headsetProperties = std::make_unique<HeadsetProperties>(openvrSystem);
         }
-
-        // Don't care? These values seem to make no difference.
-        outInfo->DistortedViewport.Pos = {0, 0};
-        outInfo->DistortedViewport.Size = {2160, 2160};
-
-        // Don't care? Just put a value that assumes uniform PPD.
-        outInfo->PixelsPerTanAngleAtCenter.x =
-            outInfo->DistortedViewport.Size.w / (abs(outInfo->Fov.LeftTan) + abs(outInfo->Fov.RightTan));
-        outInfo->PixelsPerTanAngleAtCenter.y =
-            outInfo->DistortedViewport.Size.h / (abs(outInfo->Fov.UpTan) + abs(outInfo->Fov.DownTan));
-
-        // No canting.
-        const float ipd = 0.063f;
-        outInfo->HmdToEyePose.Position = {(ipd / 2.f) * (eye == pvrEye_Left ? -1 : 1), 0, 0};
-        outInfo->HmdToEyePose.Orientation = {0, 0, 0, 1};
+        headsetProperties->getEyeRenderInfo(eye, *outInfo);
 
         TraceLoggingWriteStop(local, "PVR_getEyeRenderInfo");
 
@@ -298,6 +781,8 @@ namespace {
 
         TraceLoggingWriteStart(local, "PVR_getIntConfig", TLArg(key), TLArg(def_val));
 
+        refreshSharedSettings();
+
 #ifdef _DEBUG
         // Debug keys for experimenting.
         {
@@ -326,23 +811,27 @@ namespace {
                     mode.store(3);
                 } else if (isFnPressed[8]) {
                     mode.store(4);
+                } else if (isFnPressed[9]) {
+                    mode.store(AutomaticMode);
                 }
             }
         }
 #endif
 
+        // Only log the changes that were asked for, not the ones from the confidence modulation.
         static uint32_t oldMode = -1;
-        const uint32_t currentMode = mode.load();
-        if (oldMode != currentMode) {
-            if (!currentMode) {
+        const uint32_t requestedMode = getRequestedMode();
+        if (oldMode != requestedMode) {
+            if (!requestedMode) {
                 Log("Disabling foveation\n");
-            } else if (currentMode == 4) {
+            } else if (requestedMode == 4) {
                 Log("Debug mode\n");
             } else {
-                Log("Setting foveation level: %u\n", currentMode - 1);
+                Log("Setting foveation level: %u\n", requestedMode - 1);
             }
         }
-        oldMode = currentMode;
+        oldMode = requestedMode;
+        const uint32_t currentMode = getEffectiveMode();
 
         int value = def_val;
         {
@@ -372,6 +861,11 @@ namespace {
                     Log("Foveation is %s\n", val ? "active" : "not active");
                 }
                 wasActive = !!val;
+                isFoveationActive = !!val;
+
+                if (val) {
+                    foveationTimeline.mark(FoveationPhase::FoveationActive);
+                }
             }
         }
 
@@ -385,6 +879,24 @@ namespace {
 
         TraceLoggingWriteStart(local, "PVR_getEyeTrackingInfo", TLArg(absTime));
 
+        const auto callStartTime = std::chrono::steady_clock::now();
+
+        refreshSharedSettings();
+
+        // Some applications (like Unity) may render the image upside-down.
+        const auto applyInvertYAxis = [&]() {
+            if (invertYAxis.load()) {
+                for (uint32_t i = 0; i < 2; i++) {
+                    outInfo->GazeTan[i].y = -outInfo->GazeTan[i].y - 0.5f;
+                }
+            }
+        };
+
+        bool isValid = false;
+        bool hasFreshGaze = false;
+        float sampleAge = 0.f;
+        const std::shared_ptr<IEyeTracker> eyeTracker =
+            eyeTrackerSupervisor ? eyeTrackerSupervisor->getTracker() : nullptr;
         if (eyeTracker) {
             const auto now = std::chrono::steady_clock::now();
 
@@ -393,40 +905,88 @@ namespace {
                 lastGoodEyeTrackingInfo.reset();
             }
 
-            // Query the most recent eye tracking data.
-            XrVector3f gaze{};
-            bool isValid = false;
+            // Query the most recent eye tracking data. The sample carries its capture time when the tracker knows it.
+            EyeGazeSample sample;
             if (!ignoreEyeTracking.load()) {
-                isValid = eyeTracker->getGaze(0, gaze);
+                isValid = getGazeSample(*eyeTracker, sample);
             }
-            for (uint32_t i = 0; i < 2; i++) {
-                // Our gaze vector is normalized.
-                // This works well-enough.
-                outInfo->GazeTan[i] = {gaze.x, gaze.y};
+
+            // Only the confidences reported by the tracker count. Blinks are bridged by the cached gaze below, and they
+            // must not step the level back.
+            if (confidenceModulator) {
+                if (ignoreEyeTracking.load()) {
+                    confidenceModulator->reset();
+                } else if (isValid) {
+                    confidenceModulator->update(sample.confidence, now);
+                }
             }
 
-            // Some applications (like Unity) may render the image upside-down.
-            if (invertYAxis.load()) {
-                for (uint32_t i = 0; i < 2; i++) {
-                    outInfo->GazeTan[i].y = -outInfo->GazeTan[i].y - 0.5f;
+            // During a saccade, the foveal region moves ahead to the predicted landing point.
+            XrVector3f gaze = sample.gaze;
+            if (isValid && saccadeDetector) {
+                gaze = saccadeDetector->update(sample.gaze, sample.time);
+                if (const auto landing = saccadeDetector->takeLanding()) {
+                    sessionReport.recordSaccade(landing->predictionError, landing->staleGazeError);
                 }
             }
 
             if (isValid) {
+                hasFreshGaze = true;
+                foveationTimeline.mark(FoveationPhase::FirstValidGaze);
+                sampleAge = std::chrono::duration<float, std::milli>(now - sample.time).count();
+                if (headsetProperties) {
+                    // Use the same eye geometry as the one we report in emulate_getEyeRenderInfo().
+                    headsetProperties->getGazeTangents(gaze, outInfo->GazeTan);
+                } else {
+                    for (uint32_t i = 0; i < 2; i++) {
+                        // Our gaze vector is normalized.
+                        // This works well-enough.
+                        outInfo->GazeTan[i] = {gaze.x, gaze.y};
+                    }
+                }
+                applyInvertYAxis();
+
                 lastGoodEyeTrackingInfo = *outInfo;
                 lastGoodEyeTrackingDataTime = now;
-            } else if (!isValid && lastGoodEyeTrackingInfo) {
+            } else if (lastGoodEyeTrackingInfo) {
                 // To avoid warping during blinking, we use a reasonably recent cached gaze vector.
                 *outInfo = lastGoodEyeTrackingInfo.value();
                 isValid = true;
             }
+        } else if (confidenceModulator) {
+            confidenceModulator->reset();
+        }
 
-            outInfo->TimeInSeconds = isValid ? absTime : 0;
-        } else {
-            outInfo->TimeInSeconds = 0;
+        // Let the supervisor know how the tracker is doing (even if there is currently none).
+        if (eyeTrackerSupervisor && !ignoreEyeTracking.load()) {
+            eyeTrackerSupervisor->reportGaze(hasFreshGaze);
+        }
+
+        // Without eye tracking data, use fixed foveation centered on the lenses rather than the projection centers. The
+        // centers are computed in the headset's own geometry, so they are not subject to the application's Y inversion.
+        if (!isValid && headsetProperties) {
+            headsetProperties->getFixedFoveationCenters(outInfo->GazeTan);
+            isValid = true;
+        }
+
+        outInfo->TimeInSeconds = isValid ? absTime : 0;
+
+        {
+            SessionFrame frame;
+            frame.mode = getEffectiveMode();
+            frame.isFoveationActive = isFoveationActive.load();
+            frame.isGazeQueried = eyeTracker && !ignoreEyeTracking.load();
+            frame.hasFreshGaze = hasFreshGaze;
+            frame.sampleAgeMs = sampleAge;
+            frame.callCostMs =
+                std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - callStartTime).count();
+            sessionReport.recordFrame(frame);
         }
 
-        TraceLoggingWriteStop(local, "PVR_getEyeTrackingInfo");
+        TraceLoggingWriteStop(local,
+                              "PVR_getEyeTrackingInfo",
+                              TLArg(hasFreshGaze, "FreshGaze"),
+                              TLArg(sampleAge, "SampleAgeMs"));
 
         return pvr_success;
     }
@@ -434,6 +994,9 @@ namespace {
     pvrInterface* emulate_getPvrInterface(uint32_t major_ver, uint32_t minor_ver) {
         static pvrInterface result;
 
+        foveationTimeline.mark(FoveationPhase::GetInterface);
+        initializeServices();
+
         TraceLocalActivity(local);
 
         TraceLoggingWriteStart(local, "PVR_getInterface", TLArg(major_ver), TLArg(minor_ver));
@@ -481,23 +1044,7 @@ extern "C" __declspec(dllexport) pvrInterface* getPvrInterface(uint32_t major_ve
 BOOL APIENTRY DllMain(HMODULE hModule, DWORD ul_reason_for_call, LPVOID lpReserved) {
     switch (ul_reason_for_call) {
     case DLL_PROCESS_ATTACH:
-        TraceLoggingRegister(g_traceProvider);
-
-        {
-            const auto localAppData = std::filesystem::path(getenv("LOCALAPPDATA")) / "PvrEmu";
-            CreateDirectoryA(localAppData.string().c_str(), nullptr);
-
-            // Start logging to file.
-            if (!logStream.is_open()) {
-                std::string logFile = (localAppData / ("PvrEmu.log")).string();
-                logStream.open(logFile, std::ios_base::ate);
-            }
-
-            char path[_MAX_PATH];
-            GetModuleFileNameA(nullptr, path, sizeof(path));
-            Log("Hello World from '%s'!\n", path);
-        }
-
+        foveationTimeline.mark(FoveationPhase::Attach);
         break;
 
     case DLL_THREAD_ATTACH:
@@ -0,0 +1,88 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+namespace openxr_api_layer {
+
+    // A gaze sample, with the details that some backends can provide beyond IEyeTracker::getGaze().
+    struct EyeGazeSample {
+        // Unit vector in head space.
+        XrVector3f gaze{0.f, 0.f, -1.f};
+
+        // Normalized confidence, from 0 (unusable) to 1.
+        float confidence{0.f};
+
+        // When the sample was captured (or received, if the backend cannot tell).
+        std::chrono::steady_clock::time_point time{};
+    };
+
+    // Base class for the eye trackers implemented in this project, as opposed to the ones imported from the
+    // OpenXR-Eye-Trackers project.
+    class LocalEyeTracker : public IEyeTracker {
+      public:
+        virtual std::string getName() const = 0;
+        virtual bool getGazeSample(EyeGazeSample& sample) = 0;
+
+        bool isGazeAvailable(XrTime time) const override {
+            return true;
+        }
+
+        bool getGaze(XrTime time, XrVector3f& unitVector) override {
+            EyeGazeSample sample;
+            if (!getGazeSample(sample)) {
+                return false;
+            }
+            unitVector = sample.gaze;
+            return true;
+        }
+
+        // Our trackers are not part of the upstream enumeration, use getName() to identify them.
+        TrackerType getType() const override {
+            return {};
+        }
+    };
+
+    // Human-readable name of any tracker.
+    static inline std::string getTrackerName(const IEyeTracker& tracker) {
+        if (const auto localTracker = dynamic_cast<const LocalEyeTracker*>(&tracker)) {
+            return localTracker->getName();
+        }
+        return getTrackerType(tracker.getType());
+    }
+
+    // Query a sample from any tracker. Trackers that do not provide details report full confidence for valid data.
+    static inline bool getGazeSample(IEyeTracker& tracker, EyeGazeSample& sample) {
+        if (const auto localTracker = dynamic_cast<LocalEyeTracker*>(&tracker)) {
+            return localTracker->getGazeSample(sample);
+        }
+
+        if (!tracker.getGaze(0, sample.gaze)) {
+            sample.confidence = 0.f;
+            return false;
+        }
+        sample.confidence = 1.f;
+        sample.time = std::chrono::steady_clock::now();
+        return true;
+    }
+
+} // namespace openxr_api_layer
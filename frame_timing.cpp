@@ -0,0 +1,163 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "log.h"
+using namespace openxr_api_layer::log;
+
+#include "frame_timing.h"
+
+namespace openxr_api_layer {
+
+    namespace {
+
+        // The compositor keeps a history of a few seconds, we only need to come back often enough to not miss frames.
+        constexpr auto SamplingPeriod = std::chrono::milliseconds(100);
+        constexpr size_t MaxFramesPerSample = 64;
+
+        constexpr auto StatisticsPeriod = std::chrono::seconds(60);
+
+        // The compositor reports no GPU time for frames it could not measure.
+        constexpr float MinValidGpuMs = 0.0001f;
+
+        class CompositorFrameTimingSource : public IFrameTimingSource {
+          public:
+            CompositorFrameTimingSource(vr::IVRCompositor* compositor) : m_compositor(compositor) {
+            }
+
+            size_t getFrameTimings(GpuFrameTiming* timings, size_t count) override {
+                m_timings.resize(count);
+                m_timings[0].m_nSize = sizeof(vr::Compositor_FrameTiming);
+                const uint32_t copied = m_compositor->GetFrameTimings(m_timings.data(), (uint32_t)count);
+                for (uint32_t i = 0; i < copied; i++) {
+                    timings[i].frameIndex = m_timings[i].m_nFrameIndex;
+                    timings[i].gpuMs = m_timings[i].m_flPreSubmitGpuMs + m_timings[i].m_flPostSubmitGpuMs;
+                }
+                return copied;
+            }
+
+          private:
+            vr::IVRCompositor* const m_compositor;
+            std::vector<vr::Compositor_FrameTiming> m_timings;
+        };
+
+    } // namespace
+
+    std::unique_ptr<IFrameTimingSource> createCompositorFrameTimingSource(vr::IVRCompositor* compositor) {
+        return std::make_unique<CompositorFrameTimingSource>(compositor);
+    }
+
+    GpuFrameSampler::GpuFrameSampler(std::unique_ptr<IFrameTimingSource> source,
+                                     std::function<FoveationState()> getState,
+                                     std::function<void(float gpuMs)> frameListener)
+        : m_source(std::move(source)), m_getState(std::move(getState)), m_frameListener(std::move(frameListener)) {
+        m_samplerThread = std::thread([&]() { samplerThread(); });
+    }
+
+    GpuFrameSampler::~GpuFrameSampler() {
+        {
+            std::unique_lock lock(m_samplerMutex);
+            m_stopSampler = true;
+        }
+        m_samplerWakeup.notify_all();
+        m_samplerThread.join();
+    }
+
+    GpuFrameTimes GpuFrameSampler::getFrameTimes() const {
+        std::unique_lock lock(m_frameTimesMutex);
+        return m_frameTimes;
+    }
+
+    void GpuFrameSampler::samplerThread() {
+        std::array<GpuFrameTiming, MaxFramesPerSample> timings;
+        std::optional<uint32_t> lastFrameIndex;
+        auto statisticsStart = std::chrono::steady_clock::now();
+        uint64_t statisticsFrameCount = 0;
+
+        std::unique_lock lock(m_samplerMutex);
+        while (!m_samplerWakeup.wait_for(lock, SamplingPeriod, [&] { return m_stopSampler; })) {
+            const size_t count = m_source->getFrameTimings(timings.data(), timings.size());
+            if (!count) {
+                continue;
+            }
+
+            // The frames were rendered during the last period, so the current state is what they were rendered with.
+            // Frames from before the first period (or from before the application restarted its frame counter) were
+            // rendered with an unknown state and are skipped.
+            const uint32_t newestFrameIndex = timings[count - 1].frameIndex;
+            if (lastFrameIndex && newestFrameIndex >= lastFrameIndex.value()) {
+                const auto isNewFrame = [&](const GpuFrameTiming& timing) {
+                    return timing.frameIndex > lastFrameIndex.value() && timing.gpuMs > MinValidGpuMs;
+                };
+                const FoveationState state = m_getState();
+
+                {
+                    std::unique_lock frameTimesLock(m_frameTimesMutex);
+                    DurationHistogram& histogram = m_frameTimes.get(state);
+                    for (size_t i = 0; i < count; i++) {
+                        if (isNewFrame(timings[i])) {
+                            histogram.add(timings[i].gpuMs);
+                            statisticsFrameCount++;
+                        }
+                    }
+                }
+
+                if (m_frameListener) {
+                    for (size_t i = 0; i < count; i++) {
+                        if (isNewFrame(timings[i])) {
+                            m_frameListener(timings[i].gpuMs);
+                        }
+                    }
+                }
+            }
+            lastFrameIndex = newestFrameIndex;
+
+            const auto now = std::chrono::steady_clock::now();
+            if (now - statisticsStart >= StatisticsPeriod) {
+                const FoveationState state = m_getState();
+                const DurationHistogram histogram = getFrameTimes().get(state);
+
+                TraceLoggingWrite(g_traceProvider,
+                                  "GpuFrameSampler_Statistics",
+                                  TLArg(state.mode, "Mode"),
+                                  TLArg(state.isActive, "FoveationActive"),
+                                  TLArg(statisticsFrameCount, "Frames"),
+                                  TLArg(histogram.getPercentile(0.5f), "P50Ms"),
+                                  TLArg(histogram.getPercentile(0.9f), "P90Ms"),
+                                  TLArg(histogram.getPercentile(0.99f), "P99Ms"));
+                if (statisticsFrameCount) {
+                    Log(fmt::format("GPU frame time ({}, foveation {}): p50 {:.2f}ms, p90 {:.2f}ms, p99 {:.2f}ms\n",
+                                    getFoveationModeName(state.mode),
+                                    state.isActive ? "active" : "not active",
+                                    histogram.getPercentile(0.5f),
+                                    histogram.getPercentile(0.9f),
+                                    histogram.getPercentile(0.99f)));
+                }
+
+                statisticsStart = now;
+                statisticsFrameCount = 0;
+            }
+        }
+    }
+
+} // namespace openxr_api_layer
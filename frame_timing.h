@@ -0,0 +1,73 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "session_report.h"
+
+namespace openxr_api_layer {
+
+    struct GpuFrameTiming {
+        uint32_t frameIndex{0};
+        float gpuMs{0.f};
+    };
+
+    // Where the GPU frame times come from. Abstracted from the compositor, so that the sampler can be driven by
+    // simulated timings.
+    class IFrameTimingSource {
+      public:
+        virtual ~IFrameTimingSource() = default;
+
+        // Copy the timings of the most recent frames, oldest first. Returns how many were copied.
+        virtual size_t getFrameTimings(GpuFrameTiming* timings, size_t count) = 0;
+    };
+
+    std::unique_ptr<IFrameTimingSource> createCompositorFrameTimingSource(vr::IVRCompositor* compositor);
+
+    // Collects the GPU frame times continuously in a background thread, and bins them by the foveation state at the
+    // time they are collected. Each frame time is also passed to the listener (if any), from the background thread.
+    class GpuFrameSampler {
+      public:
+        GpuFrameSampler(std::unique_ptr<IFrameTimingSource> source,
+                        std::function<FoveationState()> getState,
+                        std::function<void(float gpuMs)> frameListener = {});
+        ~GpuFrameSampler();
+
+        GpuFrameTimes getFrameTimes() const;
+
+      private:
+        void samplerThread();
+
+        const std::unique_ptr<IFrameTimingSource> m_source;
+        const std::function<FoveationState()> m_getState;
+        const std::function<void(float gpuMs)> m_frameListener;
+
+        mutable std::mutex m_frameTimesMutex;
+        GpuFrameTimes m_frameTimes;
+
+        std::thread m_samplerThread;
+        std::mutex m_samplerMutex;
+        std::condition_variable m_samplerWakeup;
+        bool m_stopSampler{false};
+    };
+
+} // namespace openxr_api_layer
@@ -0,0 +1,218 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "pch.h"
+
+#include "log.h"
+using namespace openxr_api_layer::log;
+
+#include <trackers.h>
+
+#include "fusion.h"
+
+namespace openxr_api_layer {
+
+    namespace {
+
+        // Smoothing factor of the running statistics, applied once per sample (~90Hz).
+        constexpr float StatisticsSmoothing = 0.05f;
+
+        // Time constant of the freshness score. A source that did not update its gaze for this long scores ~37%.
+        constexpr auto FreshnessTimeConstant = std::chrono::milliseconds(50);
+
+        // Beyond that age, the data is considered stale and the source is not used at all.
+        constexpr auto MaxSampleAge = std::chrono::milliseconds(500);
+
+        // Jitter at which the score is halved.
+        constexpr float ReferenceJitterDegrees = 1.f;
+
+        // A new source must score that much higher than the current one to be selected, to avoid flip-flopping.
+        constexpr float SwitchHysteresis = 1.2f;
+
+        float angleDegrees(const XrVector3f& a, const XrVector3f& b) {
+            const float dot = std::clamp(a.x * b.x + a.y * b.y + a.z * b.z, -1.f, 1.f);
+            return std::acos(dot) * 180.f / (float)M_PI;
+        }
+
+        float median(float a, float b, float c) {
+            return std::max(std::min(a, b), std::min(std::max(a, b), c));
+        }
+
+        // Distance of the middle gaze from the median of the three. A movement in a consistent direction (like a
+        // saccade) follows the median and has no residual, while noise zig-zags around it.
+        float medianResidualDegrees(const std::array<XrVector3f, 3>& gazes) {
+            XrVector3f filtered{median(gazes[0].x, gazes[1].x, gazes[2].x),
+                                median(gazes[0].y, gazes[1].y, gazes[2].y),
+                                median(gazes[0].z, gazes[1].z, gazes[2].z)};
+            const float length = std::sqrt(filtered.x * filtered.x + filtered.y * filtered.y + filtered.z * filtered.z);
+            if (length <= 0.f) {
+                return 0.f;
+            }
+            filtered = {filtered.x / length, filtered.y / length, filtered.z / length};
+            return angleDegrees(gazes[1], filtered);
+        }
+
+    } // namespace
+
+    FusionEyeTracker::FusionEyeTracker(std::vector<ProbeResult> sources, Mode mode) : m_mode(mode) {
+        for (auto& result : sources) {
+            Source source;
+            source.tracker = std::move(result.tracker);
+            source.name = std::move(result.name);
+            m_sources.push_back(std::move(source));
+        }
+    }
+
+    void FusionEyeTracker::start(XrSession session) {
+        for (auto& source : m_sources) {
+            source.tracker->start(session);
+        }
+    }
+
+    void FusionEyeTracker::stop() {
+        for (auto& source : m_sources) {
+            source.tracker->stop();
+        }
+    }
+
+    std::string FusionEyeTracker::getName() const {
+        std::string name = m_mode == Mode::Blend ? "Fusion/Blend (" : "Fusion/Select (";
+        for (size_t i = 0; i < m_sources.size(); i++) {
+            name += (i ? " + " : "") + m_sources[i].name;
+        }
+        return name + ")";
+    }
+
+    void FusionEyeTracker::updateSource(Source& source, std::chrono::steady_clock::time_point now) {
+        EyeGazeSample sample;
+        bool isValid = openxr_api_layer::getGazeSample(*source.tracker, sample);
+
+        if (isValid) {
+            // Most trackers cannot tell when the data was captured. We consider that a gaze that did not change is a
+            // gaze that was not updated.
+            const bool hasChanged = !source.hasSample || sample.gaze.x != source.lastSample.gaze.x ||
+                                    sample.gaze.y != source.lastSample.gaze.y ||
+                                    sample.gaze.z != source.lastSample.gaze.z;
+            if (hasChanged) {
+                // The jitter is the high-frequency part of the movement only, so that saccades are not penalized.
+                std::rotate(source.recentGazes.begin(), source.recentGazes.begin() + 1, source.recentGazes.end());
+                source.recentGazes.back() = sample.gaze;
+                source.recentGazeCount = std::min(source.recentGazeCount + 1, source.recentGazes.size());
+                if (source.recentGazeCount == source.recentGazes.size()) {
+                    source.jitterDegrees +=
+                        (medianResidualDegrees(source.recentGazes) - source.jitterDegrees) * StatisticsSmoothing;
+                }
+                source.lastChangeTime = std::min(sample.time, now);
+            }
+            source.lastSample = sample;
+            source.hasSample = true;
+
+            if (now - source.lastChangeTime > MaxSampleAge) {
+                isValid = false;
+            }
+        }
+        source.validityRate += ((isValid ? 1.f : 0.f) - source.validityRate) * StatisticsSmoothing;
+
+        if (!isValid) {
+            source.score = 0.f;
+            return;
+        }
+
+        const float age = std::chrono::duration<float>(now - source.lastChangeTime).count();
+        const float freshness = std::exp(-age / std::chrono::duration<float>(FreshnessTimeConstant).count());
+        const float stability = 1.f / (1.f + source.jitterDegrees / ReferenceJitterDegrees);
+        source.score = freshness * source.validityRate * stability * std::clamp(sample.confidence, 0.f, 1.f);
+    }
+
+    bool FusionEyeTracker::getGazeSample(EyeGazeSample& sample) {
+        TraceLocalActivity(local);
+
+        TraceLoggingWriteStart(local, "FusionEyeTracker_GetGazeSample");
+
+        // Every source must be polled for each sample, otherwise we could not tell the fresh ones from the stale ones.
+        const auto now = std::chrono::steady_clock::now();
+        for (auto& source : m_sources) {
+            updateSource(source, now);
+        }
+
+        bool isValid = false;
+        if (m_mode == Mode::Select) {
+            std::optional<size_t> best;
+            for (size_t i = 0; i < m_sources.size(); i++) {
+                if (m_sources[i].score > 0.f && (!best || m_sources[i].score > m_sources[best.value()].score)) {
+                    best = i;
+                }
+            }
+
+            if (best && m_selected && best != m_selected && m_sources[m_selected.value()].score > 0.f &&
+                m_sources[best.value()].score < m_sources[m_selected.value()].score * SwitchHysteresis) {
+                best = m_selected;
+            }
+
+            if (best != m_selected) {
+                TraceLoggingWrite(g_traceProvider,
+                                  "FusionEyeTracker_Switch",
+                                  TLArg(best ? m_sources[best.value()].name.c_str() : "", "Source"),
+                                  TLArg(best ? m_sources[best.value()].score : 0.f, "Score"));
+                if (best) {
+                    Log(fmt::format("Fusion: switching to {}\n", m_sources[best.value()].name));
+                }
+                m_selected = best;
+            }
+
+            // The sample keeps the confidence reported by its source. The score is only meant to rank the sources.
+            if (best) {
+                sample = m_sources[best.value()].lastSample;
+                isValid = true;
+            }
+        } else {
+            XrVector3f sum{};
+            float totalWeight = 0.f;
+            float confidence = 0.f;
+            for (const auto& source : m_sources) {
+                if (source.score <= 0.f) {
+                    continue;
+                }
+                sum.x += source.lastSample.gaze.x * source.score;
+                sum.y += source.lastSample.gaze.y * source.score;
+                sum.z += source.lastSample.gaze.z * source.score;
+                confidence += source.lastSample.confidence * source.score;
+                totalWeight += source.score;
+                sample.time = std::max(sample.time, source.lastChangeTime);
+            }
+
+            // Like the gaze, the confidence is the weighted average of the ones reported by the sources.
+            const float length = std::sqrt(sum.x * sum.x + sum.y * sum.y + sum.z * sum.z);
+            if (totalWeight > 0.f && length > 0.f) {
+                sample.gaze = {sum.x / length, sum.y / length, sum.z / length};
+                sample.confidence = confidence / totalWeight;
+                isValid = true;
+            }
+        }
+
+        TraceLoggingWriteStop(local, "FusionEyeTracker_GetGazeSample", TLArg(isValid, "Valid"));
+
+        return isValid;
+    }
+
+} // namespace openxr_api_layer
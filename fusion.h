@@ -0,0 +1,77 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include "eye_tracker.h"
+#include "probe.h"
+
+namespace openxr_api_layer {
+
+    // Runs several eye trackers side by side and produces a single gaze from them. Each source is scored on the
+    // freshness of its data, its validity rate and its jitter.
+    class FusionEyeTracker : public LocalEyeTracker {
+      public:
+        enum class Mode {
+            // Use the source with the best score for each sample.
+            Select = 1,
+
+            // Average all the valid sources, weighted by their score.
+            Blend = 2,
+        };
+
+        FusionEyeTracker(std::vector<ProbeResult> sources, Mode mode);
+
+        void start(XrSession session) override;
+        void stop() override;
+
+        std::string getName() const override;
+        bool getGazeSample(EyeGazeSample& sample) override;
+
+      private:
+        struct Source {
+            std::unique_ptr<IEyeTracker> tracker;
+            std::string name;
+
+            // Running statistics, updated for each sample.
+            float validityRate{1.f};
+            float jitterDegrees{0.f};
+
+            // The last gazes that changed, oldest first, to estimate the noise.
+            std::array<XrVector3f, 3> recentGazes{};
+            size_t recentGazeCount{0};
+            bool hasSample{false};
+            EyeGazeSample lastSample;
+            std::chrono::steady_clock::time_point lastChangeTime{};
+
+            float score{0.f};
+        };
+
+        void updateSource(Source& source, std::chrono::steady_clock::time_point now);
+
+        const Mode m_mode;
+        std::vector<Source> m_sources;
+        std::optional<size_t> m_selected;
+    };
+
+} // namespace openxr_api_layer
@@ -0,0 +1,323 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Reference sender for the binary UDP gaze protocol (pvremu_gaze_udp.h), with a loopback benchmark.
+//
+// Usage:
+//   gaze-udp-sender [--address <ip>] [--port <port>] [--rate <hz>] [--duration <seconds>]
+//       Send a synthetic gaze, slowly sweeping the field of view.
+//   gaze-udp-sender --bench [--address <ip>] [--port <port>] [--count <packets>]
+//       Measure the one-way latency and the throughput of the protocol through the local network stack.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <pvremu_gaze_udp.h>
+
+#ifdef _WIN32
+#include <timeapi.h>
+#else
+#define closesocket close
+using SOCKET = int;
+constexpr SOCKET INVALID_SOCKET = -1;
+#endif
+
+namespace {
+
+    struct Options {
+        std::string address = pvremu::GazeUdpDefaultMulticastGroup;
+        uint16_t port = pvremu::GazeUdpDefaultPort;
+        double rate = 250.0;
+        double duration = 0.0;
+        bool bench = false;
+        uint32_t count = 200000;
+    };
+
+    bool parseOptions(int argc, char** argv, Options& options) {
+        for (int i = 1; i < argc; i++) {
+            const std::string arg = argv[i];
+            const bool hasValue = i + 1 < argc;
+            if (arg == "--bench") {
+                options.bench = true;
+            } else if (arg == "--address" && hasValue) {
+                options.address = argv[++i];
+            } else if (arg == "--port" && hasValue) {
+                options.port = (uint16_t)std::atoi(argv[++i]);
+            } else if (arg == "--rate" && hasValue) {
+                options.rate = std::atof(argv[++i]);
+            } else if (arg == "--duration" && hasValue) {
+                options.duration = std::atof(argv[++i]);
+            } else if (arg == "--count" && hasValue) {
+                options.count = (uint32_t)std::atoi(argv[++i]);
+            } else {
+                return false;
+            }
+        }
+        return options.rate > 0 && options.count > 0;
+    }
+
+    void sleepUntil(int64_t deadlineNs) {
+        // Sleep for the bulk of the wait, then spin: the OS scheduler granularity is too coarse for kHz rates.
+        while (true) {
+            const int64_t remaining = deadlineNs - pvremu_now_ns();
+            if (remaining <= 0) {
+                return;
+            }
+            if (remaining > 2'000'000) {
+                std::this_thread::sleep_for(std::chrono::nanoseconds(remaining - 1'000'000));
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    pvremu::GazeSample makeSample(double time) {
+        pvremu::GazeSample sample{};
+        sample.timestampNs = pvremu_now_ns();
+
+        // Sweep +/-20 degrees horizontally and +/-10 degrees vertically.
+        const float yaw = (float)(0.35 * std::sin(time * 0.7));
+        const float pitch = (float)(0.17 * std::sin(time * 1.1));
+        for (int eye = 0; eye < 2; eye++) {
+            sample.gaze[eye][0] = std::sin(yaw) * std::cos(pitch);
+            sample.gaze[eye][1] = std::sin(pitch);
+            sample.gaze[eye][2] = -std::cos(yaw) * std::cos(pitch);
+            sample.openness[eye] = 1.f;
+            sample.confidence[eye] = 1.f;
+        }
+        sample.flags = pvremu::GazeSampleFlags_LeftValid | pvremu::GazeSampleFlags_RightValid;
+        return sample;
+    }
+
+    int runSender(const Options& options) {
+        pvremu::GazeUdpSender sender;
+        if (!sender.open(options.address.c_str(), options.port)) {
+            std::fprintf(stderr, "Failed to open %s:%u\n", options.address.c_str(), options.port);
+            return 1;
+        }
+
+        std::printf("Sending to %s:%u at %.0f Hz\n", options.address.c_str(), options.port, options.rate);
+        const int64_t start = pvremu_now_ns();
+        const int64_t periodNs = (int64_t)(1e9 / options.rate);
+        for (uint64_t i = 0;; i++) {
+            const int64_t deadline = start + (int64_t)i * periodNs;
+            if (options.duration > 0 && deadline - start >= (int64_t)(options.duration * 1e9)) {
+                break;
+            }
+            sleepUntil(deadline);
+            sender.send(makeSample((deadline - start) / 1e9));
+        }
+        return 0;
+    }
+
+    SOCKET openReceiver(const Options& options) {
+        const SOCKET sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (sock == INVALID_SOCKET) {
+            return INVALID_SOCKET;
+        }
+
+        const int reuseAddress = 1;
+        const int bufferSize = 4 * 1024 * 1024;
+        setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuseAddress), sizeof(reuseAddress));
+        setsockopt(sock, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char*>(&bufferSize), sizeof(bufferSize));
+
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        address.sin_port = htons(options.port);
+        if (bind(sock, reinterpret_cast<const sockaddr*>(&address), sizeof(address))) {
+            closesocket(sock);
+            return INVALID_SOCKET;
+        }
+
+        ip_mreq membership{};
+        membership.imr_interface.s_addr = htonl(INADDR_ANY);
+        if (inet_pton(AF_INET, options.address.c_str(), &membership.imr_multiaddr) == 1 &&
+            IN_MULTICAST(ntohl(membership.imr_multiaddr.s_addr))) {
+            setsockopt(
+                sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, reinterpret_cast<const char*>(&membership), sizeof(membership));
+        }
+
+        // Let the receiver notice when the sender is done.
+#ifdef _WIN32
+        const DWORD timeout = 500;
+#else
+        const timeval timeout{0, 500'000};
+#endif
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+        return sock;
+    }
+
+    struct PhaseResult {
+        uint32_t received{0};
+        uint32_t outOfOrder{0};
+        std::vector<int64_t> latenciesNs;
+        int64_t firstNs{0};
+        int64_t lastNs{0};
+    };
+
+    // Receive until the sender goes quiet, like the PvrEmu listener does (decode, then sequence check).
+    void receivePhase(SOCKET sock, uint32_t expected, PhaseResult& result) {
+        result.latenciesNs.reserve(expected);
+        bool hasSequence = false;
+        uint32_t lastSequence = 0;
+        uint8_t buffer[pvremu::GazePacketSize + 1];
+        while (result.received < expected) {
+            const int received = recv(sock, reinterpret_cast<char*>(buffer), (int)sizeof(buffer), 0);
+            if (received < 0) {
+                break;
+            }
+            const int64_t now = pvremu_now_ns();
+
+            pvremu::GazeSample sample;
+            uint32_t sequence;
+            if (!pvremu::decodeGazePacket(buffer, received, sample, sequence)) {
+                continue;
+            }
+            if (hasSequence && !pvremu::isGazeSequenceNewer(sequence, lastSequence)) {
+                result.outOfOrder++;
+                continue;
+            }
+            hasSequence = true;
+            lastSequence = sequence;
+
+            if (!result.received) {
+                result.firstNs = now;
+            }
+            result.lastNs = now;
+            result.received++;
+            result.latenciesNs.push_back(now - sample.timestampNs);
+        }
+    }
+
+    void printPhase(const char* name, uint32_t sent, double sendSeconds, PhaseResult& result) {
+        std::printf("%s\n", name);
+        std::printf("  sent %u packets in %.3f s (%.0f packets/s)\n", sent, sendSeconds, sent / sendSeconds);
+        const double receiveSeconds = (result.lastNs - result.firstNs) / 1e9;
+        std::printf("  received %u packets (%.2f%% lost, %u out of order), %.0f packets/s, %.1f MB/s\n",
+                    result.received,
+                    100.0 * (sent - std::min(sent, result.received)) / sent,
+                    result.outOfOrder,
+                    receiveSeconds > 0 ? result.received / receiveSeconds : 0.0,
+                    receiveSeconds > 0 ? result.received * pvremu::GazePacketSize / receiveSeconds / 1e6 : 0.0);
+
+        auto& latencies = result.latenciesNs;
+        if (latencies.empty()) {
+            return;
+        }
+        std::sort(latencies.begin(), latencies.end());
+        const auto percentile = [&](double p) {
+            return latencies[std::min(latencies.size() - 1, (size_t)(p * latencies.size()))] / 1e3;
+        };
+        std::printf("  latency (us): min %.1f, median %.1f, p99 %.1f, p99.9 %.1f, max %.1f\n",
+                    latencies.front() / 1e3,
+                    percentile(0.5),
+                    percentile(0.99),
+                    percentile(0.999),
+                    latencies.back() / 1e3);
+    }
+
+    int runBenchmark(const Options& options) {
+        const SOCKET sock = openReceiver(options);
+        if (sock == INVALID_SOCKET) {
+            std::fprintf(stderr, "Failed to listen on port %u\n", options.port);
+            return 1;
+        }
+
+        pvremu::GazeUdpSender sender;
+        if (!sender.open(options.address.c_str(), options.port)) {
+            std::fprintf(stderr, "Failed to open %s:%u\n", options.address.c_str(), options.port);
+            closesocket(sock);
+            return 1;
+        }
+
+        std::printf("Benchmarking %s:%u over the local network stack\n", options.address.c_str(), options.port);
+
+        // Latency at a realistic rate, so that queuing does not dominate the measurement.
+        {
+            const uint32_t count = std::min(options.count, 5000u);
+            PhaseResult result;
+            std::thread receiver([&]() { receivePhase(sock, count, result); });
+            const int64_t start = pvremu_now_ns();
+            for (uint32_t i = 0; i < count; i++) {
+                sleepUntil(start + (int64_t)i * 1'000'000);
+                sender.send(makeSample(i / 1000.0));
+            }
+            const double seconds = (pvremu_now_ns() - start) / 1e9;
+            receiver.join();
+            printPhase("Paced at 1000 Hz:", count, seconds, result);
+        }
+
+        // Throughput: send as fast as possible.
+        {
+            PhaseResult result;
+            std::thread receiver([&]() { receivePhase(sock, options.count, result); });
+            const int64_t start = pvremu_now_ns();
+            for (uint32_t i = 0; i < options.count; i++) {
+                sender.send(makeSample(i / 1000.0));
+            }
+            const double seconds = (pvremu_now_ns() - start) / 1e9;
+            receiver.join();
+            printPhase("Unpaced:", options.count, seconds, result);
+        }
+
+        closesocket(sock);
+        return 0;
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::fprintf(stderr,
+                     "Usage: %s [--bench] [--address <ip>] [--port <port>] [--rate <hz>] [--duration <seconds>] "
+                     "[--count <packets>]\n",
+                     argv[0]);
+        return 1;
+    }
+
+#ifdef _WIN32
+    // Keep the sender alive for the lifetime of the program, the receiver of the benchmark needs Winsock too.
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData)) {
+        return 1;
+    }
+    timeBeginPeriod(1);
+#endif
+
+    const int result = options.bench ? runBenchmark(options) : runSender(options);
+
+#ifdef _WIN32
+    timeEndPeriod(1);
+    WSACleanup();
+#endif
+    return result;
+}
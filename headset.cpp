@@ -0,0 +1,422 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "headset.h"
+
+#include "log.h"
+using namespace openxr_api_layer::log;
+
+namespace openxr_api_layer {
+
+    namespace {
+
+        // How often to look for changes in the headset properties. We cannot use IVRSystem::PollNextEvent() from
+        // inside the application's process, since it would steal the events from the application's own queue.
+        constexpr auto WatcherPeriod = std::chrono::milliseconds(500);
+
+        // The IPD to use when the runtime does not report any.
+        constexpr float DefaultIpd = 0.063f;
+
+        // The render target size to use when the runtime does not report any.
+        constexpr uint32_t DefaultRenderTargetSize = 2160;
+
+        // How many points to sample on the lens distortion, along each axis.
+        constexpr uint32_t DistortionSamples = 65;
+
+        // How many times to alternate between the horizontal and the vertical axis when looking for the optical center.
+        constexpr uint32_t OpticalCenterPasses = 3;
+
+        // Below this variation of the magnification across the display, there is no distortion to locate the optical
+        // center from.
+        constexpr float MinMagnificationVariation = 1.001f;
+
+        float toDegrees(float radians) {
+            return radians * 180.f / (float)M_PI;
+        }
+
+        pvrQuatf quaternionFromMatrix(const vr::HmdMatrix34_t& matrix) {
+            const auto& m = matrix.m;
+            pvrQuatf q;
+            const float trace = m[0][0] + m[1][1] + m[2][2];
+            if (trace > 0.f) {
+                const float s = 0.5f / sqrtf(trace + 1.f);
+                q.w = 0.25f / s;
+                q.x = (m[2][1] - m[1][2]) * s;
+                q.y = (m[0][2] - m[2][0]) * s;
+                q.z = (m[1][0] - m[0][1]) * s;
+            } else if (m[0][0] > m[1][1] && m[0][0] > m[2][2]) {
+                const float s = 2.f * sqrtf(1.f + m[0][0] - m[1][1] - m[2][2]);
+                q.w = (m[2][1] - m[1][2]) / s;
+                q.x = 0.25f * s;
+                q.y = (m[0][1] + m[1][0]) / s;
+                q.z = (m[0][2] + m[2][0]) / s;
+            } else if (m[1][1] > m[2][2]) {
+                const float s = 2.f * sqrtf(1.f + m[1][1] - m[0][0] - m[2][2]);
+                q.w = (m[0][2] - m[2][0]) / s;
+                q.x = (m[0][1] + m[1][0]) / s;
+                q.y = 0.25f * s;
+                q.z = (m[1][2] + m[2][1]) / s;
+            } else {
+                const float s = 2.f * sqrtf(1.f + m[2][2] - m[0][0] - m[1][1]);
+                q.w = (m[1][0] - m[0][1]) / s;
+                q.x = (m[0][2] + m[2][0]) / s;
+                q.y = (m[1][2] + m[2][1]) / s;
+                q.z = 0.25f * s;
+            }
+            return q;
+        }
+
+        // Rotate a vector by the inverse of a unit quaternion.
+        XrVector3f inverseRotate(const pvrQuatf& q, const XrVector3f& v) {
+            // t = 2 * cross(-q.xyz, v)
+            const float tx = 2.f * (-q.y * v.z + q.z * v.y);
+            const float ty = 2.f * (-q.z * v.x + q.x * v.z);
+            const float tz = 2.f * (-q.x * v.y + q.y * v.x);
+            // v' = v + w * t + cross(-q.xyz, t)
+            return {v.x + q.w * tx + (-q.y * tz + q.z * ty),
+                    v.y + q.w * ty + (-q.z * tx + q.x * tz),
+                    v.z + q.w * tz + (-q.x * ty + q.y * tx)};
+        }
+
+    } // namespace
+
+    bool HeadsetProperties::Signature::operator==(const Signature& other) const {
+        return isConnected == other.isConnected &&
+               !memcmp(renderTargetSize, other.renderTargetSize, sizeof(renderTargetSize)) &&
+               !memcmp(projection, other.projection, sizeof(projection)) &&
+               !memcmp(eyeToHead, other.eyeToHead, sizeof(eyeToHead)) && ipd == other.ipd;
+    }
+
+    HeadsetProperties::HeadsetProperties(vr::IVRSystem* system) : m_system(system) {
+        TraceLocalActivity(local);
+
+        TraceLoggingWriteStart(local, "HeadsetProperties_Create");
+
+        if (m_system) {
+            m_signature = readSignature();
+        }
+        computeSnapshot(m_current);
+        m_pending = m_current;
+
+        if (m_system) {
+            m_watcherThread = std::thread([&]() { watcherThread(); });
+        }
+
+        TraceLoggingWriteStop(local, "HeadsetProperties_Create");
+    }
+
+    HeadsetProperties::~HeadsetProperties() {
+        if (m_watcherThread.joinable()) {
+            {
+                std::unique_lock lock(m_watcherMutex);
+                m_stopWatcher = true;
+            }
+            m_watcherWakeup.notify_all();
+            m_watcherThread.join();
+        }
+    }
+
+    void HeadsetProperties::getEyeRenderInfo(pvrEyeType eye, pvrEyeRenderInfo& info) {
+        std::unique_lock lock(m_mutex);
+
+        // Only pick up a new snapshot when the application queries the left eye, so that both eyes of a given frame are
+        // always answered from the same snapshot.
+        if (eye == pvrEye_Left && m_currentGeneration != m_pendingGeneration) {
+            m_current = m_pending;
+            m_currentGeneration = m_pendingGeneration;
+            TraceLoggingWrite(g_traceProvider, "HeadsetProperties_Refresh", TLArg(m_currentGeneration, "Generation"));
+        }
+
+        info = m_current.eyeRenderInfo[eye];
+    }
+
+    void HeadsetProperties::getGazeTangents(const XrVector3f& gaze, pvrVector2f (&gazeTan)[2]) {
+        std::unique_lock lock(m_mutex);
+
+        for (uint32_t eye = 0; eye < 2; eye++) {
+            // Bring the gaze vector into the eye's coordinate system. Our gaze vector is normalized, and using its
+            // components directly as tangents works well-enough.
+            const XrVector3f eyeGaze = inverseRotate(m_current.eyeRenderInfo[eye].HmdToEyePose.Orientation, gaze);
+            gazeTan[eye] = {eyeGaze.x, eyeGaze.y};
+        }
+    }
+
+    void HeadsetProperties::getFixedFoveationCenters(pvrVector2f (&gazeTan)[2]) {
+        std::unique_lock lock(m_mutex);
+
+        for (uint32_t eye = 0; eye < 2; eye++) {
+            gazeTan[eye] = m_current.fixedFoveationCenter[eye];
+        }
+    }
+
+    HeadsetProperties::Signature HeadsetProperties::readSignature() const {
+        Signature signature;
+
+        signature.isConnected = m_system->IsTrackedDeviceConnected(vr::k_unTrackedDeviceIndex_Hmd);
+        m_system->GetRecommendedRenderTargetSize(&signature.renderTargetSize[0], &signature.renderTargetSize[1]);
+        for (uint32_t eye = 0; eye < 2; eye++) {
+            m_system->GetProjectionRaw((vr::EVREye)eye,
+                                       &signature.projection[eye][0],
+                                       &signature.projection[eye][1],
+                                       &signature.projection[eye][2],
+                                       &signature.projection[eye][3]);
+            signature.eyeToHead[eye] = m_system->GetEyeToHeadTransform((vr::EVREye)eye);
+        }
+        signature.ipd =
+            m_system->GetFloatTrackedDeviceProperty(vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_UserIpdMeters_Float);
+
+        return signature;
+    }
+
+    void HeadsetProperties::computeSnapshot(Snapshot& snapshot) const {
+        for (uint32_t eye = 0; eye < 2; eye++) {
+            pvrEyeRenderInfo& info = snapshot.eyeRenderInfo[eye];
+
+            // It's unclear exactly which fields LibMagic actually needs, so we just populate them all.
+            // Refine parameters if we can. This will produce a better outcome (proper eye convergence).
+            if (m_system) {
+                float bottom, left, right, top;
+                // Note that top and bottom are swapped (empirical mistake in OpenVR?).
+                m_system->GetProjectionRaw((vr::EVREye)eye, &left, &right, &bottom, &top);
+                info.Fov.DownTan = (float)abs(bottom);
+                info.Fov.LeftTan = (float)abs(left);
+                info.Fov.RightTan = (float)abs(right);
+                info.Fov.UpTan = (float)abs(top);
+            } else {
+                info.Fov.DownTan = info.Fov.LeftTan = info.Fov.RightTan = info.Fov.UpTan = (float)tan(M_PI_4);
+            }
+
+            // Use the resolution that the application is most likely rendering at.
+            uint32_t width = 0, height = 0;
+            if (m_system) {
+                m_system->GetRecommendedRenderTargetSize(&width, &height);
+            }
+            if (!width || !height) {
+                width = height = DefaultRenderTargetSize;
+            }
+            info.DistortedViewport.Pos = {0, 0};
+            info.DistortedViewport.Size = {(int)width, (int)height};
+
+            // The render target is a planar projection, therefore its density per unit of tangent is uniform. This is
+            // the density the application renders at, and LibMagic must be told exactly that: the lens density model
+            // below cannot change it, it only locates the optical center.
+            info.PixelsPerTanAngleAtCenter.x =
+                info.DistortedViewport.Size.w / (abs(info.Fov.LeftTan) + abs(info.Fov.RightTan));
+            info.PixelsPerTanAngleAtCenter.y =
+                info.DistortedViewport.Size.h / (abs(info.Fov.UpTan) + abs(info.Fov.DownTan));
+
+            computePixelDensity((pvrEyeType)eye, snapshot.pixelDensity[eye]);
+            computeFixedFoveation((pvrEyeType)eye, snapshot);
+
+            // Use the eye-to-head transform from the runtime, which accounts for the IPD and for canting.
+            info.HmdToEyePose.Position = {0, 0, 0};
+            info.HmdToEyePose.Orientation = {0, 0, 0, 1};
+            float ipd = 0.f;
+            if (m_system) {
+                const vr::HmdMatrix34_t eyeToHead = m_system->GetEyeToHeadTransform((vr::EVREye)eye);
+                info.HmdToEyePose.Position = {eyeToHead.m[0][3], eyeToHead.m[1][3], eyeToHead.m[2][3]};
+                info.HmdToEyePose.Orientation = quaternionFromMatrix(eyeToHead);
+
+                ipd = m_system->GetFloatTrackedDeviceProperty(vr::k_unTrackedDeviceIndex_Hmd,
+                                                              vr::Prop_UserIpdMeters_Float);
+            }
+
+            // Some drivers do not offset the eyes in their transform. Use the user IPD instead (or a sensible default).
+            if (abs(info.HmdToEyePose.Position.x) < 0.001f) {
+                if (ipd < 0.001f) {
+                    ipd = DefaultIpd;
+                }
+                info.HmdToEyePose.Position.x = (ipd / 2.f) * (eye == pvrEye_Left ? -1 : 1);
+            }
+        }
+
+        const auto& left = snapshot.eyeRenderInfo[pvrEye_Left].HmdToEyePose;
+        const auto& right = snapshot.eyeRenderInfo[pvrEye_Right].HmdToEyePose;
+        Log(fmt::format("Eye geometry: IPD {:.1f}mm, canting L: {:.1f} R: {:.1f} deg\n",
+                        (right.Position.x - left.Position.x) * 1000.f,
+                        2.f * acos(std::min(abs(left.Orientation.w), 1.f)) * 180.f / M_PI,
+                        2.f * acos(std::min(abs(right.Orientation.w), 1.f)) * 180.f / M_PI));
+        for (uint32_t eye = 0; eye < 2; eye++) {
+            const auto& info = snapshot.eyeRenderInfo[eye];
+            const auto& density = snapshot.pixelDensity[eye];
+            Log(fmt::format("Eye {}: {}x{} pixels, optical center at ({:.3f}, {:.3f}), {:.1f} PPD\n",
+                            eye == pvrEye_Left ? "L" : "R",
+                            info.DistortedViewport.Size.w,
+                            info.DistortedViewport.Size.h,
+                            density.opticalCenterTan.x,
+                            density.opticalCenterTan.y,
+                            density.centerPpd));
+            Log(fmt::format("Eye {}: fixed foveation center at ({:.3f}, {:.3f}), visible radius {:.1f} deg\n",
+                            eye == pvrEye_Left ? "L" : "R",
+                            snapshot.fixedFoveationCenter[eye].x,
+                            snapshot.fixedFoveationCenter[eye].y,
+                            snapshot.visibleRadiusDegrees[eye]));
+        }
+    }
+
+    void HeadsetProperties::computeFixedFoveation(pvrEyeType eye, Snapshot& snapshot) const {
+        float left = -1.f, right = 1.f, top = -1.f, bottom = 1.f;
+        if (m_system) {
+            // These are the tangents in OpenVR's convention, where Y points down.
+            m_system->GetProjectionRaw((vr::EVREye)eye, &left, &right, &top, &bottom);
+        }
+        const auto toTangents = [&](const vr::HmdVector2_t& uv) {
+            return XrVector2f{left + uv.v[0] * (right - left), -(top + uv.v[1] * (bottom - top))};
+        };
+
+        // The outline of the visible area tells us where the lens actually is.
+        vr::HiddenAreaMesh_t lineLoop{};
+        if (m_system) {
+            lineLoop = m_system->GetHiddenAreaMesh((vr::EVREye)eye, vr::k_eHiddenAreaMesh_LineLoop);
+        }
+
+        XrVector2f center{};
+        if (lineLoop.pVertexData && lineLoop.unTriangleCount >= 3) {
+            // Compute the centroid of the polygon (in tangent space).
+            float area = 0.f, cx = 0.f, cy = 0.f;
+            for (uint32_t i = 0; i < lineLoop.unTriangleCount; i++) {
+                const XrVector2f a = toTangents(lineLoop.pVertexData[i]);
+                const XrVector2f b = toTangents(lineLoop.pVertexData[(i + 1) % lineLoop.unTriangleCount]);
+                const float cross = a.x * b.y - b.x * a.y;
+                area += cross;
+                cx += (a.x + b.x) * cross;
+                cy += (a.y + b.y) * cross;
+            }
+            if (abs(area) > 1e-6f) {
+                center = {cx / (3.f * area), cy / (3.f * area)};
+            }
+
+            // Average distance from the center to the outline.
+            const float centerAngleX = atan(center.x), centerAngleY = atan(center.y);
+            float radius = 0.f;
+            for (uint32_t i = 0; i < lineLoop.unTriangleCount; i++) {
+                const XrVector2f p = toTangents(lineLoop.pVertexData[i]);
+                radius += toDegrees(hypot(atan(p.x) - centerAngleX, atan(p.y) - centerAngleY));
+            }
+            snapshot.visibleRadiusDegrees[eye] = radius / lineLoop.unTriangleCount;
+        } else {
+            const PixelDensity& density = snapshot.pixelDensity[eye];
+            if (density.centerPpd > 0.f && (density.opticalCenterTan.x != 0.f || density.opticalCenterTan.y != 0.f)) {
+                // Use the optical center from the lens distortion.
+                center = density.opticalCenterTan;
+            } else {
+                // Use the middle of the (possibly asymmetric) field of view.
+                center = {(left + right) / 2.f, -(top + bottom) / 2.f};
+            }
+
+            // Use the smallest half-extent of the field of view.
+            snapshot.visibleRadiusDegrees[eye] = toDegrees(std::min({atan(right) - atan(center.x),
+                                                                     atan(center.x) - atan(left),
+                                                                     atan(-top) - atan(center.y),
+                                                                     atan(center.y) - atan(-bottom)}));
+        }
+
+        snapshot.fixedFoveationCenter[eye] = {center.x, center.y};
+    }
+
+    void HeadsetProperties::computePixelDensity(pvrEyeType eye, PixelDensity& density) const {
+        density = {};
+
+        uint32_t width = DefaultRenderTargetSize, height = DefaultRenderTargetSize;
+        float left = -1.f, right = 1.f, top = -1.f, bottom = 1.f;
+        if (m_system) {
+            m_system->GetRecommendedRenderTargetSize(&width, &height);
+            // These are the tangents in OpenVR's convention, where Y points down.
+            m_system->GetProjectionRaw((vr::EVREye)eye, &left, &right, &top, &bottom);
+        }
+        const float pixelsPerTan = width / (right - left);
+
+        // Where a display position (in UV) lands on the projection plane, with Y pointing up like the gaze vector.
+        const auto distort = [&](float u, float v) {
+            vr::DistortionCoordinates_t coordinates;
+            if (!m_system || !m_system->ComputeDistortion((vr::EVREye)eye, u, v, &coordinates)) {
+                // Assume no distortion.
+                coordinates.rfGreen[0] = u;
+                coordinates.rfGreen[1] = v;
+            }
+            return XrVector2f{left + coordinates.rfGreen[0] * (right - left),
+                              -(top + coordinates.rfGreen[1] * (bottom - top))};
+        };
+
+        // The distortion stretches the display the least at the optical center of the lens. It is not necessarily the
+        // middle of the display, so search for it along each axis in turn, each time through the best position found
+        // on the other axis.
+        XrVector2f line[DistortionSamples];
+        const auto sampleLine = [&](bool isHorizontal, float position) {
+            for (uint32_t i = 0; i < DistortionSamples; i++) {
+                const float t = (float)i / (DistortionSamples - 1);
+                line[i] = isHorizontal ? distort(t, position) : distort(position, t);
+            }
+        };
+        const auto leastStretchedSample = [&]() {
+            uint32_t best = DistortionSamples / 2;
+            float smallestStep = std::numeric_limits<float>::max();
+            float largestStep = 0.f;
+            for (uint32_t i = 1; i < DistortionSamples - 1; i++) {
+                const float step = hypot(line[i + 1].x - line[i - 1].x, line[i + 1].y - line[i - 1].y);
+                largestStep = std::max(largestStep, step);
+                if (step < smallestStep) {
+                    smallestStep = step;
+                    best = i;
+                }
+            }
+            return largestStep > smallestStep * MinMagnificationVariation ? best : DistortionSamples / 2;
+        };
+        float centerU = 0.5f, centerV = 0.5f;
+        for (uint32_t pass = 0; pass < OpticalCenterPasses; pass++) {
+            const bool isHorizontal = pass % 2 == 0;
+            sampleLine(isHorizontal, isHorizontal ? centerV : centerU);
+            (isHorizontal ? centerU : centerV) = (float)leastStretchedSample() / (DistortionSamples - 1);
+        }
+
+        sampleLine(true, centerV);
+        density.opticalCenterTan = line[(uint32_t)std::lround(centerU * (DistortionSamples - 1))];
+
+        // Pixels per degree at the optical center: d(pixels)/d(angle) = pixelsPerTan * d(tan)/d(angle).
+        const float centerAngle = atan(density.opticalCenterTan.x);
+        density.centerPpd = pixelsPerTan / (cos(centerAngle) * cos(centerAngle)) * (float)M_PI / 180.f;
+    }
+
+    void HeadsetProperties::watcherThread() {
+        std::unique_lock lock(m_watcherMutex);
+        while (!m_watcherWakeup.wait_for(lock, WatcherPeriod, [&] { return m_stopWatcher; })) {
+            const Signature signature = readSignature();
+            if (signature == m_signature) {
+                continue;
+            }
+
+            Log("Headset properties changed, refreshing eye render info\n");
+            m_signature = signature;
+
+            Snapshot snapshot;
+            computeSnapshot(snapshot);
+            {
+                std::unique_lock snapshotLock(m_mutex);
+                m_pending = snapshot;
+                m_pendingGeneration++;
+            }
+        }
+    }
+
+} // namespace openxr_api_layer
@@ -0,0 +1,92 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+namespace openxr_api_layer {
+
+    // Computes the per-eye render info once and keeps it cached. A background thread watches the headset properties
+    // and recomputes the cache only when they change (IPD adjustment, new projection, driver reconnect).
+    class HeadsetProperties {
+      public:
+        HeadsetProperties(vr::IVRSystem* system);
+        ~HeadsetProperties();
+
+        void getEyeRenderInfo(pvrEyeType eye, pvrEyeRenderInfo& info);
+
+        // Convert a gaze unit vector in head space into per-eye gaze tangents, accounting for the canting of each eye.
+        void getGazeTangents(const XrVector3f& gaze, pvrVector2f (&gazeTan)[2]);
+
+        // The gaze tangents to use when there is no eye tracking data, centered on the visible area of each lens.
+        void getFixedFoveationCenters(pvrVector2f (&gazeTan)[2]);
+
+      private:
+        // Pixel density of one eye, derived from the render target size and the lens distortion. The density reported
+        // to LibMagic is the one of the render target (see computeSnapshot()), this only locates the lens.
+        struct PixelDensity {
+            // Where the optical axis of the lens crosses the projection plane.
+            XrVector2f opticalCenterTan{0.f, 0.f};
+
+            // Render target pixels per degree at the optical center.
+            float centerPpd{0.f};
+        };
+
+        // The subset of the headset properties that the render info depends on.
+        struct Signature {
+            bool isConnected{false};
+            uint32_t renderTargetSize[2]{};
+            float projection[2][4]{};
+            vr::HmdMatrix34_t eyeToHead[2]{};
+            float ipd{0.f};
+
+            bool operator==(const Signature& other) const;
+        };
+
+        struct Snapshot {
+            pvrEyeRenderInfo eyeRenderInfo[2]{};
+            PixelDensity pixelDensity[2];
+            pvrVector2f fixedFoveationCenter[2]{};
+            float visibleRadiusDegrees[2]{};
+        };
+
+        Signature readSignature() const;
+        void computeSnapshot(Snapshot& snapshot) const;
+        void computePixelDensity(pvrEyeType eye, PixelDensity& density) const;
+        void computeFixedFoveation(pvrEyeType eye, Snapshot& snapshot) const;
+        void watcherThread();
+
+        vr::IVRSystem* const m_system;
+
+        std::mutex m_mutex;
+        Snapshot m_current;
+        Snapshot m_pending;
+        uint64_t m_currentGeneration{0};
+        uint64_t m_pendingGeneration{0};
+
+        Signature m_signature;
+        std::thread m_watcherThread;
+        std::mutex m_watcherMutex;
+        std::condition_variable m_watcherWakeup;
+        bool m_stopWatcher{false};
+    };
+
+} // namespace openxr_api_layer
@@ -37,7 +37,8 @@ namespace openxr_api_layer::log {
 
     void Log(const char* fmt, ...);
     static inline void Log(const std::string_view& str) {
-        Log(str.data());
+        // Pre-formatted messages may contain '%' characters.
+        Log("%s", str.data());
     }
 
 } // namespace openxr_api_layer::log
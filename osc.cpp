@@ -0,0 +1,598 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "pch.h"
+
+#include "log.h"
+using namespace openxr_api_layer::log;
+
+#include <trackers.h>
+
+#include "osc.h"
+
+namespace openxr_api_layer::osc {
+
+    namespace {
+
+        // Bundles may nest, but nobody has a good reason to go deep.
+        constexpr int MaxBundleDepth = 4;
+
+        // VRCFaceTracking sends gaze normalized to [-1, 1], and this is the angle that avatars map to 1.
+        constexpr float NormalizedGazeRangeDegrees = 45.f;
+
+        // Below this openness, we consider the eye closed and the gaze meaningless.
+        constexpr float MinOpenness = 0.2f;
+
+        // Seconds between the OSC (NTP) epoch of 1900 and the Unix epoch.
+        constexpr uint64_t NtpToUnixEpochSeconds = 2208988800ull;
+
+        // A sender whose timetags are within this range of our wall clock is considered synchronized with us, and the
+        // age of its samples is measured directly.
+        constexpr auto MaxSynchronizedClockSkew = std::chrono::milliseconds(5);
+        constexpr auto MaxSynchronizedAge = std::chrono::seconds(1);
+
+        // Window for the minimum transit time of unsynchronized senders.
+        constexpr auto OffsetWindow = std::chrono::seconds(10);
+
+        // Samples older than this are of no use for foveation.
+        constexpr auto MaxSampleAge = std::chrono::milliseconds(500);
+
+        // A timetag going back further than this means that the sender restarted (or changed its clock).
+        constexpr auto SenderResetThreshold = std::chrono::seconds(1);
+
+        constexpr uint8_t BundleTag[8] = {'#', 'b', 'u', 'n', 'd', 'l', 'e', '\0'};
+
+        constexpr uint32_t hashAddress(std::string_view address) {
+            // FNV-1a.
+            uint32_t hash = 2166136261u;
+            for (const char c : address) {
+                hash = (hash ^ (uint8_t)c) * 16777619u;
+            }
+            return hash;
+        }
+
+        // Open addressing, sized to stay sparse.
+        class AddressTable {
+          public:
+            AddressTable() {
+                static constexpr std::pair<std::string_view, Address> native[] = {
+                    {"/tracking/eye/LeftRightPitchYaw", Address::LeftRightPitchYaw},
+                    {"/tracking/eye/CenterPitchYaw", Address::CenterPitchYaw},
+                    {"/tracking/eye/CenterVec", Address::CenterVec},
+                    {"/tracking/eye/EyesClosedAmount", Address::EyesClosedAmount},
+                };
+                for (const auto& [address, id] : native) {
+                    insert(address, id);
+                }
+
+                static constexpr std::pair<std::string_view, Address> v1[] = {
+                    {"LeftEyeX", Address::V1LeftEyeX},
+                    {"LeftEyeY", Address::V1LeftEyeY},
+                    {"RightEyeX", Address::V1RightEyeX},
+                    {"RightEyeY", Address::V1RightEyeY},
+                    {"EyesX", Address::V1EyesX},
+                    {"EyesY", Address::V1EyesY},
+                    {"LeftEyeLid", Address::V1LeftEyeLid},
+                    {"RightEyeLid", Address::V1RightEyeLid},
+                };
+                static constexpr std::pair<std::string_view, Address> v2[] = {
+                    {"v2/EyeLeftX", Address::V2EyeLeftX},
+                    {"v2/EyeLeftY", Address::V2EyeLeftY},
+                    {"v2/EyeRightX", Address::V2EyeRightX},
+                    {"v2/EyeRightY", Address::V2EyeRightY},
+                    {"v2/EyeX", Address::V2EyeX},
+                    {"v2/EyeY", Address::V2EyeY},
+                    {"v2/EyeLidLeft", Address::V2EyeLidLeft},
+                    {"v2/EyeLidRight", Address::V2EyeLidRight},
+                };
+
+                // Newer versions of VRCFaceTracking prefix the parameters with FT/.
+                for (const std::string_view prefix : {"/avatar/parameters/", "/avatar/parameters/FT/"}) {
+                    for (const auto& [parameter, id] : v1) {
+                        insert(prefix, parameter, id);
+                    }
+                    for (const auto& [parameter, id] : v2) {
+                        insert(prefix, parameter, id);
+                    }
+                }
+            }
+
+            Address lookup(std::string_view address) const {
+                const uint32_t hash = hashAddress(address);
+                for (uint32_t i = 0; i < Capacity; i++) {
+                    const Entry& entry = m_entries[(hash + i) & (Capacity - 1)];
+                    if (entry.id == Address::Unknown) {
+                        return Address::Unknown;
+                    }
+                    if (entry.hash == hash && std::string_view(entry.address, entry.length) == address) {
+                        return entry.id;
+                    }
+                }
+                return Address::Unknown;
+            }
+
+          private:
+            static constexpr uint32_t Capacity = 128;
+            static constexpr size_t MaxAddressLength = 64;
+
+            struct Entry {
+                uint32_t hash{0};
+                Address id{Address::Unknown};
+                uint8_t length{0};
+                char address[MaxAddressLength];
+            };
+
+            void insert(std::string_view address, Address id) {
+                insert(address, {}, id);
+            }
+
+            void insert(std::string_view prefix, std::string_view suffix, Address id) {
+                Entry entry;
+                assert(prefix.size() + suffix.size() <= MaxAddressLength);
+                std::copy(prefix.cbegin(), prefix.cend(), entry.address);
+                std::copy(suffix.cbegin(), suffix.cend(), entry.address + prefix.size());
+                entry.length = (uint8_t)(prefix.size() + suffix.size());
+                entry.hash = hashAddress(std::string_view(entry.address, entry.length));
+                entry.id = id;
+
+                for (uint32_t i = 0; i < Capacity; i++) {
+                    Entry& slot = m_entries[(entry.hash + i) & (Capacity - 1)];
+                    if (slot.id == Address::Unknown) {
+                        slot = entry;
+                        return;
+                    }
+                }
+                assert(false);
+            }
+
+            Entry m_entries[Capacity];
+        };
+
+        uint32_t readUint32(const uint8_t* data) {
+            return (uint32_t)data[0] << 24 | (uint32_t)data[1] << 16 | (uint32_t)data[2] << 8 | data[3];
+        }
+
+        uint64_t readUint64(const uint8_t* data) {
+            return (uint64_t)readUint32(data) << 32 | readUint32(data + 4);
+        }
+
+        // OSC strings are null-terminated and padded to 4 bytes. Returns the padded size, or 0 if malformed.
+        size_t readString(const uint8_t* data, size_t size, std::string_view& string) {
+            const auto end = static_cast<const uint8_t*>(memchr(data, '\0', size));
+            if (!end) {
+                return 0;
+            }
+            const size_t length = end - data;
+            const size_t paddedSize = (length + 4) & ~(size_t)3;
+            if (paddedSize > size) {
+                return 0;
+            }
+            string = std::string_view(reinterpret_cast<const char*>(data), length);
+            return paddedSize;
+        }
+
+        bool decodeMessage(const uint8_t* data, size_t size, uint64_t timetag, Message& message) {
+            message.timetag = timetag;
+            message.valueCount = 0;
+
+            size_t offset = readString(data, size, message.address);
+            if (!offset || message.address.empty() || message.address[0] != '/') {
+                return false;
+            }
+
+            // Very old senders omit the type tags. We cannot interpret their arguments.
+            message.typeTags = {};
+            if (offset == size) {
+                return true;
+            }
+            const size_t typeTagsSize = readString(data + offset, size - offset, message.typeTags);
+            if (!typeTagsSize || message.typeTags.empty() || message.typeTags[0] != ',') {
+                return false;
+            }
+            offset += typeTagsSize;
+            message.typeTags.remove_prefix(1);
+
+            for (const char tag : message.typeTags) {
+                const uint8_t* argument = data + offset;
+                const size_t remaining = size - offset;
+
+                std::optional<float> value;
+                size_t argumentSize = 0;
+                switch (tag) {
+                case 'i': {
+                    argumentSize = 4;
+                    if (remaining >= argumentSize) {
+                        value = (float)(int32_t)readUint32(argument);
+                    }
+                    break;
+                }
+                case 'f': {
+                    argumentSize = 4;
+                    if (remaining >= argumentSize) {
+                        const uint32_t bits = readUint32(argument);
+                        float f;
+                        memcpy(&f, &bits, sizeof(f));
+                        value = f;
+                    }
+                    break;
+                }
+                case 'h': {
+                    argumentSize = 8;
+                    if (remaining >= argumentSize) {
+                        value = (float)(int64_t)readUint64(argument);
+                    }
+                    break;
+                }
+                case 'd': {
+                    argumentSize = 8;
+                    if (remaining >= argumentSize) {
+                        const uint64_t bits = readUint64(argument);
+                        double d;
+                        memcpy(&d, &bits, sizeof(d));
+                        value = (float)d;
+                    }
+                    break;
+                }
+                case 'T':
+                    value = 1.f;
+                    break;
+                case 'F':
+                    value = 0.f;
+                    break;
+                case 'N':
+                case 'I':
+                case '[':
+                case ']':
+                    break;
+                case 'c':
+                case 'r':
+                case 'm':
+                    argumentSize = 4;
+                    break;
+                case 't':
+                    argumentSize = 8;
+                    break;
+                case 's':
+                case 'S': {
+                    std::string_view string;
+                    argumentSize = readString(argument, remaining, string);
+                    if (!argumentSize) {
+                        return false;
+                    }
+                    break;
+                }
+                case 'b': {
+                    if (remaining < 4) {
+                        return false;
+                    }
+                    const uint32_t blobSize = readUint32(argument);
+                    if (blobSize > remaining - 4) {
+                        return false;
+                    }
+                    argumentSize = 4 + ((blobSize + 3) & ~(size_t)3);
+                    break;
+                }
+                default:
+                    // We cannot skip an argument of unknown size.
+                    return false;
+                }
+
+                if (argumentSize > remaining) {
+                    return false;
+                }
+                offset += argumentSize;
+
+                if (value && message.valueCount < MaxArguments) {
+                    message.values[message.valueCount++] = value.value();
+                }
+            }
+
+            return true;
+        }
+
+        bool decodeElement(const uint8_t* data,
+                           size_t size,
+                           uint64_t timetag,
+                           int depth,
+                           MessageCallback onMessage,
+                           void* context) {
+            if (size < 4 || size % 4) {
+                return false;
+            }
+
+            if (size >= sizeof(BundleTag) && memcmp(data, BundleTag, sizeof(BundleTag)) == 0) {
+                if (depth >= MaxBundleDepth || size < 16) {
+                    return false;
+                }
+
+                const uint64_t bundleTimetag = readUint64(data + 8);
+                size_t offset = 16;
+                while (offset < size) {
+                    if (size - offset < 4) {
+                        return false;
+                    }
+                    const uint32_t elementSize = readUint32(data + offset);
+                    offset += 4;
+                    if (elementSize > size - offset) {
+                        return false;
+                    }
+                    if (!decodeElement(data + offset, elementSize, bundleTimetag, depth + 1, onMessage, context)) {
+                        return false;
+                    }
+                    offset += elementSize;
+                }
+                return true;
+            }
+
+            Message message;
+            if (!decodeMessage(data, size, timetag, message)) {
+                return false;
+            }
+            onMessage(context, message);
+            return true;
+        }
+
+        std::chrono::nanoseconds timetagToDuration(uint64_t timetag) {
+            const uint64_t seconds = timetag >> 32;
+            const uint64_t fraction = ((timetag & 0xffffffffull) * 1'000'000'000ull) >> 32;
+            return std::chrono::seconds(seconds) + std::chrono::nanoseconds(fraction);
+        }
+
+        float degrees(float radians) {
+            return radians * 180.f / (float)M_PI;
+        }
+
+        float radians(float degrees) {
+            return degrees * (float)M_PI / 180.f;
+        }
+
+    } // namespace
+
+    Address lookupAddress(std::string_view address) {
+        static const AddressTable table;
+        return table.lookup(address);
+    }
+
+    bool decodePacket(const uint8_t* data, size_t size, MessageCallback onMessage, void* context) {
+        return decodeElement(data, size, 1, 0, onMessage, context);
+    }
+
+    uint64_t hashDatagram(const uint8_t* data, size_t size) {
+        // FNV-1a.
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ data[i]) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    SenderClock::Verdict SenderClock::accept(uint64_t timetag,
+                                             uint64_t datagramHash,
+                                             std::chrono::steady_clock::time_point arrival,
+                                             std::chrono::system_clock::time_point wallArrival,
+                                             std::chrono::steady_clock::time_point& sampleTime) {
+        // Another part of the newest frame, captured at the same time as the first part.
+        if (timetag == m_lastTimetag) {
+            const auto end = m_datagramHashes + m_datagramCount;
+            if (std::find(m_datagramHashes, end, datagramHash) != end) {
+                return Verdict::Duplicate;
+            }
+            if (m_datagramCount < MaxDatagramsPerTimetag) {
+                m_datagramHashes[m_datagramCount++] = datagramHash;
+            }
+            sampleTime = m_lastSampleTime;
+            return arrival - sampleTime >= MaxSampleAge ? Verdict::Stale : Verdict::Accepted;
+        }
+
+        const auto capture = timetagToDuration(timetag);
+        if (timetag < m_lastTimetag) {
+            if (timetagToDuration(m_lastTimetag) - capture < SenderResetThreshold) {
+                return Verdict::OutOfOrder;
+            }
+            m_minOffset[0].reset();
+            m_minOffset[1].reset();
+        }
+
+        // Senders on the same machine (or with NTP) share our wall clock, and give us the true age of the sample.
+        const auto wallAge = std::chrono::duration_cast<std::chrono::nanoseconds>(wallArrival.time_since_epoch()) -
+                             (capture - std::chrono::seconds(NtpToUnixEpochSeconds));
+        if (wallAge >= -MaxSynchronizedClockSkew && wallAge < MaxSynchronizedAge) {
+            sampleTime = arrival - std::max(wallAge, std::chrono::nanoseconds(0));
+        } else {
+            // Otherwise, assume that the fastest bundle seen recently had no transit time. This preserves the spacing
+            // between samples, but the age is only relative to that fastest bundle.
+            if (!m_minOffset[1] || arrival - m_offsetWindowStart >= OffsetWindow) {
+                m_minOffset[0] = m_minOffset[1];
+                m_minOffset[1].reset();
+                m_offsetWindowStart = arrival;
+            }
+            const auto offset =
+                std::chrono::duration_cast<std::chrono::nanoseconds>(arrival.time_since_epoch()) - capture;
+            if (!m_minOffset[1] || offset < m_minOffset[1].value()) {
+                m_minOffset[1] = offset;
+            }
+            const auto minOffset = m_minOffset[0] ? std::min(m_minOffset[0].value(), m_minOffset[1].value())
+                                                  : m_minOffset[1].value();
+            sampleTime = std::chrono::steady_clock::time_point(
+                std::chrono::duration_cast<std::chrono::steady_clock::duration>(capture + minOffset));
+        }
+
+        m_lastTimetag = timetag;
+        m_lastSampleTime = sampleTime;
+        m_datagramHashes[0] = datagramHash;
+        m_datagramCount = 1;
+        if (arrival - sampleTime >= MaxSampleAge) {
+            return Verdict::Stale;
+        }
+        return Verdict::Accepted;
+    }
+
+    void GazeState::setNormalized(
+        Schema schema, int eye, bool isYaw, float value, std::chrono::steady_clock::time_point time) {
+        SchemaState& state = m_schemas[schema];
+        const float angle = std::clamp(value, -1.f, 1.f) * NormalizedGazeRangeDegrees;
+        for (int i = 0; i < 2; i++) {
+            // -1 means both eyes.
+            if (eye < 0 || eye == i) {
+                (isYaw ? state.yaw : state.pitch)[i] = angle;
+            }
+        }
+        state.hasGaze = true;
+        state.gazeTime = time;
+    }
+
+    void GazeState::update(const Message& message, std::chrono::steady_clock::time_point time) {
+        const Address address = lookupAddress(message.address);
+        if (address == Address::Unknown || !message.valueCount) {
+            return;
+        }
+
+        const float* values = message.values;
+        SchemaState& native = m_schemas[Native];
+        switch (address) {
+        // VRChat uses the conventions of Unity: positive pitch looks down, and +Z is forward.
+        case Address::LeftRightPitchYaw:
+            if (message.valueCount >= 4) {
+                native.pitch[0] = -values[0];
+                native.yaw[0] = values[1];
+                native.pitch[1] = -values[2];
+                native.yaw[1] = values[3];
+                native.hasGaze = true;
+                native.gazeTime = time;
+            }
+            break;
+        case Address::CenterPitchYaw:
+            if (message.valueCount >= 2) {
+                native.pitch[0] = native.pitch[1] = -values[0];
+                native.yaw[0] = native.yaw[1] = values[1];
+                native.hasGaze = true;
+                native.gazeTime = time;
+            }
+            break;
+        case Address::CenterVec:
+            if (message.valueCount >= 3) {
+                const float horizontal = std::sqrt(values[0] * values[0] + values[2] * values[2]);
+                native.yaw[0] = native.yaw[1] = degrees(std::atan2(values[0], values[2]));
+                native.pitch[0] = native.pitch[1] = degrees(std::atan2(values[1], horizontal));
+                native.hasGaze = true;
+                native.gazeTime = time;
+            }
+            break;
+        case Address::EyesClosedAmount:
+            native.openness[0] = native.openness[1] = 1.f - values[0];
+            break;
+
+        case Address::V1LeftEyeX:
+            setNormalized(V1, 0, true, values[0], time);
+            break;
+        case Address::V1LeftEyeY:
+            setNormalized(V1, 0, false, values[0], time);
+            break;
+        case Address::V1RightEyeX:
+            setNormalized(V1, 1, true, values[0], time);
+            break;
+        case Address::V1RightEyeY:
+            setNormalized(V1, 1, false, values[0], time);
+            break;
+        case Address::V1EyesX:
+            setNormalized(V1, -1, true, values[0], time);
+            break;
+        case Address::V1EyesY:
+            setNormalized(V1, -1, false, values[0], time);
+            break;
+        case Address::V1LeftEyeLid:
+            m_schemas[V1].openness[0] = values[0];
+            break;
+        case Address::V1RightEyeLid:
+            m_schemas[V1].openness[1] = values[0];
+            break;
+
+        case Address::V2EyeLeftX:
+            setNormalized(V2, 0, true, values[0], time);
+            break;
+        case Address::V2EyeLeftY:
+            setNormalized(V2, 0, false, values[0], time);
+            break;
+        case Address::V2EyeRightX:
+            setNormalized(V2, 1, true, values[0], time);
+            break;
+        case Address::V2EyeRightY:
+            setNormalized(V2, 1, false, values[0], time);
+            break;
+        case Address::V2EyeX:
+            setNormalized(V2, -1, true, values[0], time);
+            break;
+        case Address::V2EyeY:
+            setNormalized(V2, -1, false, values[0], time);
+            break;
+        case Address::V2EyeLidLeft:
+            m_schemas[V2].openness[0] = values[0];
+            break;
+        case Address::V2EyeLidRight:
+            m_schemas[V2].openness[1] = values[0];
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    bool GazeState::getGazeSample(EyeGazeSample& sample) const {
+        // Use whichever schema the sender updated last.
+        const SchemaState* newest = nullptr;
+        for (const auto& state : m_schemas) {
+            if (state.hasGaze && (!newest || state.gazeTime > newest->gazeTime)) {
+                newest = &state;
+            }
+        }
+        if (!newest) {
+            return false;
+        }
+
+        XrVector3f gaze{};
+        uint32_t openCount = 0;
+        for (uint32_t eye = 0; eye < 2; eye++) {
+            if (newest->openness[eye] < MinOpenness) {
+                continue;
+            }
+            const float yaw = radians(newest->yaw[eye]);
+            const float pitch = radians(newest->pitch[eye]);
+            gaze.x += std::sin(yaw) * std::cos(pitch);
+            gaze.y += std::sin(pitch);
+            gaze.z += -std::cos(yaw) * std::cos(pitch);
+            openCount++;
+        }
+
+        // Both eyes closed (blinking).
+        const float length = std::sqrt(gaze.x * gaze.x + gaze.y * gaze.y + gaze.z * gaze.z);
+        if (!openCount || length <= 0.f) {
+            return false;
+        }
+
+        sample.gaze = {gaze.x / length, gaze.y / length, gaze.z / length};
+        sample.confidence = openCount / 2.f;
+        sample.time = newest->gazeTime;
+        return true;
+    }
+
+} // namespace openxr_api_layer::osc
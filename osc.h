@@ -0,0 +1,159 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include "eye_tracker.h"
+
+namespace openxr_api_layer::osc {
+
+    // Upper bound for the numeric arguments we keep from a message. Eye tracking messages have at most 4.
+    constexpr size_t MaxArguments = 8;
+
+    // Timetag of the messages that are not in a bundle, or of bundles to process "immediately".
+    constexpr uint64_t ImmediateTimetag = 1;
+
+    // A decoded message. It points into the packet, nothing is copied or allocated.
+    struct Message {
+        std::string_view address;
+        std::string_view typeTags;
+
+        // Numeric arguments (int32, float, int64, double, true/false), converted to float. Other arguments are skipped.
+        float values[MaxArguments];
+        size_t valueCount{0};
+
+        // Timetag of the enclosing bundle, or ImmediateTimetag outside of a bundle.
+        uint64_t timetag{ImmediateTimetag};
+    };
+
+    // Addresses relevant to eye tracking.
+    enum class Address : uint8_t {
+        Unknown = 0,
+
+        // VRChat native eye tracking (used by Bigscreen Beyond and Project Babble).
+        LeftRightPitchYaw,
+        CenterPitchYaw,
+        CenterVec,
+        EyesClosedAmount,
+
+        // VRCFaceTracking v1 avatar parameters.
+        V1LeftEyeX,
+        V1LeftEyeY,
+        V1RightEyeX,
+        V1RightEyeY,
+        V1EyesX,
+        V1EyesY,
+        V1LeftEyeLid,
+        V1RightEyeLid,
+
+        // VRCFaceTracking v2 (Unified Expressions) avatar parameters.
+        V2EyeLeftX,
+        V2EyeLeftY,
+        V2EyeRightX,
+        V2EyeRightY,
+        V2EyeX,
+        V2EyeY,
+        V2EyeLidLeft,
+        V2EyeLidRight,
+
+        Count
+    };
+
+    // Address lookup with a precomputed hash table: one hash and (usually) one comparison per message.
+    Address lookupAddress(std::string_view address);
+
+    using MessageCallback = void (*)(void* context, const Message& message);
+
+    // Decode a packet (message or bundle), and invoke the callback with each message in order. Returns false if the
+    // packet is malformed (messages before the error were still delivered).
+    bool decodePacket(const uint8_t* data, size_t size, MessageCallback onMessage, void* context);
+
+    template <typename Callback>
+    bool decodePacket(const uint8_t* data, size_t size, Callback&& onMessage) {
+        return decodePacket(
+            data,
+            size,
+            [](void* context, const Message& message) {
+                (*static_cast<std::remove_reference_t<Callback>*>(context))(message);
+            },
+            &onMessage);
+    }
+
+    // Identifies a datagram for SenderClock::accept().
+    uint64_t hashDatagram(const uint8_t* data, size_t size);
+
+    // Converts the bundle timetags of one sender to our clock, and rejects the bundles that arrive late or twice.
+    class SenderClock {
+      public:
+        enum class Verdict { Accepted, Duplicate, OutOfOrder, Stale, Count };
+
+        // Returns the verdict for a bundle, and on acceptance the time at which the sender captured its content. A frame
+        // may be split across several datagrams with the same timetag: only the datagrams seen before (same hash) are
+        // duplicates, and only the timetags older than the newest one are out of order.
+        Verdict accept(uint64_t timetag,
+                       uint64_t datagramHash,
+                       std::chrono::steady_clock::time_point arrival,
+                       std::chrono::system_clock::time_point wallArrival,
+                       std::chrono::steady_clock::time_point& sampleTime);
+
+      private:
+        // Senders split a frame into a few datagrams at most, beyond that we cannot detect the repeats.
+        static constexpr size_t MaxDatagramsPerTimetag = 16;
+
+        uint64_t m_lastTimetag{0};
+        std::chrono::steady_clock::time_point m_lastSampleTime{};
+        uint64_t m_datagramHashes[MaxDatagramsPerTimetag]{};
+        size_t m_datagramCount{0};
+
+        // Smallest difference between the arrival time and the timetag, for senders whose clock is not synchronized
+        // with ours. Tracked over two consecutive windows to follow clock drift.
+        std::optional<std::chrono::nanoseconds> m_minOffset[2];
+        std::chrono::steady_clock::time_point m_offsetWindowStart{};
+    };
+
+    // Gaze reconstructed from the eye tracking messages, whichever schema the sender uses.
+    class GazeState {
+      public:
+        void update(const Message& message, std::chrono::steady_clock::time_point time);
+        bool getGazeSample(EyeGazeSample& sample) const;
+
+      private:
+        enum Schema { Native, V1, V2, SchemaCount };
+
+        struct SchemaState {
+            // Yaw (positive to the right) and pitch (positive up) in degrees, per eye.
+            float yaw[2]{};
+            float pitch[2]{};
+            bool hasGaze{false};
+            std::chrono::steady_clock::time_point gazeTime{};
+
+            // From 0 (closed) to 1 (open).
+            float openness[2]{1.f, 1.f};
+        };
+
+        void setNormalized(Schema schema, int eye, bool isYaw, float value, std::chrono::steady_clock::time_point time);
+
+        SchemaState m_schemas[SchemaCount];
+    };
+
+} // namespace openxr_api_layer::osc
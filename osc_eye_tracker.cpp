@@ -0,0 +1,320 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "pch.h"
+
+#include "log.h"
+using namespace openxr_api_layer::log;
+
+#include <trackers.h>
+
+#include "osc.h"
+#include "osc_eye_tracker.h"
+
+namespace openxr_api_layer {
+
+    namespace {
+
+        // Senders stop sending when the user takes the headset off, do not keep using the last gaze forever.
+        constexpr auto MaxSampleAge = std::chrono::milliseconds(500);
+
+        // How often the listener thread checks whether it must exit.
+        constexpr long ReceiveTimeoutMs = 100;
+
+        // Upper bound of datagrams drained before publishing, so that a flood cannot starve the render thread.
+        constexpr int MaxBatchSize = 256;
+
+        // Room for bursts while the listener is parsing a batch.
+        constexpr int ReceiveBufferSize = 1024 * 1024;
+
+        constexpr auto StatisticsPeriod = std::chrono::seconds(10);
+
+        // Senders are told apart to order their bundles independently. There is usually only one.
+        constexpr size_t MaxSenders = 4;
+
+        uint64_t getThreadCpuTime100ns() {
+            FILETIME creationTime, exitTime, kernelTime, userTime;
+            if (!GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime)) {
+                return 0;
+            }
+            return ((uint64_t)kernelTime.dwHighDateTime << 32 | kernelTime.dwLowDateTime) +
+                   ((uint64_t)userTime.dwHighDateTime << 32 | userTime.dwLowDateTime);
+        }
+
+        class OscEyeTracker : public LocalEyeTracker {
+          public:
+            OscEyeTracker(SOCKET socket, uint16_t port) : m_socket(socket), m_port(port) {
+                m_listenerThread = std::thread([&]() { listenerThread(); });
+            }
+
+            ~OscEyeTracker() override {
+                m_stopListener = true;
+                closesocket(m_socket);
+                m_listenerThread.join();
+                WSACleanup();
+            }
+
+            void start(XrSession session) override {
+            }
+
+            void stop() override {
+            }
+
+            std::string getName() const override {
+                return fmt::format("VRChat OSC (port {})", m_port);
+            }
+
+            bool getGazeSample(EyeGazeSample& sample) override {
+                std::unique_lock lock(m_stateMutex);
+                if (!m_publishedState.getGazeSample(sample)) {
+                    return false;
+                }
+                return std::chrono::steady_clock::now() - sample.time < MaxSampleAge;
+            }
+
+          private:
+            struct Sender {
+                uint32_t address{0};
+                uint16_t port{0};
+                std::chrono::steady_clock::time_point lastSeen{};
+                osc::SenderClock clock;
+            };
+
+            // Returns the number of datagrams received, or -1 on error.
+            int drainSocket(uint8_t* buffer, size_t bufferSize, uint64_t& malformedCount) {
+                int count = 0;
+                while (count < MaxBatchSize) {
+                    sockaddr_in from{};
+                    int fromLength = sizeof(from);
+                    const int received = recvfrom(m_socket,
+                                                  reinterpret_cast<char*>(buffer),
+                                                  (int)bufferSize,
+                                                  0,
+                                                  reinterpret_cast<sockaddr*>(&from),
+                                                  &fromLength);
+                    if (received < 0) {
+                        const int error = WSAGetLastError();
+                        if (error == WSAEWOULDBLOCK) {
+                            break;
+                        }
+                        // Oversized datagrams and ICMP errors from a previous send do not affect the next ones.
+                        if (error == WSAEMSGSIZE || error == WSAECONNRESET) {
+                            continue;
+                        }
+                        return -1;
+                    }
+                    count++;
+
+                    // All the datagrams of a batch are parsed into the private state, whose newest values win.
+                    const auto now = std::chrono::steady_clock::now();
+                    const auto wallNow = std::chrono::system_clock::now();
+                    Sender& sender = getSender(from, now);
+                    const uint64_t datagramHash = osc::hashDatagram(buffer, received);
+                    uint64_t currentTimetag = osc::ImmediateTimetag;
+                    bool isAccepted = true;
+                    auto sampleTime = now;
+                    if (!osc::decodePacket(buffer, received, [&](const osc::Message& message) {
+                            if (message.timetag == osc::ImmediateTimetag) {
+                                m_listenerState.update(message, now);
+                                return;
+                            }
+
+                            // Messages of the same bundle share its verdict.
+                            if (message.timetag != currentTimetag) {
+                                currentTimetag = message.timetag;
+                                const auto verdict =
+                                    sender.clock.accept(message.timetag, datagramHash, now, wallNow, sampleTime);
+                                isAccepted = verdict == osc::SenderClock::Verdict::Accepted;
+                                if (!isAccepted) {
+                                    m_droppedCount[(size_t)verdict]++;
+                                }
+                            }
+                            if (isAccepted) {
+                                m_listenerState.update(message, sampleTime);
+                            }
+                        })) {
+                        if (!malformedCount++) {
+                            Log("Received malformed OSC packet\n");
+                        }
+                    }
+                }
+                return count;
+            }
+
+            Sender& getSender(const sockaddr_in& address, std::chrono::steady_clock::time_point now) {
+                Sender* leastRecent = &m_senders[0];
+                for (auto& sender : m_senders) {
+                    if (sender.address == address.sin_addr.s_addr && sender.port == address.sin_port) {
+                        sender.lastSeen = now;
+                        return sender;
+                    }
+                    if (sender.lastSeen < leastRecent->lastSeen) {
+                        leastRecent = &sender;
+                    }
+                }
+
+                *leastRecent = {};
+                leastRecent->address = address.sin_addr.s_addr;
+                leastRecent->port = address.sin_port;
+                leastRecent->lastSeen = now;
+                return *leastRecent;
+            }
+
+            void listenerThread() {
+                TraceLocalActivity(local);
+
+                TraceLoggingWriteStart(local, "OscEyeTracker_Listener", TLArg(m_port, "Port"));
+
+                // Allocated once, large enough for any datagram.
+                constexpr size_t BufferSize = 65536;
+                auto buffer = std::make_unique<uint8_t[]>(BufferSize);
+                uint64_t malformedCount = 0;
+
+                uint64_t packetCount = 0;
+                uint64_t batchCount = 0;
+                auto statisticsStart = std::chrono::steady_clock::now();
+                uint64_t statisticsCpuTime = getThreadCpuTime100ns();
+
+                while (!m_stopListener) {
+                    // Sleep until at least one datagram is pending, then take everything that is queued.
+                    fd_set readSet;
+                    FD_ZERO(&readSet);
+                    FD_SET(m_socket, &readSet);
+                    timeval timeout{0, ReceiveTimeoutMs * 1000};
+                    const int ready = select(0, &readSet, nullptr, nullptr, &timeout);
+
+                    if (ready > 0) {
+                        const int count = drainSocket(buffer.get(), BufferSize, malformedCount);
+                        if (count > 0) {
+                            std::unique_lock lock(m_stateMutex);
+                            m_publishedState = m_listenerState;
+                        }
+                        if (count >= 0) {
+                            packetCount += count;
+                            batchCount++;
+                        } else if (!m_stopListener) {
+                            Log("OSC receive error: %d\n", WSAGetLastError());
+                            std::this_thread::sleep_for(std::chrono::milliseconds(ReceiveTimeoutMs));
+                        }
+                    } else if (ready < 0 && !m_stopListener) {
+                        Log("OSC select error: %d\n", WSAGetLastError());
+                        std::this_thread::sleep_for(std::chrono::milliseconds(ReceiveTimeoutMs));
+                    }
+
+                    // Report how much CPU the listener costs for the packet rate it sees.
+                    const auto now = std::chrono::steady_clock::now();
+                    if (now - statisticsStart >= StatisticsPeriod) {
+                        const double seconds = std::chrono::duration<double>(now - statisticsStart).count();
+                        const uint64_t cpuTime = getThreadCpuTime100ns();
+                        const double cpuPercent = (cpuTime - statisticsCpuTime) / 1e7 / seconds * 100;
+                        const double packetsPerSecond = packetCount / seconds;
+                        const double packetsPerBatch = batchCount ? (double)packetCount / batchCount : 0;
+
+                        TraceLoggingWrite(g_traceProvider,
+                                          "OscEyeTracker_Statistics",
+                                          TLArg(packetsPerSecond, "PacketsPerSecond"),
+                                          TLArg(packetsPerBatch, "PacketsPerBatch"),
+                                          TLArg(cpuPercent, "CpuPercent"));
+                        if (packetCount) {
+                            Log(fmt::format("OSC listener: {:.0f} packets/s, {:.1f} packets/batch, {:.2f}% CPU\n",
+                                            packetsPerSecond,
+                                            packetsPerBatch,
+                                            cpuPercent));
+                        }
+                        if (std::any_of(std::cbegin(m_droppedCount), std::cend(m_droppedCount), [](uint64_t count) {
+                                return count != 0;
+                            })) {
+                            using Verdict = osc::SenderClock::Verdict;
+                            TraceLoggingWrite(g_traceProvider,
+                                              "OscEyeTracker_Dropped",
+                                              TLArg(m_droppedCount[(size_t)Verdict::Duplicate], "Duplicate"),
+                                              TLArg(m_droppedCount[(size_t)Verdict::OutOfOrder], "OutOfOrder"),
+                                              TLArg(m_droppedCount[(size_t)Verdict::Stale], "Stale"));
+                            Log(fmt::format("OSC listener dropped {} duplicate, {} out-of-order, {} stale bundles\n",
+                                            m_droppedCount[(size_t)Verdict::Duplicate],
+                                            m_droppedCount[(size_t)Verdict::OutOfOrder],
+                                            m_droppedCount[(size_t)Verdict::Stale]));
+                        }
+
+                        packetCount = batchCount = 0;
+                        std::fill(std::begin(m_droppedCount), std::end(m_droppedCount), 0);
+                        statisticsStart = now;
+                        statisticsCpuTime = cpuTime;
+                    }
+                }
+
+                TraceLoggingWriteStop(local, "OscEyeTracker_Listener", TLArg(malformedCount, "MalformedCount"));
+            }
+
+            const SOCKET m_socket;
+            const uint16_t m_port;
+
+            // Only accessed by the listener thread.
+            osc::GazeState m_listenerState;
+            Sender m_senders[MaxSenders];
+            uint64_t m_droppedCount[(size_t)osc::SenderClock::Verdict::Count]{};
+
+            // Snapshot of the listener state after each batch.
+            std::mutex m_stateMutex;
+            osc::GazeState m_publishedState;
+
+            std::thread m_listenerThread;
+            std::atomic<bool> m_stopListener{false};
+        };
+
+    } // namespace
+
+    std::unique_ptr<IEyeTracker> createOscEyeTracker(uint16_t port) {
+        WSADATA wsaData;
+        if (WSAStartup(MAKEWORD(2, 2), &wsaData)) {
+            return nullptr;
+        }
+
+        const SOCKET sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (sock == INVALID_SOCKET) {
+            WSACleanup();
+            return nullptr;
+        }
+
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        address.sin_port = htons(port);
+        u_long nonBlocking = 1;
+        if (bind(sock, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) ||
+            ioctlsocket(sock, FIONBIO, &nonBlocking)) {
+            Log("Failed to listen for OSC on port %u: %d\n", port, WSAGetLastError());
+            closesocket(sock);
+            WSACleanup();
+            return nullptr;
+        }
+        setsockopt(sock,
+                   SOL_SOCKET,
+                   SO_RCVBUF,
+                   reinterpret_cast<const char*>(&ReceiveBufferSize),
+                   sizeof(ReceiveBufferSize));
+
+        return std::make_unique<OscEyeTracker>(sock, port);
+    }
+
+} // namespace openxr_api_layer
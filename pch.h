@@ -24,17 +24,22 @@
 
 // Standard library.
 #define _CRT_SECURE_NO_WARNINGS
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <cassert>
+#include <condition_variable>
 #include <cstdlib>
 #include <filesystem>
 #include <fstream>
+#include <future>
 #define _USE_MATH_DEFINES
 #include <math.h>
 #include <mutex>
 #include <optional>
 #include <string>
 #include <string_view>
+#include <thread>
 
 // MSVC intrinsics.
 #include <intrin.h>
@@ -42,6 +47,8 @@
 // Windows header files.
 #define WIN32_LEAN_AND_MEAN // Exclude rarely-used stuff from Windows headers
 #include <windows.h>
+#include <delayimp.h>
+#include <psapi.h>
 #include <TlHelp32.h>
 #include <traceloggingactivity.h>
 #include <traceloggingprovider.h>
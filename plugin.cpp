@@ -0,0 +1,148 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "pch.h"
+
+#include "log.h"
+using namespace openxr_api_layer::log;
+
+#include <trackers.h>
+#include <pvremu_eye_tracker_plugin.h>
+
+#include "eye_tracker.h"
+#include "plugin.h"
+
+namespace openxr_api_layer {
+
+    namespace {
+
+        constexpr auto PluginProbeTimeout = std::chrono::milliseconds(2000);
+
+        class PluginEyeTracker : public LocalEyeTracker {
+          public:
+            PluginEyeTracker(wil::unique_hmodule module, const pvremu_eye_tracker_plugin* plugin, void* instance)
+                : m_module(std::move(module)), m_plugin(plugin), m_instance(instance) {
+            }
+
+            ~PluginEyeTracker() override {
+                // The module is unloaded after this.
+                m_plugin->destroy(m_instance);
+            }
+
+            void start(XrSession session) override {
+                if (!m_plugin->start(m_instance)) {
+                    Log(fmt::format("Failed to start plugin {}\n", m_plugin->name));
+                }
+            }
+
+            void stop() override {
+                m_plugin->stop(m_instance);
+            }
+
+            std::string getName() const override {
+                return m_plugin->name;
+            }
+
+            bool getGazeSample(EyeGazeSample& sample) override {
+                pvremu_gaze_sample pluginSample{};
+                pluginSample.struct_size = sizeof(pluginSample);
+                if (!m_plugin->poll_sample(m_instance, &pluginSample)) {
+                    return false;
+                }
+
+                sample.gaze = {pluginSample.gaze[0], pluginSample.gaze[1], pluginSample.gaze[2]};
+                sample.confidence = pluginSample.confidence;
+
+                // Our steady_clock uses the same time base as the plugins.
+                const auto now = std::chrono::steady_clock::now();
+                sample.time = now;
+                if (pluginSample.timestamp_ns) {
+                    sample.time = std::min(now,
+                                           std::chrono::steady_clock::time_point(
+                                               std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                                   std::chrono::nanoseconds(pluginSample.timestamp_ns))));
+                }
+                return true;
+            }
+
+          private:
+            const wil::unique_hmodule m_module;
+            const pvremu_eye_tracker_plugin* const m_plugin;
+            void* const m_instance;
+        };
+
+        std::unique_ptr<IEyeTracker> createPluginEyeTracker(const std::filesystem::path& path) {
+            wil::unique_hmodule module(LoadLibraryW(path.c_str()));
+            if (!module) {
+                Log(fmt::format("Failed to load plugin {}: {}\n", path.string(), GetLastError()));
+                return nullptr;
+            }
+
+            const auto getPlugin = reinterpret_cast<pvremu_get_eye_tracker_plugin_fn>(
+                GetProcAddress(module.get(), PVREMU_EYE_TRACKER_PLUGIN_ENTRY));
+            const pvremu_eye_tracker_plugin* plugin =
+                getPlugin ? getPlugin(PVREMU_EYE_TRACKER_PLUGIN_ABI_VERSION) : nullptr;
+            if (!plugin || plugin->abi_version != PVREMU_EYE_TRACKER_PLUGIN_ABI_VERSION ||
+                plugin->struct_size < sizeof(pvremu_eye_tracker_plugin) || !plugin->name || !plugin->create ||
+                !plugin->start || !plugin->stop || !plugin->poll_sample || !plugin->destroy) {
+                Log(fmt::format("{} is not a compatible plugin\n", path.string()));
+                return nullptr;
+            }
+
+            void* instance = plugin->create();
+            if (!instance) {
+                return nullptr;
+            }
+
+            return std::make_unique<PluginEyeTracker>(std::move(module), plugin, instance);
+        }
+
+    } // namespace
+
+    std::vector<TrackerProbe> discoverEyeTrackerPlugins(const std::filesystem::path& directory) {
+        std::vector<TrackerProbe> probes;
+
+        std::error_code error;
+        for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+            if (!entry.is_regular_file() || entry.path().extension() != ".dll") {
+                continue;
+            }
+
+            const std::filesystem::path path = entry.path();
+            Log(fmt::format("Found eye tracker plugin: {}\n", path.filename().string()));
+            probes.push_back({"Plugin:" + path.stem().string(),
+                              [path]() { return createPluginEyeTracker(path); },
+                              PluginProbeTimeout,
+                              true,
+                              false});
+        }
+
+        // Make the order of the probes (hence their priority) predictable.
+        std::sort(probes.begin(), probes.end(), [](const TrackerProbe& a, const TrackerProbe& b) {
+            return a.name < b.name;
+        });
+
+        return probes;
+    }
+
+} // namespace openxr_api_layer
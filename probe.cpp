@@ -0,0 +1,327 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "log.h"
+using namespace openxr_api_layer::log;
+
+#include <trackers.h>
+
+#include "probe.h"
+
+namespace openxr_api_layer {
+
+    namespace {
+
+        // State shared between the caller and the probe threads. Probe threads may outlive the call to
+        // runProbes() when they miss their deadline.
+        struct ProbeState {
+            std::mutex mutex;
+            std::condition_variable completed;
+
+            struct Result {
+                bool isDone{false};
+                std::unique_ptr<IEyeTracker> tracker;
+            };
+            std::vector<Result> results;
+
+            // Set once the caller picked its trackers. Probes completing afterwards must clean up after themselves.
+            bool isAbandoned{false};
+        };
+
+        // The threads started for probing and teardown. They are kept joinable, so that they do not outlive the
+        // shutdown of the layer (and the unloading of the DLL and of the tracker SDKs).
+        struct BackgroundThreads {
+            std::mutex mutex;
+            std::condition_variable exited;
+
+            struct Entry {
+                std::thread thread;
+                bool isDone{false};
+            };
+            std::vector<std::unique_ptr<Entry>> entries;
+        };
+
+        BackgroundThreads& getBackgroundThreads() {
+            static BackgroundThreads threads;
+            return threads;
+        }
+
+        // Must be called with the lock held. Threads that were given up on (detached) keep their entry until they exit.
+        void reapBackgroundThreads(BackgroundThreads& threads) {
+            for (auto it = threads.entries.begin(); it != threads.entries.end();) {
+                if ((*it)->isDone) {
+                    if ((*it)->thread.joinable()) {
+                        (*it)->thread.join();
+                    }
+                    it = threads.entries.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+
+        void startBackgroundThread(std::function<void()> body) {
+            BackgroundThreads& threads = getBackgroundThreads();
+            std::unique_lock lock(threads.mutex);
+
+            // Reap the threads that already exited.
+            reapBackgroundThreads(threads);
+
+            // The entry cannot be touched by the new thread before we release the lock.
+            BackgroundThreads::Entry* entry =
+                threads.entries.emplace_back(std::make_unique<BackgroundThreads::Entry>()).get();
+            entry->thread = std::thread([body = std::move(body), entry]() {
+                body();
+
+                BackgroundThreads& threads = getBackgroundThreads();
+                std::unique_lock lock(threads.mutex);
+                entry->isDone = true;
+                threads.exited.notify_all();
+            });
+        }
+
+        void destroyInBackground(std::vector<std::unique_ptr<IEyeTracker>> trackers) {
+            if (trackers.empty()) {
+                return;
+            }
+
+            startBackgroundThread([trackers = std::make_shared<decltype(trackers)>(std::move(trackers))]() {
+                TraceLocalActivity(local);
+
+                TraceLoggingWriteStart(local, "ProbeEyeTrackers_Teardown", TLArg(trackers->size(), "Count"));
+                trackers->clear();
+                TraceLoggingWriteStop(local, "ProbeEyeTrackers_Teardown");
+            });
+        }
+
+        struct ProbeInvocation {
+            const TrackerProbe* probe;
+            std::unique_ptr<IEyeTracker> tracker;
+        };
+
+        void invokeProbe(ProbeInvocation* invocation) {
+            invocation->tracker = invocation->probe->create();
+        }
+
+        bool isDelayLoadFailure(DWORD code) {
+            return code == VcppException(ERROR_SEVERITY_ERROR, ERROR_MOD_NOT_FOUND) ||
+                   code == VcppException(ERROR_SEVERITY_ERROR, ERROR_PROC_NOT_FOUND);
+        }
+
+        // The tracker SDKs are delay-loaded, and a missing DLL is reported as a structured exception. __try cannot be
+        // used in a function that needs C++ object unwinding, hence the indirection through invokeProbe().
+        bool invokeProbeWithDelayLoadGuard(ProbeInvocation* invocation) {
+            __try {
+                invokeProbe(invocation);
+                return true;
+            } __except (isDelayLoadFailure(GetExceptionCode()) ? EXCEPTION_EXECUTE_HANDLER
+                                                               : EXCEPTION_CONTINUE_SEARCH) {
+                return false;
+            }
+        }
+
+        std::vector<ProbeResult> runProbes(const std::vector<TrackerProbe>& probes, bool stopAtFirst) {
+            TraceLocalActivity(local);
+
+            TraceLoggingWriteStart(
+                local, "ProbeEyeTrackers", TLArg(probes.size(), "Count"), TLArg(stopAtFirst, "StopAtFirst"));
+
+            const auto start = std::chrono::steady_clock::now();
+
+            auto state = std::make_shared<ProbeState>();
+            state->results.resize(probes.size());
+
+            const auto runProbe = [state, start](size_t i, const TrackerProbe& probe) {
+                TraceLocalActivity(local);
+
+                TraceLoggingWriteStart(local, "ProbeEyeTracker", TLArg(probe.name.c_str(), "Name"));
+
+                std::unique_ptr<IEyeTracker> tracker = createEyeTracker(probe);
+
+                const auto duration =
+                    std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+                Log(fmt::format(
+                    "Probed {} in {}ms: {}\n", probe.name, duration.count(), tracker ? "found" : "not found"));
+
+                TraceLoggingWriteStop(
+                    local, "ProbeEyeTracker", TLArg(!!tracker, "Found"), TLArg(duration.count(), "DurationMs"));
+
+                std::unique_lock lock(state->mutex);
+                if (state->isAbandoned) {
+                    // Nobody is waiting for us anymore.
+                    lock.unlock();
+                    tracker.reset();
+                    return;
+                }
+                state->results[i].isDone = true;
+                state->results[i].tracker = std::move(tracker);
+                state->completed.notify_all();
+            };
+
+            std::vector<std::pair<size_t, TrackerProbe>> serialProbes;
+            for (size_t i = 0; i < probes.size(); i++) {
+                if (probes[i].isConcurrent) {
+                    startBackgroundThread([runProbe, i, probe = probes[i]]() { runProbe(i, probe); });
+                } else {
+                    serialProbes.push_back({i, probes[i]});
+                }
+            }
+            if (!serialProbes.empty()) {
+                startBackgroundThread([runProbe, state, serialProbes = std::move(serialProbes)]() {
+                    for (const auto& [i, probe] : serialProbes) {
+                        {
+                            std::unique_lock lock(state->mutex);
+                            if (state->isAbandoned) {
+                                return;
+                            }
+                        }
+                        runProbe(i, probe);
+                    }
+                });
+            }
+
+            // Wait until the probe with the highest priority that has not failed or timed out completes. When we want
+            // all the trackers, wait until every probe has completed or timed out.
+            std::unique_lock lock(state->mutex);
+            std::vector<bool> hasTimedOut(probes.size(), false);
+            std::vector<size_t> winners;
+            while (true) {
+                const auto now = std::chrono::steady_clock::now();
+                std::optional<std::chrono::steady_clock::time_point> nextDeadline;
+                winners.clear();
+                for (size_t i = 0; i < probes.size(); i++) {
+                    if (state->results[i].isDone) {
+                        if (state->results[i].tracker) {
+                            winners.push_back(i);
+                            if (stopAtFirst) {
+                                break;
+                            }
+                        }
+                        continue;
+                    }
+
+                    const auto deadline = start + probes[i].timeout;
+                    if (now >= deadline) {
+                        if (!hasTimedOut[i]) {
+                            Log(fmt::format(
+                                "Probing {} timed out after {}ms\n", probes[i].name, probes[i].timeout.count()));
+                            hasTimedOut[i] = true;
+                        }
+                        continue;
+                    }
+
+                    if (!nextDeadline || deadline < nextDeadline.value()) {
+                        nextDeadline = deadline;
+                    }
+                    if (stopAtFirst) {
+                        break;
+                    }
+                }
+
+                if ((stopAtFirst && !winners.empty()) || !nextDeadline) {
+                    break;
+                }
+                state->completed.wait_until(lock, nextDeadline.value());
+            }
+
+            std::vector<ProbeResult> results;
+            std::vector<std::unique_ptr<IEyeTracker>> losers;
+            for (size_t i = 0; i < probes.size(); i++) {
+                if (std::find(winners.cbegin(), winners.cend(), i) != winners.cend()) {
+                    ProbeResult result;
+                    result.tracker = std::move(state->results[i].tracker);
+                    result.name = probes[i].name;
+                    result.isCacheable = probes[i].isCacheable;
+                    results.push_back(std::move(result));
+                } else if (state->results[i].tracker) {
+                    losers.push_back(std::move(state->results[i].tracker));
+                }
+            }
+            state->isAbandoned = true;
+            lock.unlock();
+
+            destroyInBackground(std::move(losers));
+
+            const auto duration =
+                std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+            Log(fmt::format("Probing completed in {}ms\n", duration.count()));
+
+            TraceLoggingWriteStop(local,
+                                  "ProbeEyeTrackers",
+                                  TLArg(results.size(), "Found"),
+                                  TLArg(!results.empty() ? results[0].name.c_str() : "", "Winner"),
+                                  TLArg(duration.count(), "DurationMs"));
+
+            return results;
+        }
+
+    } // namespace
+
+    std::unique_ptr<IEyeTracker> createEyeTracker(const TrackerProbe& probe) {
+        ProbeInvocation invocation{&probe};
+        try {
+            if (!invokeProbeWithDelayLoadGuard(&invocation)) {
+                Log(fmt::format("Probing {} failed: the SDK could not be loaded\n", probe.name));
+            }
+        } catch (std::exception& exc) {
+            Log(fmt::format("Probing {} failed: {}\n", probe.name, exc.what()));
+        }
+        return std::move(invocation.tracker);
+    }
+
+    ProbeResult probeEyeTrackers(const std::vector<TrackerProbe>& probes) {
+        std::vector<ProbeResult> results = runProbes(probes, true);
+        return !results.empty() ? std::move(results[0]) : ProbeResult{};
+    }
+
+    std::vector<ProbeResult> probeAllEyeTrackers(const std::vector<TrackerProbe>& probes) {
+        return runProbes(probes, false);
+    }
+
+    bool joinProbeThreads(std::chrono::milliseconds timeout) {
+        BackgroundThreads& threads = getBackgroundThreads();
+        std::unique_lock lock(threads.mutex);
+
+        const bool isComplete = threads.exited.wait_for(lock, timeout, [&] {
+            return std::all_of(threads.entries.cbegin(), threads.entries.cend(), [](const auto& entry) {
+                return entry->isDone;
+            });
+        });
+        reapBackgroundThreads(threads);
+
+        // Do not hold up the shutdown any longer for the remaining ones.
+        const size_t pending = threads.entries.size();
+        for (auto& entry : threads.entries) {
+            if (entry->thread.joinable()) {
+                entry->thread.detach();
+            }
+        }
+
+        if (!isComplete) {
+            Log(fmt::format("{} probing thread(s) still running after {}ms\n", pending, timeout.count()));
+        }
+        return isComplete;
+    }
+
+} // namespace openxr_api_layer
@@ -0,0 +1,64 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+namespace openxr_api_layer {
+
+    struct TrackerProbe {
+        std::string name;
+        std::function<std::unique_ptr<IEyeTracker>()> create;
+
+        // How long to wait for this probe before moving on to the next one.
+        std::chrono::milliseconds timeout;
+
+        // Whether a success of this probe is meaningful enough to be remembered for the next sessions. Probes without
+        // a real device check (that always succeed) must not be cached, or they would shadow the other trackers.
+        bool isCacheable{true};
+
+        // Whether the factory may run at the same time as the other probes. The built-in factories each talk to their
+        // own SDK, service or socket, and are safe to run concurrently. Plugins are out-of-tree code that may share a
+        // runtime with each other, so they are run one at a time, in order of priority, on a single thread.
+        bool isConcurrent{true};
+    };
+
+    struct ProbeResult {
+        std::unique_ptr<IEyeTracker> tracker;
+        std::string name;
+        bool isCacheable{false};
+    };
+
+    // Run a single probe on the calling thread. Failures to load the SDK of the tracker are reported as no tracker.
+    std::unique_ptr<IEyeTracker> createEyeTracker(const TrackerProbe& probe);
+
+    // Run all the probes concurrently, and return the successful tracker with the highest priority (lowest index).
+    // Trackers that lost (or that complete after their deadline) are destroyed in the background.
+    ProbeResult probeEyeTrackers(const std::vector<TrackerProbe>& probes);
+
+    // Run all the probes concurrently, and return all the successful trackers by order of priority.
+    std::vector<ProbeResult> probeAllEyeTrackers(const std::vector<TrackerProbe>& probes);
+
+    // Wait for the probes and the teardowns still running in the background, up to the timeout. Must be called before
+    // the DLL is unloaded. Returns whether all of them completed; the others are left to finish on their own.
+    bool joinProbeThreads(std::chrono::milliseconds timeout);
+
+} // namespace openxr_api_layer
@@ -0,0 +1,231 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "log.h"
+using namespace openxr_api_layer::log;
+
+#include <trackers.h>
+
+#include "saccade.h"
+
+namespace openxr_api_layer {
+
+    namespace {
+
+        // Angular velocities for the start and the end of a saccade, in degrees per second. The end threshold is lower
+        // so that noise around the onset threshold does not split a saccade.
+        constexpr float OnsetVelocity = 100.f;
+        constexpr float OffsetVelocity = 50.f;
+
+        // Anything longer is not a saccade (eg: a smooth pursuit of a fast target, or noise).
+        constexpr auto MaxSaccadeDuration = std::chrono::milliseconds(150);
+
+        // The velocity is not meaningful across a gap in the samples (eg: a blink).
+        constexpr auto MaxSampleGap = std::chrono::milliseconds(50);
+
+        // Main sequence relating the peak velocity to the amplitude: V = Vmax * (1 - exp(-A / C)).
+        constexpr float MainSequenceMaxVelocity = 700.f;
+        constexpr float MainSequenceConstant = 14.f;
+        constexpr float MaxVelocityRatio = 0.95f;
+
+        // Trackers that cannot tell the capture time are stamped with the time of the query, which is off by up to a
+        // tracker period. The peak velocity is measured over two intervals to dampen that jitter, and the prediction
+        // only goes part of the way to the main sequence amplitude, since overshooting costs as much as falling short.
+        constexpr float PredictionWeight = 0.5f;
+
+        // Slower trackers give one or two samples per saccade, too few to predict anything.
+        constexpr auto MaxPredictionInterval = std::chrono::milliseconds(20);
+
+        // Enough for the longest saccade with a 1kHz tracker.
+        constexpr size_t MaxPredictionsPerSaccade = 150;
+
+        // Smaller movements are not reported as saccades, and do not give a direction to extrapolate.
+        constexpr float MinAmplitude = 1.f;
+
+        float angleDegrees(const XrVector3f& a, const XrVector3f& b) {
+            const float dot = std::clamp(a.x * b.x + a.y * b.y + a.z * b.z, -1.f, 1.f);
+            return std::acos(dot) * 180.f / (float)M_PI;
+        }
+
+        XrVector3f cross(const XrVector3f& a, const XrVector3f& b) {
+            return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+        }
+
+        // Rotate a unit vector by the given angle, on the great circle going through another one.
+        XrVector3f rotateTowards(const XrVector3f& from, const XrVector3f& to, float angle) {
+            XrVector3f axis = cross(from, to);
+            const float length = std::sqrt(axis.x * axis.x + axis.y * axis.y + axis.z * axis.z);
+            axis = {axis.x / length, axis.y / length, axis.z / length};
+
+            const XrVector3f ortho = cross(axis, from);
+            const float radians = angle * (float)M_PI / 180.f;
+            const float c = std::cos(radians);
+            const float s = std::sin(radians);
+            return {from.x * c + ortho.x * s, from.y * c + ortho.y * s, from.z * c + ortho.z * s};
+        }
+
+    } // namespace
+
+    XrVector3f SaccadeDetector::update(const XrVector3f& gaze, std::chrono::steady_clock::time_point time) {
+        // Trackers slower than the frame rate deliver the same sample several times, and the ones that cannot tell the
+        // capture time stamp each repeat with the time of the query. A repeat would look like the eye stopped.
+        const bool isRepeat = gaze.x == m_lastGaze.x && gaze.y == m_lastGaze.y && gaze.z == m_lastGaze.z;
+        if (m_lastTime && (time <= m_lastTime.value() || isRepeat)) {
+            return isInSaccade() ? m_prediction : gaze;
+        }
+
+        if (!m_lastTime || time - m_lastTime.value() > MaxSampleGap) {
+            if (isInSaccade()) {
+                endSaccade({});
+            }
+        } else {
+            const float velocity =
+                angleDegrees(m_lastGaze, gaze) / std::chrono::duration<float>(time - m_lastTime.value()).count();
+            const float smoothedVelocity =
+                m_previousTime && time - m_previousTime.value() <= 2 * MaxSampleGap
+                    ? angleDegrees(m_previousGaze, gaze) /
+                          std::chrono::duration<float>(time - m_previousTime.value()).count()
+                    : velocity;
+            if (!isInSaccade()) {
+                if (velocity > OnsetVelocity) {
+                    m_isInSaccade.store(true, std::memory_order_relaxed);
+                    m_saccadeStartTime = m_lastTime.value();
+                    m_saccadeStart = m_lastGaze;
+                    m_peakVelocity = velocity;
+                }
+            } else {
+                m_peakVelocity = std::max(m_peakVelocity, smoothedVelocity);
+                if (velocity < OffsetVelocity) {
+                    endSaccade(gaze);
+                } else if (time - m_saccadeStartTime > MaxSaccadeDuration) {
+                    endSaccade({});
+                }
+            }
+        }
+        const bool isTooSlowToPredict = !m_lastTime || time - m_lastTime.value() > MaxPredictionInterval;
+        m_previousTime = m_lastTime;
+        m_previousGaze = m_lastGaze;
+        m_lastTime = time;
+        m_lastGaze = gaze;
+
+        if (!isInSaccade()) {
+            return gaze;
+        }
+
+        // The amplitude from the main sequence is only reached after the peak, and the eye may well have moved
+        // further than that already.
+        const float displacement = angleDegrees(m_saccadeStart, gaze);
+        if (displacement < MinAmplitude || isTooSlowToPredict) {
+            m_prediction = gaze;
+        } else {
+            const float ratio = std::min(m_peakVelocity / MainSequenceMaxVelocity, MaxVelocityRatio);
+            const float amplitude = -MainSequenceConstant * std::log(1.f - ratio);
+            m_prediction = rotateTowards(
+                m_saccadeStart, gaze, displacement + PredictionWeight * std::max(amplitude - displacement, 0.f));
+        }
+        if (m_predictions.size() < MaxPredictionsPerSaccade) {
+            m_predictions.push_back({m_prediction, gaze});
+        }
+        return m_prediction;
+    }
+
+    std::optional<SaccadeLanding> SaccadeDetector::takeLanding() {
+        std::optional<SaccadeLanding> landing;
+        std::swap(landing, m_landing);
+        return landing;
+    }
+
+    void SaccadeDetector::endSaccade(std::optional<XrVector3f> landing) {
+        m_isInSaccade.store(false, std::memory_order_relaxed);
+
+        if (landing && !m_predictions.empty() && angleDegrees(m_saccadeStart, landing.value()) >= MinAmplitude) {
+            SaccadeLanding result;
+            result.amplitude = angleDegrees(m_saccadeStart, landing.value());
+            for (const auto& [prediction, sample] : m_predictions) {
+                result.predictionError += angleDegrees(prediction, landing.value());
+                result.staleGazeError += angleDegrees(sample, landing.value());
+            }
+            result.predictionError /= m_predictions.size();
+            result.staleGazeError /= m_predictions.size();
+            m_landing = result;
+        }
+        m_predictions.clear();
+    }
+
+    SaccadeEvaluation evaluateSaccadeDetector(const std::vector<GazeComparisonRecord>& records, size_t trace) {
+        SaccadeEvaluation evaluation;
+
+        SaccadeDetector detector;
+        std::vector<double> predictionErrors;
+        std::vector<double> staleGazeErrors;
+        for (const auto& record : records) {
+            if (!record.isValid[trace]) {
+                continue;
+            }
+
+            detector.update(record.gaze[trace],
+                            std::chrono::steady_clock::time_point(
+                                std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                    std::chrono::duration<double>(record.time))));
+            if (const auto landing = detector.takeLanding()) {
+                predictionErrors.push_back(landing->predictionError);
+                staleGazeErrors.push_back(landing->staleGazeError);
+            }
+        }
+
+        evaluation.saccadeCount = predictionErrors.size();
+        if (!predictionErrors.empty()) {
+            std::sort(predictionErrors.begin(), predictionErrors.end());
+            std::sort(staleGazeErrors.begin(), staleGazeErrors.end());
+            double totalPredictionError = 0;
+            double totalStaleGazeError = 0;
+            for (size_t i = 0; i < predictionErrors.size(); i++) {
+                totalPredictionError += predictionErrors[i];
+                totalStaleGazeError += staleGazeErrors[i];
+            }
+            const size_t count = predictionErrors.size();
+            evaluation.meanPredictionError = totalPredictionError / count;
+            evaluation.medianPredictionError = predictionErrors[count / 2];
+            evaluation.p95PredictionError = predictionErrors[std::min(count - 1, count * 95 / 100)];
+            evaluation.meanStaleGazeError = totalStaleGazeError / count;
+            evaluation.medianStaleGazeError = staleGazeErrors[count / 2];
+        }
+
+        return evaluation;
+    }
+
+    std::string formatSaccadeEvaluation(const SaccadeEvaluation& evaluation) {
+        std::string result;
+        result += fmt::format("Saccades: {}\n", evaluation.saccadeCount);
+        result += fmt::format("Landing error with prediction (deg): mean {:.2f}, median {:.2f}, p95 {:.2f}\n",
+                              evaluation.meanPredictionError,
+                              evaluation.medianPredictionError,
+                              evaluation.p95PredictionError);
+        result += fmt::format("Landing error without prediction (deg): mean {:.2f}, median {:.2f}\n",
+                              evaluation.meanStaleGazeError,
+                              evaluation.medianStaleGazeError);
+        return result;
+    }
+
+} // namespace openxr_api_layer
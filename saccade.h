@@ -0,0 +1,90 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "comparison.h"
+
+namespace openxr_api_layer {
+
+    struct SaccadeLanding {
+        float amplitude{0.f};
+
+        // Mean angle between the landing point and the predictions made during the saccade, and the same for the gaze
+        // samples we would have used without prediction, in degrees.
+        float predictionError{0.f};
+        float staleGazeError{0.f};
+    };
+
+    // Velocity-threshold (I-VT) saccade detector. Perception is suppressed during a saccade, so foveation can be more
+    // aggressive, and the foveal region can move ahead towards the landing point predicted from the peak velocity
+    // (using the main sequence of saccades).
+    class SaccadeDetector {
+      public:
+        // Called from the render thread with each gaze sample. Returns the gaze to foveate on: the predicted landing
+        // point during a saccade, or the sample otherwise.
+        XrVector3f update(const XrVector3f& gaze, std::chrono::steady_clock::time_point time);
+
+        // Safe to call from any thread.
+        bool isInSaccade() const {
+            return m_isInSaccade.load(std::memory_order_relaxed);
+        }
+
+        // The landing of the last saccade, once after it ended.
+        std::optional<SaccadeLanding> takeLanding();
+
+      private:
+        void endSaccade(std::optional<XrVector3f> landing);
+
+        std::optional<std::chrono::steady_clock::time_point> m_lastTime;
+        XrVector3f m_lastGaze{0.f, 0.f, -1.f};
+        std::optional<std::chrono::steady_clock::time_point> m_previousTime;
+        XrVector3f m_previousGaze{0.f, 0.f, -1.f};
+
+        std::atomic<bool> m_isInSaccade{false};
+        std::chrono::steady_clock::time_point m_saccadeStartTime{};
+        XrVector3f m_saccadeStart{0.f, 0.f, -1.f};
+        float m_peakVelocity{0.f};
+        XrVector3f m_prediction{0.f, 0.f, -1.f};
+
+        // The predictions and the samples they were made from during the current saccade.
+        std::vector<std::pair<XrVector3f, XrVector3f>> m_predictions;
+
+        std::optional<SaccadeLanding> m_landing;
+    };
+
+    struct SaccadeEvaluation {
+        size_t saccadeCount{0};
+
+        // In degrees.
+        double meanPredictionError{0};
+        double medianPredictionError{0};
+        double p95PredictionError{0};
+        double meanStaleGazeError{0};
+        double medianStaleGazeError{0};
+    };
+
+    // Run the detector over one of the traces of a capture, to evaluate the landing predictions offline.
+    SaccadeEvaluation evaluateSaccadeDetector(const std::vector<GazeComparisonRecord>& records, size_t trace);
+    std::string formatSaccadeEvaluation(const SaccadeEvaluation& evaluation);
+
+} // namespace openxr_api_layer
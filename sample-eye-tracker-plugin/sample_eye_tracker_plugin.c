@@ -0,0 +1,100 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// A minimal eye tracker plugin, producing a synthetic gaze that slowly sweeps the field of view. Use it as a template
+// to bridge other trackers to PvrEmu: copy the DLL to %LOCALAPPDATA%\PvrEmu\plugins.
+
+// First, so that the clock header can select the POSIX API before any system header is included.
+#include <pvremu_eye_tracker_plugin.h>
+
+#include <math.h>
+#include <stdlib.h>
+
+typedef struct sample_tracker {
+    int is_started;
+    int64_t start_time;
+} sample_tracker;
+
+static void* PVREMU_PLUGIN_CALL sample_create(void) {
+    // A real plugin would check for its device here, and return NULL if it is not present.
+    return calloc(1, sizeof(sample_tracker));
+}
+
+static int PVREMU_PLUGIN_CALL sample_start(void* instance) {
+    sample_tracker* tracker = (sample_tracker*)instance;
+    tracker->is_started = 1;
+    tracker->start_time = pvremu_now_ns();
+    return 1;
+}
+
+static void PVREMU_PLUGIN_CALL sample_stop(void* instance) {
+    sample_tracker* tracker = (sample_tracker*)instance;
+    tracker->is_started = 0;
+}
+
+static int PVREMU_PLUGIN_CALL sample_poll_sample(void* instance, pvremu_gaze_sample* sample) {
+    const sample_tracker* tracker = (const sample_tracker*)instance;
+    if (!tracker->is_started) {
+        return 0;
+    }
+
+    // The host tells us how much of the structure it knows about.
+    if (sample->struct_size < sizeof(pvremu_gaze_sample)) {
+        return 0;
+    }
+
+    const int64_t now = pvremu_now_ns();
+    const double t = (now - tracker->start_time) / 1e9;
+    const float yaw = (float)(0.35 * sin(t * 0.7));
+    const float pitch = (float)(0.2 * sin(t * 1.1));
+
+    sample->gaze[0] = sinf(yaw) * cosf(pitch);
+    sample->gaze[1] = sinf(pitch);
+    sample->gaze[2] = -cosf(yaw) * cosf(pitch);
+    sample->confidence = 1.f;
+    sample->timestamp_ns = now;
+    return 1;
+}
+
+static void PVREMU_PLUGIN_CALL sample_destroy(void* instance) {
+    free(instance);
+}
+
+static const pvremu_eye_tracker_plugin sample_plugin = {
+    PVREMU_EYE_TRACKER_PLUGIN_ABI_VERSION,
+    sizeof(pvremu_eye_tracker_plugin),
+    "Sample plugin",
+    sample_create,
+    sample_start,
+    sample_stop,
+    sample_poll_sample,
+    sample_destroy,
+};
+
+PVREMU_PLUGIN_EXPORT const pvremu_eye_tracker_plugin* PVREMU_PLUGIN_CALL
+pvremu_get_eye_tracker_plugin(uint32_t host_abi_version) {
+    if (host_abi_version != PVREMU_EYE_TRACKER_PLUGIN_ABI_VERSION) {
+        return NULL;
+    }
+    return &sample_plugin;
+}
@@ -0,0 +1,306 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "log.h"
+using namespace openxr_api_layer::log;
+
+#include "session_report.h"
+
+namespace openxr_api_layer {
+
+    namespace {
+
+        constexpr float HistogramMinValue = 0.001f;
+        constexpr float HistogramBucketRatio = 1.05f;
+
+        // Longer gaps between calls are loading screens or pauses, they are not counted as query intervals.
+        constexpr auto MaxQueryInterval = std::chrono::seconds(1);
+
+        const float Percentiles[] = {0.5f, 0.9f, 0.99f};
+
+        float toMilliseconds(std::chrono::steady_clock::duration duration) {
+            return std::chrono::duration<float, std::milli>(duration).count();
+        }
+
+        float toSeconds(std::chrono::steady_clock::duration duration) {
+            return std::chrono::duration<float>(duration).count();
+        }
+
+        std::string escapeJson(const std::string& str) {
+            std::string escaped;
+            for (const char c : str) {
+                if (c == '"' || c == '\\') {
+                    escaped += '\\';
+                    escaped += c;
+                } else if ((unsigned char)c < 0x20) {
+                    escaped += fmt::format("\\u{:04x}", c);
+                } else {
+                    escaped += c;
+                }
+            }
+            return escaped;
+        }
+
+        std::string percentilesToJson(const DurationHistogram& histogram, float scale = 1.f) {
+            std::string json;
+            for (const float percentile : Percentiles) {
+                json += fmt::format("{}\"p{}\":{:.3f}",
+                                    json.empty() ? "{" : ",",
+                                    (int)(percentile * 100),
+                                    histogram.getPercentile(percentile) * scale);
+            }
+            return json + "}";
+        }
+
+        std::string percentilesToText(const DurationHistogram& histogram, const char* unit, float scale = 1.f) {
+            if (!histogram.getCount()) {
+                return "n/a";
+            }
+            std::string text;
+            for (const float percentile : Percentiles) {
+                text += fmt::format("{}p{} {:.2f}{}",
+                                    text.empty() ? "" : ", ",
+                                    (int)(percentile * 100),
+                                    histogram.getPercentile(percentile) * scale,
+                                    unit);
+            }
+            return text;
+        }
+
+    } // namespace
+
+    void DurationHistogram::add(float milliseconds) {
+        size_t bucket = 0;
+        if (milliseconds > HistogramMinValue) {
+            bucket = std::min(
+                (size_t)(std::log(milliseconds / HistogramMinValue) / std::log(HistogramBucketRatio)),
+                m_buckets.size() - 1);
+        }
+        m_buckets[bucket]++;
+        m_count++;
+    }
+
+    float DurationHistogram::getPercentile(float fraction) const {
+        if (!m_count) {
+            return 0.f;
+        }
+
+        const uint64_t rank = std::max<uint64_t>((uint64_t)std::ceil(fraction * m_count), 1);
+        uint64_t cumulated = 0;
+        size_t bucket = 0;
+        for (; bucket < m_buckets.size() - 1; bucket++) {
+            cumulated += m_buckets[bucket];
+            if (cumulated >= rank) {
+                break;
+            }
+        }
+
+        // The middle of the bucket, on the logarithmic scale.
+        return HistogramMinValue * std::pow(HistogramBucketRatio, bucket + 0.5f);
+    }
+
+    const char* getFoveationModeName(uint32_t mode) {
+        switch (mode) {
+        case 0:
+            return "off";
+        case 1:
+            return "maximum";
+        case 2:
+            return "balanced";
+        case 3:
+            return "minimum";
+        case 4:
+            return "debug";
+        default:
+            return "unknown";
+        }
+    }
+
+    void SessionReport::start() {
+        std::unique_lock lock(m_mutex);
+
+        m_startTime = std::chrono::steady_clock::now();
+        m_startWallTime = std::time(nullptr);
+    }
+
+    void SessionReport::recordFrame(const SessionFrame& frame) {
+        std::unique_lock lock(m_mutex);
+
+        const auto now = std::chrono::steady_clock::now();
+        const uint32_t mode = std::min(frame.mode, FoveationModeCount - 1);
+
+        m_frameCount++;
+        if (frame.isFoveationActive) {
+            m_foveationActiveFrameCount++;
+        }
+        if (m_lastFrameTime) {
+            const auto interval = now - m_lastFrameTime.value();
+            m_timeInMode[mode] += interval;
+            if (interval < MaxQueryInterval) {
+                m_queryInterval[mode].add(toMilliseconds(interval));
+            }
+        }
+        m_lastFrameTime = now;
+
+        if (frame.isGazeQueried) {
+            m_gazeQueryCount++;
+            if (frame.hasFreshGaze) {
+                m_validGazeCount++;
+                m_sampleAge.add(frame.sampleAgeMs);
+                if (m_dropoutStartTime) {
+                    m_longestDropout = std::max(m_longestDropout, now - m_dropoutStartTime.value());
+                    m_dropoutStartTime.reset();
+                }
+            } else if (m_wasGazeValid) {
+                m_dropoutCount++;
+                m_dropoutStartTime = now;
+            }
+            m_wasGazeValid = frame.hasFreshGaze;
+        }
+
+        m_callCost.add(frame.callCostMs);
+    }
+
+    void SessionReport::recordSaccade(float predictionError, float staleGazeError) {
+        std::unique_lock lock(m_mutex);
+
+        m_saccadePredictionError.add(predictionError);
+        m_saccadeStaleGazeError.add(staleGazeError);
+    }
+
+    void SessionReport::write(const std::string& application,
+                              const std::string& trackerName,
+                              const GpuFrameTimes& gpuFrameTimes,
+                              const std::filesystem::path& file) {
+        std::unique_lock lock(m_mutex);
+
+        const auto duration = std::chrono::steady_clock::now() - m_startTime;
+        const float foveationActiveRate = m_frameCount ? (float)m_foveationActiveFrameCount / m_frameCount : 0.f;
+        const float gazeValidityRate = m_gazeQueryCount ? (float)m_validGazeCount / m_gazeQueryCount : 0.f;
+
+        char startTime[32]{};
+        std::strftime(startTime, sizeof(startTime), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&m_startWallTime));
+
+        std::string timeInModeJson;
+        std::string queryIntervalJson;
+        std::string timeInModeText;
+        std::vector<std::string> timingText;
+        std::string gpuFrameTimeJson;
+        for (uint32_t mode = 0; mode < FoveationModeCount; mode++) {
+            const char* name = getFoveationModeName(mode);
+            timeInModeJson += fmt::format(
+                "{}\"{}\":{:.1f}", timeInModeJson.empty() ? "{" : ",", name, toSeconds(m_timeInMode[mode]));
+            if (!m_queryInterval[mode].getCount()) {
+                continue;
+            }
+            queryIntervalJson += fmt::format(
+                "{}\"{}\":{}", queryIntervalJson.empty() ? "{" : ",", name, percentilesToJson(m_queryInterval[mode]));
+            timeInModeText += fmt::format(
+                "{}{} {:.1f}s", timeInModeText.empty() ? "" : ", ", name, toSeconds(m_timeInMode[mode]));
+            timingText.push_back(fmt::format(
+                "  Eye tracking query interval ({}): {}\n", name, percentilesToText(m_queryInterval[mode], "ms")));
+        }
+        timeInModeJson += "}";
+
+        for (uint32_t mode = 0; mode < FoveationModeCount; mode++) {
+            std::string modeJson;
+            for (const bool isActive : {true, false}) {
+                const DurationHistogram& histogram = gpuFrameTimes.get({mode, isActive});
+                if (!histogram.getCount()) {
+                    continue;
+                }
+                const char* activeName = isActive ? "active" : "inactive";
+                modeJson += fmt::format(
+                    "{}\"{}\":{}", modeJson.empty() ? "{" : ",", activeName, percentilesToJson(histogram));
+                timingText.push_back(fmt::format("  GPU frame time ({}, foveation {}): {}\n",
+                                                    getFoveationModeName(mode),
+                                                    activeName,
+                                                    percentilesToText(histogram, "ms")));
+            }
+            if (!modeJson.empty()) {
+                gpuFrameTimeJson += fmt::format(
+                    "{}\"{}\":{}}}", gpuFrameTimeJson.empty() ? "{" : ",", getFoveationModeName(mode), modeJson);
+            }
+        }
+        gpuFrameTimeJson += gpuFrameTimeJson.empty() ? "{}" : "}";
+        queryIntervalJson += queryIntervalJson.empty() ? "{}" : "}";
+
+        const std::string json = fmt::format(
+            "{{\"application\":\"{}\",\"start\":\"{}\",\"durationS\":{:.1f},\"tracker\":\"{}\",\"timeInModeS\":{},"
+            "\"frames\":{},\"foveationActiveRate\":{:.4f},\"gazeQueries\":{},\"gazeValidityRate\":{:.4f},"
+            "\"dropouts\":{},\"longestDropoutMs\":{:.0f},\"sampleAgeMs\":{},\"callCostUs\":{},\"queryIntervalMs\":{},"
+            "\"gpuFrameTimeMs\":{},\"saccades\":{},\"landingErrorDeg\":{},\"staleGazeErrorDeg\":{}}}",
+            escapeJson(application),
+            startTime,
+            toSeconds(duration),
+            escapeJson(trackerName),
+            timeInModeJson,
+            m_frameCount,
+            foveationActiveRate,
+            m_gazeQueryCount,
+            gazeValidityRate,
+            m_dropoutCount,
+            toMilliseconds(m_longestDropout),
+            percentilesToJson(m_sampleAge),
+            percentilesToJson(m_callCost, 1000.f),
+            queryIntervalJson,
+            gpuFrameTimeJson,
+            m_saccadePredictionError.getCount(),
+            percentilesToJson(m_saccadePredictionError),
+            percentilesToJson(m_saccadeStaleGazeError));
+
+        // Log the summary line by line, as the lines of the log are limited in size.
+        Log(fmt::format("Session summary for {}:\n", application));
+        Log(fmt::format("  Duration: {:.1f}s, eye tracker: {}\n", toSeconds(duration), trackerName));
+        Log(fmt::format("  Time per mode: {}\n", !timeInModeText.empty() ? timeInModeText : "n/a"));
+        Log("  Frames: %llu, with foveation active: %.1f%%\n", m_frameCount, foveationActiveRate * 100.f);
+        Log("  Gaze validity: %.1f%% of %llu queries, %llu dropouts (longest %.0fms)\n",
+            gazeValidityRate * 100.f,
+            m_gazeQueryCount,
+            m_dropoutCount,
+            toMilliseconds(m_longestDropout));
+        Log(fmt::format("  Sample age: {}\n", percentilesToText(m_sampleAge, "ms")));
+        Log(fmt::format("  Call cost: {}\n", percentilesToText(m_callCost, "us", 1000.f)));
+        for (const std::string& line : timingText) {
+            Log(line);
+        }
+        if (m_saccadePredictionError.getCount()) {
+            Log(fmt::format("  Saccades: {}\n", m_saccadePredictionError.getCount()));
+            Log(fmt::format("  Landing error with prediction: {}\n",
+                            percentilesToText(m_saccadePredictionError, "deg")));
+            Log(fmt::format("  Landing error without prediction: {}\n",
+                            percentilesToText(m_saccadeStaleGazeError, "deg")));
+        }
+
+        TraceLoggingWrite(g_traceProvider, "SessionSummary", TLArg(json.c_str(), "Summary"));
+
+        std::ofstream stream(file, std::ios_base::app);
+        if (stream.is_open()) {
+            stream << json << "\n";
+        } else {
+            Log(fmt::format("Cannot write the session summary to {}\n", file.string()));
+        }
+    }
+
+} // namespace openxr_api_layer
@@ -0,0 +1,124 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+namespace openxr_api_layer {
+
+    // Percentiles of a duration, kept in fixed logarithmic buckets (5% wide, from 1us) so that recording never
+    // allocates.
+    class DurationHistogram {
+      public:
+        void add(float milliseconds);
+
+        uint64_t getCount() const {
+            return m_count;
+        }
+
+        // The value under which the given fraction of the samples fall, or 0 without samples.
+        float getPercentile(float fraction) const;
+
+      private:
+        std::array<uint32_t, 400> m_buckets{};
+        uint64_t m_count{0};
+    };
+
+    // The foveation modes from the settings: off, maximum, balanced, minimum and debug.
+    constexpr uint32_t FoveationModeCount = 5;
+
+    const char* getFoveationModeName(uint32_t mode);
+
+    struct FoveationState {
+        uint32_t mode{0};
+        bool isActive{false};
+    };
+
+    // GPU frame times, by foveation mode and by whether foveated_rendering_active was set.
+    struct GpuFrameTimes {
+        std::array<std::array<DurationHistogram, 2>, FoveationModeCount> histograms;
+
+        DurationHistogram& get(const FoveationState& state) {
+            return histograms[std::min(state.mode, FoveationModeCount - 1)][state.isActive ? 1 : 0];
+        }
+        const DurationHistogram& get(const FoveationState& state) const {
+            return histograms[std::min(state.mode, FoveationModeCount - 1)][state.isActive ? 1 : 0];
+        }
+    };
+
+    // What happened during one call to getEyeTrackingInfo(), which LibMagic makes once per frame.
+    struct SessionFrame {
+        uint32_t mode{0};
+        bool isFoveationActive{false};
+
+        // Whether an eye tracker was asked for gaze, and whether it delivered.
+        bool isGazeQueried{false};
+        bool hasFreshGaze{false};
+        float sampleAgeMs{0.f};
+
+        float callCostMs{0.f};
+    };
+
+    // Statistics over a session, summarized at shutdown. The JSON form is appended to a file (one line per session) so
+    // that sessions can be compared across titles and rigs.
+    class SessionReport {
+      public:
+        void start();
+        void recordFrame(const SessionFrame& frame);
+
+        // The landing error of a saccade with and without prediction, in degrees.
+        void recordSaccade(float predictionError, float staleGazeError);
+
+        // Log the human-readable summary and append the JSON summary to the file.
+        void write(const std::string& application,
+                   const std::string& trackerName,
+                   const GpuFrameTimes& gpuFrameTimes,
+                   const std::filesystem::path& file);
+
+      private:
+        std::mutex m_mutex;
+
+        std::chrono::steady_clock::time_point m_startTime{};
+        std::time_t m_startWallTime{0};
+        std::optional<std::chrono::steady_clock::time_point> m_lastFrameTime;
+
+        uint64_t m_frameCount{0};
+        uint64_t m_foveationActiveFrameCount{0};
+        std::array<std::chrono::steady_clock::duration, FoveationModeCount> m_timeInMode{};
+        // Time between calls to getEyeTrackingInfo(). LibMagic calls it once per frame, but this is not the frame time.
+        std::array<DurationHistogram, FoveationModeCount> m_queryInterval;
+
+        uint64_t m_gazeQueryCount{0};
+        uint64_t m_validGazeCount{0};
+        uint64_t m_dropoutCount{0};
+        std::optional<std::chrono::steady_clock::time_point> m_dropoutStartTime;
+        std::chrono::steady_clock::duration m_longestDropout{0};
+        bool m_wasGazeValid{false};
+
+        DurationHistogram m_sampleAge;
+        DurationHistogram m_callCost;
+
+        // The histograms work for angles just as well.
+        DurationHistogram m_saccadePredictionError;
+        DurationHistogram m_saccadeStaleGazeError;
+    };
+
+} // namespace openxr_api_layer
@@ -0,0 +1,147 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "pch.h"
+
+#include "log.h"
+using namespace openxr_api_layer::log;
+
+#include <trackers.h>
+#include <pvremu_gaze_shm.h>
+
+#include "eye_tracker.h"
+#include "shared_memory.h"
+
+namespace openxr_api_layer {
+
+    namespace {
+
+        // Samples older than this mean that the producer stopped.
+        constexpr auto MaxSampleAge = std::chrono::milliseconds(500);
+
+        class SharedMemoryEyeTracker : public LocalEyeTracker {
+          public:
+            SharedMemoryEyeTracker(wil::unique_handle mapping,
+                                   const pvremu::GazeSharedMemory* shm,
+                                   const std::string& displayName)
+                : m_mapping(std::move(mapping)), m_shm(shm), m_displayName(displayName) {
+            }
+
+            ~SharedMemoryEyeTracker() override {
+                UnmapViewOfFile(m_shm);
+            }
+
+            void start(XrSession session) override {
+            }
+
+            void stop() override {
+            }
+
+            std::string getName() const override {
+                return m_displayName;
+            }
+
+            bool getGazeSample(EyeGazeSample& sample) override {
+                pvremu::GazeSample shmSample;
+                if (!pvremu::readNewestGazeSample(*m_shm, shmSample)) {
+                    return false;
+                }
+
+                const auto now = std::chrono::steady_clock::now();
+                const auto time = std::min(now,
+                                           std::chrono::steady_clock::time_point(
+                                               std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                                   std::chrono::nanoseconds(shmSample.timestampNs))));
+                if (now - time > MaxSampleAge) {
+                    return false;
+                }
+
+                if (!combineGazeSample(shmSample, sample)) {
+                    return false;
+                }
+                sample.time = time;
+                return true;
+            }
+
+          private:
+            const wil::unique_handle m_mapping;
+            const pvremu::GazeSharedMemory* const m_shm;
+            const std::string m_displayName;
+        };
+
+    } // namespace
+
+    bool combineGazeSample(const pvremu::GazeSample& input, EyeGazeSample& sample) {
+        // Combine the eyes that are valid.
+        XrVector3f gaze{};
+        float confidence = 0.f;
+        uint32_t validCount = 0;
+        for (uint32_t eye = 0; eye < 2; eye++) {
+            if (!(input.flags & (eye ? pvremu::GazeSampleFlags_RightValid : pvremu::GazeSampleFlags_LeftValid))) {
+                continue;
+            }
+            gaze.x += input.gaze[eye][0];
+            gaze.y += input.gaze[eye][1];
+            gaze.z += input.gaze[eye][2];
+            confidence += input.confidence[eye];
+            validCount++;
+        }
+
+        const float length = std::sqrt(gaze.x * gaze.x + gaze.y * gaze.y + gaze.z * gaze.z);
+        if (!validCount || length <= 0.f) {
+            return false;
+        }
+
+        sample.gaze = {gaze.x / length, gaze.y / length, gaze.z / length};
+        sample.confidence = confidence / validCount;
+        return true;
+    }
+
+    std::unique_ptr<IEyeTracker> createSharedMemoryEyeTracker() {
+        return createNamedSharedMemoryEyeTracker(pvremu::GazeSharedMemoryName, "Shared memory");
+    }
+
+    std::unique_ptr<IEyeTracker> createNamedSharedMemoryEyeTracker(const char* mappingName,
+                                                                   const std::string& displayName) {
+        wil::unique_handle mapping(OpenFileMappingA(FILE_MAP_READ, FALSE, mappingName));
+        if (!mapping) {
+            return nullptr;
+        }
+
+        const auto shm = static_cast<const pvremu::GazeSharedMemory*>(
+            MapViewOfFile(mapping.get(), FILE_MAP_READ, 0, 0, sizeof(pvremu::GazeSharedMemory)));
+        if (!shm) {
+            return nullptr;
+        }
+
+        if (shm->magic != pvremu::GazeSharedMemoryMagic || shm->version != pvremu::GazeSharedMemoryVersion ||
+            shm->slotCount != pvremu::GazeSlotCount || shm->slotSize != sizeof(pvremu::GazeSlot)) {
+            Log(fmt::format("Incompatible gaze shared memory (version {})\n", shm->version));
+            UnmapViewOfFile(shm);
+            return nullptr;
+        }
+
+        return std::make_unique<SharedMemoryEyeTracker>(std::move(mapping), shm, displayName);
+    }
+
+} // namespace openxr_api_layer
@@ -0,0 +1,43 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include <pvremu_gaze_shm.h>
+
+#include "eye_tracker.h"
+
+namespace openxr_api_layer {
+
+    // Combine the valid eyes of a sample from pvremu_gaze_shm.h into a single gaze. The time is left untouched.
+    bool combineGazeSample(const pvremu::GazeSample& input, EyeGazeSample& sample);
+
+    // Reads the gaze published by another process with the producer from pvremu_gaze_shm.h. Returns nullptr if no
+    // producer is running.
+    std::unique_ptr<IEyeTracker> createSharedMemoryEyeTracker();
+
+    // Same as above, for a region with the same layout under another name.
+    std::unique_ptr<IEyeTracker> createNamedSharedMemoryEyeTracker(const char* mappingName,
+                                                                   const std::string& displayName);
+
+} // namespace openxr_api_layer
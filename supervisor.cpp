@@ -0,0 +1,230 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "log.h"
+using namespace openxr_api_layer::log;
+
+#include <trackers.h>
+
+#include "supervisor.h"
+
+namespace openxr_api_layer {
+
+    namespace {
+
+        constexpr auto SupervisorPeriod = std::chrono::seconds(1);
+
+        // How long the data must be invalid before we attempt to find a new tracker.
+        constexpr auto InvalidDataThreshold = std::chrono::seconds(5);
+
+        // How long to wait between attempts when probing does not help (eg: the headset is not worn).
+        constexpr auto MinRetryDelay = std::chrono::seconds(10);
+        constexpr auto MaxRetryDelay = std::chrono::minutes(5);
+
+        // How long to wait for the render thread to let go of a retired tracker.
+        constexpr auto RetireTimeout = std::chrono::seconds(2);
+        constexpr auto RetirePollPeriod = std::chrono::milliseconds(5);
+
+        int64_t now() {
+            return std::chrono::steady_clock::now().time_since_epoch().count();
+        }
+
+        int64_t toMilliseconds(int64_t ticks) {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::duration(ticks))
+                .count();
+        }
+
+    } // namespace
+
+    TrackerSupervisor::TrackerSupervisor(std::function<ProbeResult()> probe, ProbeResult initial)
+        : m_probe(std::move(probe)), m_tracker(std::move(initial.tracker)), m_trackerName(initial.name) {
+        // We only supervise sessions that had a tracker to begin with. Without a tracker, the user gets fixed
+        // foveation and we do not want to keep probing for nothing.
+        if (m_tracker) {
+            m_supervisorThread = std::thread([&]() { supervisorThread(); });
+        }
+    }
+
+    TrackerSupervisor::~TrackerSupervisor() {
+        if (m_supervisorThread.joinable()) {
+            {
+                std::unique_lock lock(m_supervisorMutex);
+                m_stopSupervisor = true;
+            }
+            m_supervisorWakeup.notify_all();
+            m_supervisorThread.join();
+        }
+    }
+
+    std::shared_ptr<IEyeTracker> TrackerSupervisor::getTracker() const {
+        return std::atomic_load(&m_tracker);
+    }
+
+    void TrackerSupervisor::reportGaze(bool isValid) {
+        const int64_t time = now();
+        m_lastGazeAttemptTime.store(time, std::memory_order_relaxed);
+        if (isValid) {
+            m_lastValidGazeTime.store(time, std::memory_order_relaxed);
+
+            if (m_isRecovering.exchange(false)) {
+                const int64_t recovery = toMilliseconds(time - m_failureTime.load());
+                TraceLoggingWrite(g_traceProvider, "TrackerSupervisor_Recovered", TLArg(recovery, "DurationMs"));
+                Log(fmt::format("Eye tracking recovered {}ms after data was lost\n", recovery));
+            }
+        }
+    }
+
+    void TrackerSupervisor::start() {
+        std::unique_lock lock(m_startMutex);
+
+        m_isStarted = true;
+
+        const auto tracker = getTracker();
+        if (tracker) {
+            tracker->start(XR_NULL_HANDLE);
+        }
+    }
+
+    void TrackerSupervisor::supervisorThread() {
+        auto retryDelay = std::chrono::steady_clock::duration(MinRetryDelay);
+        int64_t nextAttemptTime = 0;
+
+        // When the current tracker was installed, and whether it has delivered valid data since. A new tracker gets a
+        // grace period before being judged, but only real data resets the backoff.
+        int64_t installTime = now();
+        bool isProven = true;
+
+        std::unique_lock lock(m_supervisorMutex);
+        while (!m_supervisorWakeup.wait_for(lock, SupervisorPeriod, [&] { return m_stopSupervisor; })) {
+            releaseRetiredTrackers();
+
+            const int64_t time = now();
+            const int64_t lastAttempt = m_lastGazeAttemptTime.load(std::memory_order_relaxed);
+            const int64_t lastValid = m_lastValidGazeTime.load(std::memory_order_relaxed);
+
+            if (!isProven && lastValid > installTime) {
+                isProven = true;
+                retryDelay = MinRetryDelay;
+            }
+
+            // Only judge the tracker when the application is actually asking for gaze data.
+            const bool isInUse = time - lastAttempt < std::chrono::steady_clock::duration(SupervisorPeriod).count();
+            const int64_t lastHealthy = std::max(lastValid, installTime);
+            if (!isInUse || time - lastHealthy < std::chrono::steady_clock::duration(InvalidDataThreshold).count()) {
+                if (isProven) {
+                    retryDelay = MinRetryDelay;
+                }
+                continue;
+            }
+            if (time < nextAttemptTime) {
+                continue;
+            }
+
+            TraceLocalActivity(local);
+
+            TraceLoggingWriteStart(local, "TrackerSupervisor_Reprobe", TLArg(m_trackerName.c_str(), "Current"));
+            Log(fmt::format("No eye tracking data from {} for {}ms, probing again\n",
+                            m_trackerName,
+                            toMilliseconds(time - lastValid)));
+
+            if (!m_isRecovering) {
+                m_failureTime = lastValid;
+            }
+
+            // Trackers may hold exclusive resources (eg: a socket), so the old tracker must be destroyed before probing.
+            // The render thread falls back to fixed foveation in the meantime.
+            const std::string failedName = m_trackerName;
+            replaceTracker(nullptr, failedName);
+            if (!releaseRetiredTrackers(RetireTimeout)) {
+                Log(fmt::format("{} is still in use after {}ms, probing anyway\n",
+                                failedName,
+                                std::chrono::duration_cast<std::chrono::milliseconds>(RetireTimeout).count()));
+            }
+
+            ProbeResult result = m_probe();
+            if (result.tracker) {
+                std::unique_lock startLock(m_startMutex);
+                if (m_isStarted) {
+                    result.tracker->start(XR_NULL_HANDLE);
+                }
+                replaceTracker(std::move(result.tracker), result.name);
+                m_isRecovering = true;
+            } else {
+                Log("No eye tracker found, will retry later\n");
+            }
+            installTime = now();
+            isProven = false;
+
+            nextAttemptTime = now() + retryDelay.count();
+            retryDelay = std::min<std::chrono::steady_clock::duration>(retryDelay * 2, MaxRetryDelay);
+
+            TraceLoggingWriteStop(local, "TrackerSupervisor_Reprobe", TLArg(result.name.c_str(), "New"));
+        }
+    }
+
+    bool TrackerSupervisor::releaseRetiredTrackers(std::chrono::steady_clock::duration timeout) {
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (true) {
+            // Once the tracker is out of m_tracker, the render thread cannot acquire a new reference to it. When we hold
+            // the last reference, the teardown happens here and never inside getEyeTrackingInfo().
+            m_retired.erase(std::remove_if(m_retired.begin(),
+                                           m_retired.end(),
+                                           [](const std::shared_ptr<IEyeTracker>& tracker) {
+                                               return tracker.use_count() == 1;
+                                           }),
+                            m_retired.end());
+            if (m_retired.empty()) {
+                return true;
+            }
+            if (std::chrono::steady_clock::now() >= deadline) {
+                return false;
+            }
+            std::this_thread::sleep_for(RetirePollPeriod);
+        }
+    }
+
+    void TrackerSupervisor::replaceTracker(std::shared_ptr<IEyeTracker> tracker, const std::string& name) {
+        std::shared_ptr<IEyeTracker> previous = std::atomic_exchange(&m_tracker, std::move(tracker));
+        if (previous) {
+            m_retired.push_back(std::move(previous));
+        }
+
+        if (getTracker()) {
+            // Probing may land on the tracker that just failed, in which case this is a fresh instance of the same
+            // source rather than a switch to another one.
+            if (name == m_trackerName) {
+                TraceLoggingWrite(g_traceProvider, "TrackerSupervisor_Reopen", TLArg(name.c_str(), "Name"));
+                Log(fmt::format("Reopened eye tracker: {}\n", name));
+            } else {
+                TraceLoggingWrite(g_traceProvider,
+                                  "TrackerSupervisor_Swap",
+                                  TLArg(m_trackerName.c_str(), "Previous"),
+                                  TLArg(name.c_str(), "New"));
+                Log(fmt::format("Swapped eye tracker: {} -> {}\n", m_trackerName, name));
+                m_trackerName = name;
+            }
+        }
+    }
+
+} // namespace openxr_api_layer
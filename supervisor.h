@@ -0,0 +1,76 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "probe.h"
+
+namespace openxr_api_layer {
+
+    // Owns the active eye tracker and watches its health. When the tracker stops delivering valid data for too long
+    // (eg: the streamer app was restarted), probing is run again in the background and the tracker is replaced.
+    class TrackerSupervisor {
+      public:
+        TrackerSupervisor(std::function<ProbeResult()> probe, ProbeResult initial);
+        ~TrackerSupervisor();
+
+        // Called from the render thread. Never blocks on the supervisor.
+        std::shared_ptr<IEyeTracker> getTracker() const;
+        void reportGaze(bool isValid);
+
+        // Start tracking, now and for any future tracker.
+        void start();
+
+      private:
+        void supervisorThread();
+        void replaceTracker(std::shared_ptr<IEyeTracker> tracker, const std::string& name);
+
+        // Destroy the retired trackers that the render thread no longer references, waiting up to the timeout for it
+        // to let go of them. Returns whether all of them could be destroyed.
+        bool releaseRetiredTrackers(std::chrono::steady_clock::duration timeout = {});
+
+        const std::function<ProbeResult()> m_probe;
+
+        std::shared_ptr<IEyeTracker> m_tracker;
+        std::string m_trackerName;
+        std::mutex m_startMutex;
+        bool m_isStarted{false};
+
+        // Health of the current tracker, in steady_clock ticks.
+        std::atomic<int64_t> m_lastGazeAttemptTime{0};
+        std::atomic<int64_t> m_lastValidGazeTime{0};
+
+        // Set after a swap, until the first valid gaze from the new tracker.
+        std::atomic<bool> m_isRecovering{false};
+        std::atomic<int64_t> m_failureTime{0};
+
+        // Trackers that were replaced, but that the render thread might still be referencing. Only touched by the
+        // supervisor thread.
+        std::vector<std::shared_ptr<IEyeTracker>> m_retired;
+
+        std::thread m_supervisorThread;
+        std::mutex m_supervisorMutex;
+        std::condition_variable m_supervisorWakeup;
+        bool m_stopSupervisor{false};
+    };
+
+} // namespace openxr_api_layer
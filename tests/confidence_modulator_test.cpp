@@ -0,0 +1,148 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "check.h"
+#include "confidence.h"
+
+using namespace openxr_api_layer;
+using namespace pvremu_tests;
+
+namespace {
+
+    constexpr auto QueryPeriod = std::chrono::microseconds(11'111);
+
+    // Feeds the same confidence at 90Hz for the given duration.
+    std::chrono::steady_clock::time_point feed(ConfidenceModulator& modulator,
+                                               std::chrono::steady_clock::time_point time,
+                                               float confidence,
+                                               std::chrono::milliseconds duration) {
+        const auto end = time + duration;
+        for (; time < end; time += QueryPeriod) {
+            modulator.update(confidence, time);
+        }
+        return time;
+    }
+
+    void testStepDown() {
+        ConfidenceModulator modulator;
+        auto time = feed(modulator, {}, 1.f, std::chrono::milliseconds(500));
+        CHECK(modulator.adjustMode(1) == 1);
+
+        // Below the first low threshold (0.6).
+        time = feed(modulator, time, 0.5f, std::chrono::milliseconds(1000));
+        CHECK(modulator.adjustMode(1) == 2);
+
+        // Below the second low threshold (0.3).
+        feed(modulator, time, 0.2f, std::chrono::milliseconds(1000));
+        CHECK(modulator.adjustMode(1) == 3);
+    }
+
+    void testRecoveryHold() {
+        ConfidenceModulator modulator;
+        auto time = feed(modulator, {}, 0.5f, std::chrono::milliseconds(1000));
+        CHECK(modulator.adjustMode(1) == 2);
+
+        // The smoothed confidence goes above the high threshold (0.75) within about 100ms, then must hold for 500ms.
+        time = feed(modulator, time, 1.f, std::chrono::milliseconds(400));
+        CHECK(modulator.adjustMode(1) == 2);
+        time = feed(modulator, time, 1.f, std::chrono::milliseconds(400));
+        CHECK(modulator.adjustMode(1) == 1);
+
+        // A dip under the high threshold restarts the hold.
+        time = feed(modulator, time, 0.5f, std::chrono::milliseconds(1000));
+        CHECK(modulator.adjustMode(1) == 2);
+        time = feed(modulator, time, 1.f, std::chrono::milliseconds(400));
+        time = feed(modulator, time, 0.65f, std::chrono::milliseconds(200));
+        time = feed(modulator, time, 1.f, std::chrono::milliseconds(400));
+        CHECK(modulator.adjustMode(1) == 2);
+        feed(modulator, time, 1.f, std::chrono::milliseconds(400));
+        CHECK(modulator.adjustMode(1) == 1);
+    }
+
+    void testNoFlicker() {
+        // A noisy confidence between the low (0.6) and high (0.75) thresholds of the first step.
+        ConfidenceModulator modulator;
+        auto time = feed(modulator, {}, 0.5f, std::chrono::milliseconds(1000));
+        CHECK(modulator.adjustMode(1) == 2);
+
+        uint32_t changeCount = 0;
+        uint32_t previousMode = modulator.adjustMode(1);
+        for (uint32_t i = 0; i < 1000; i++) {
+            modulator.update(i % 2 ? 0.58f : 0.76f, time);
+            time += QueryPeriod;
+            const uint32_t mode = modulator.adjustMode(1);
+            changeCount += mode != previousMode;
+            previousMode = mode;
+        }
+        CHECK(changeCount == 0);
+        CHECK(modulator.adjustMode(1) == 2);
+
+        // The same from the high side: no step back either.
+        ConfidenceModulator recovered;
+        time = feed(recovered, {}, 1.f, std::chrono::milliseconds(500));
+        for (uint32_t i = 0; i < 1000; i++) {
+            recovered.update(i % 2 ? 0.58f : 0.76f, time);
+            time += QueryPeriod;
+            changeCount += recovered.adjustMode(1) != 1;
+        }
+        CHECK(changeCount == 0);
+    }
+
+    void testGapInUpdates() {
+        // Blinks are not reported: the confidence holds across the gap.
+        ConfidenceModulator modulator;
+        auto time = feed(modulator, {}, 1.f, std::chrono::milliseconds(500));
+        time += std::chrono::milliseconds(400);
+        feed(modulator, time, 1.f, std::chrono::milliseconds(100));
+        CHECK(modulator.adjustMode(1) == 1);
+    }
+
+    void testModeClamp() {
+        ConfidenceModulator modulator;
+        feed(modulator, {}, 0.f, std::chrono::milliseconds(1000));
+
+        // Stepped back twice, never beyond minimum.
+        CHECK(modulator.adjustMode(1) == 3);
+        CHECK(modulator.adjustMode(2) == 3);
+        CHECK(modulator.adjustMode(3) == 3);
+
+        // Off and debug are left alone.
+        CHECK(modulator.adjustMode(0) == 0);
+        CHECK(modulator.adjustMode(4) == 4);
+
+        // Back to the requested level when the gaze is not used.
+        modulator.reset();
+        CHECK(modulator.adjustMode(1) == 1);
+    }
+
+} // namespace
+
+int main() {
+    testStepDown();
+    testRecoveryHold();
+    testNoFlicker();
+    testGapInUpdates();
+    testModeClamp();
+    return testResult();
+}
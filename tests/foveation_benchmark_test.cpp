@@ -0,0 +1,83 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "benchmark.h"
+#include "check.h"
+
+using namespace openxr_api_layer;
+using namespace pvremu_tests;
+
+namespace {
+
+    // Median GPU frame times for off, maximum, balanced and minimum.
+    std::array<DurationHistogram, 4> makeFrameTimes(const std::array<float, 4>& medianMs, uint32_t frameCount = 300) {
+        std::array<DurationHistogram, 4> frameTimes;
+        for (uint32_t mode = 0; mode < 4; mode++) {
+            for (uint32_t i = 0; i < frameCount; i++) {
+                frameTimes[mode].add(medianMs[mode]);
+            }
+        }
+        return frameTimes;
+    }
+
+    void testLeastAggressiveSufficientMode() {
+        // Best saving 30% (maximum). Balanced saves 25%, which is more than 2/3 of it.
+        CHECK(recommendFoveationMode(makeFrameTimes({10.f, 7.f, 7.5f, 9.f})) == 2u);
+
+        // Minimum saves 24%, which is enough already.
+        CHECK(recommendFoveationMode(makeFrameTimes({10.f, 7.f, 7.5f, 7.6f})) == 3u);
+
+        // Only maximum gets close to the best saving.
+        CHECK(recommendFoveationMode(makeFrameTimes({10.f, 6.f, 8.f, 9.f})) == 1u);
+    }
+
+    void testNotWorthIt() {
+        // No mode saves 5%: the benchmark is done, and foveation should stay off.
+        const auto mode = recommendFoveationMode(makeFrameTimes({10.f, 9.7f, 9.8f, 9.9f}));
+        CHECK(mode == 0u);
+
+        // Foveation making things worse is no different.
+        CHECK(recommendFoveationMode(makeFrameTimes({10.f, 11.f, 10.5f, 10.2f})) == 0u);
+    }
+
+    void testNotEnoughFrames() {
+        CHECK(!recommendFoveationMode(makeFrameTimes({10.f, 7.f, 7.5f, 9.f}, 50)));
+
+        // A single mode short of frames is enough to not conclude, including the baseline.
+        auto frameTimes = makeFrameTimes({10.f, 7.f, 7.5f, 9.f});
+        frameTimes[0] = {};
+        CHECK(!recommendFoveationMode(frameTimes));
+        frameTimes = makeFrameTimes({10.f, 7.f, 7.5f, 9.f});
+        frameTimes[3] = {};
+        CHECK(!recommendFoveationMode(frameTimes));
+    }
+
+} // namespace
+
+int main() {
+    testLeastAggressiveSufficientMode();
+    testNotWorthIt();
+    testNotEnoughFrames();
+    return testResult();
+}
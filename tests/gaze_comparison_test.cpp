@@ -0,0 +1,112 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "pch.h"
+
+#include <trackers.h>
+
+#include "check.h"
+#include "comparison.h"
+#include "synthetic_gaze.h"
+
+using namespace openxr_api_layer;
+using namespace pvremu_tests;
+
+namespace {
+
+    void testLatencyEstimate() {
+        // B sees the same eye movements as A, 12ms later.
+        const SyntheticGaze gaze(1, 100);
+        std::vector<GazeComparisonRecord> records;
+        gaze.sample(records, 0, 90.0, 0.0, 0.1f, 2);
+        gaze.sample(records, 1, 90.0, 0.012, 0.1f, 3);
+
+        GazeComparisonReport report = analyzeGazeComparison(records);
+        CHECK(report.recordCount == records.size());
+        CHECK(report.bothValid == 1.0);
+        CHECK(report.meanDivergence > 0.0);
+
+        // The cross-correlation is only run on demand.
+        CHECK(!report.correlation);
+        CHECK(!report.latencyMs);
+
+        estimateGazeLatency(records, report);
+        CHECK(report.correlation && report.correlation.value() > 0.9);
+        CHECK(report.latencyMs && std::abs(report.latencyMs.value() - 12.0) < 2.0);
+
+        // And the other way around.
+        for (auto& record : records) {
+            std::swap(record.gaze[0], record.gaze[1]);
+        }
+        estimateGazeLatency(records, report);
+        CHECK(report.latencyMs && std::abs(report.latencyMs.value() + 12.0) < 2.0);
+    }
+
+    void testUncorrelatedTraces() {
+        const SyntheticGaze a(1, 100), b(2, 100);
+        std::vector<GazeComparisonRecord> records;
+        a.sample(records, 0, 90.0, 0.0, 0.1f, 2);
+        b.sample(records, 1, 90.0, 0.0, 0.1f, 3);
+
+        GazeComparisonReport report = analyzeGazeComparison(records);
+        estimateGazeLatency(records, report);
+        CHECK(!report.latencyMs);
+    }
+
+    void testCaptureRoundTrip() {
+        const SyntheticGaze gaze(1, 10);
+        std::vector<GazeComparisonRecord> records;
+        gaze.sample(records, 0, 90.0, 0.0, 0.1f, 2);
+        gaze.sample(records, 1, 90.0, 0.0, 0.1f, 3);
+        for (size_t i = 0; i < records.size(); i += 7) {
+            records[i].isValid[1] = false;
+        }
+
+        const std::string names[2] = {"First", "Second tracker"};
+        const auto path = std::filesystem::temp_directory_path() / "pvremu_gaze_comparison_test.csv";
+        CHECK(writeGazeCapture(path, names, records));
+
+        std::string readNames[2];
+        std::vector<GazeComparisonRecord> readRecords;
+        CHECK(readGazeCapture(path, readNames, readRecords));
+        std::filesystem::remove(path);
+
+        CHECK(readNames[0] == names[0] && readNames[1] == names[1]);
+        CHECK(readRecords.size() == records.size());
+        for (size_t i = 0; i < std::min(records.size(), readRecords.size()); i++) {
+            CHECK(std::abs(readRecords[i].time - records[i].time) < 1e-5);
+            for (size_t trace = 0; trace < 2; trace++) {
+                CHECK(readRecords[i].isValid[trace] == records[i].isValid[trace]);
+                CHECK(std::abs(readRecords[i].gaze[trace].x - records[i].gaze[trace].x) < 1e-5f);
+            }
+        }
+    }
+
+} // namespace
+
+int main() {
+    testLatencyEstimate();
+    testUncorrelatedTraces();
+    testCaptureRoundTrip();
+    return testResult();
+}
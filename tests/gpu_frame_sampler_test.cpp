@@ -0,0 +1,170 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "pch.h"
+
+#include <trackers.h>
+
+#include "check.h"
+#include "frame_timing.h"
+
+using namespace openxr_api_layer;
+using namespace pvremu_tests;
+
+namespace {
+
+    // One call to getFrameTimings(): the history returned by the compositor, and the foveation state at that time.
+    struct Batch {
+        std::vector<GpuFrameTiming> timings;
+        FoveationState state;
+    };
+
+    // Plays a script of compositor histories, one per sampling period, then reports that the script is over.
+    class SimulatedFrameTimingSource : public IFrameTimingSource {
+      public:
+        SimulatedFrameTimingSource(std::vector<Batch> batches) : m_batches(std::move(batches)) {
+        }
+
+        size_t getFrameTimings(GpuFrameTiming* timings, size_t count) override {
+            std::unique_lock lock(m_mutex);
+            if (m_next == m_batches.size()) {
+                // The sampler has processed every batch.
+                m_isDone = true;
+                m_doneCondition.notify_all();
+                return 0;
+            }
+            const Batch& batch = m_batches[m_next++];
+            m_state = batch.state;
+            const size_t copied = std::min(count, batch.timings.size());
+            std::copy_n(batch.timings.end() - copied, copied, timings);
+            return copied;
+        }
+
+        FoveationState getState() {
+            std::unique_lock lock(m_mutex);
+            return m_state;
+        }
+
+        bool waitUntilDone(std::chrono::milliseconds timeout) {
+            std::unique_lock lock(m_mutex);
+            return m_doneCondition.wait_for(lock, timeout, [&] { return m_isDone; });
+        }
+
+      private:
+        const std::vector<Batch> m_batches;
+
+        std::mutex m_mutex;
+        std::condition_variable m_doneCondition;
+        size_t m_next{0};
+        FoveationState m_state{};
+        bool m_isDone{false};
+    };
+
+    std::vector<GpuFrameTiming> frames(uint32_t first, uint32_t last, float gpuMs) {
+        std::vector<GpuFrameTiming> timings;
+        for (uint32_t index = first; index <= last; index++) {
+            timings.push_back({index, gpuMs});
+        }
+        return timings;
+    }
+
+    bool isNear(float value, float expected) {
+        // Within the bucket size of the histogram.
+        return std::abs(value - expected) < expected * 0.05f;
+    }
+
+    void testBinning() {
+        std::vector<Batch> batches;
+
+        // Rendered before the sampler started, with an unknown state.
+        batches.push_back({frames(1, 3, 8.f), {1, true}});
+
+        // The compositor history overlaps the previous period, and frame 6 could not be measured.
+        std::vector<GpuFrameTiming> overlapping = frames(2, 5, 8.f);
+        overlapping.push_back({6, 0.f});
+        batches.push_back({overlapping, {1, true}});
+
+        // The user switched to the minimum mode.
+        batches.push_back({frames(5, 8, 11.f), {3, true}});
+
+        // The application restarted its frame counter: the state of these frames is unknown.
+        batches.push_back({frames(1, 2, 20.f), {3, true}});
+
+        // Foveation is not active (for example, in a menu).
+        batches.push_back({frames(2, 4, 9.f), {3, false}});
+
+        auto source = std::make_unique<SimulatedFrameTimingSource>(std::move(batches));
+        SimulatedFrameTimingSource& simulation = *source;
+
+        std::mutex listenerMutex;
+        std::vector<float> listened;
+        GpuFrameSampler sampler(
+            std::move(source), [&] { return simulation.getState(); }, [&](float gpuMs) {
+                std::unique_lock lock(listenerMutex);
+                listened.push_back(gpuMs);
+            });
+        CHECK(simulation.waitUntilDone(std::chrono::seconds(10)));
+
+        const GpuFrameTimes frameTimes = sampler.getFrameTimes();
+        const DurationHistogram& maximum = frameTimes.get({1, true});
+        CHECK(maximum.getCount() == 2);
+        CHECK(isNear(maximum.getPercentile(0.5f), 8.f));
+
+        const DurationHistogram& minimum = frameTimes.get({3, true});
+        CHECK(minimum.getCount() == 2);
+        CHECK(isNear(minimum.getPercentile(0.5f), 11.f));
+
+        const DurationHistogram& inactive = frameTimes.get({3, false});
+        CHECK(inactive.getCount() == 2);
+        CHECK(isNear(inactive.getPercentile(0.5f), 9.f));
+
+        CHECK(frameTimes.get({0, false}).getCount() == 0);
+        CHECK(frameTimes.get({1, false}).getCount() == 0);
+        CHECK(frameTimes.get({2, true}).getCount() == 0);
+
+        std::unique_lock lock(listenerMutex);
+        CHECK((listened == std::vector<float>{8.f, 8.f, 11.f, 11.f, 9.f, 9.f}));
+    }
+
+    void testNoFrames() {
+        // No application rendering: nothing is recorded, and the sampler stops promptly.
+        auto source = std::make_unique<SimulatedFrameTimingSource>(std::vector<Batch>{});
+        SimulatedFrameTimingSource& simulation = *source;
+        const auto start = std::chrono::steady_clock::now();
+        {
+            GpuFrameSampler sampler(std::move(source), [&] { return simulation.getState(); });
+            CHECK(simulation.waitUntilDone(std::chrono::seconds(10)));
+            for (uint32_t mode = 0; mode < FoveationModeCount; mode++) {
+                CHECK(sampler.getFrameTimes().get({mode, true}).getCount() == 0);
+            }
+        }
+        CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(1));
+    }
+
+} // namespace
+
+int main() {
+    testBinning();
+    testNoFrames();
+    return testResult();
+}
@@ -0,0 +1,258 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Fuzzing of the OSC decoder. The packets are mutated from a corpus of valid eye tracking packets with a fixed seed, so
+// that any failure reproduces. CTest builds it with the address and undefined behavior sanitizers when the compiler
+// supports them, and with -DPVREMU_LIBFUZZER=ON (Clang only) the same entry point is driven by libFuzzer instead.
+
+#include "pch.h"
+
+#include <trackers.h>
+
+#include <netinet/in.h>
+#include <random>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "check.h"
+#include "osc.h"
+#include "osc_encoder.h"
+
+using namespace openxr_api_layer;
+using namespace pvremu_tests;
+
+namespace {
+
+    // Decode like the OSC tracker does, and touch everything that the decoder hands out.
+    bool decodeAndUpdate(const uint8_t* data, size_t size, size_t* messageCount = nullptr) {
+        osc::GazeState state;
+        const auto now = std::chrono::steady_clock::now();
+        size_t count = 0;
+        const bool isValid = osc::decodePacket(data, size, [&](const osc::Message& message) {
+            CHECK(message.valueCount <= osc::MaxArguments);
+            CHECK(message.address.data() >= (const char*)data &&
+                  message.address.data() + message.address.size() <= (const char*)data + size);
+            state.update(message, now);
+            count++;
+        });
+        EyeGazeSample sample;
+        if (state.getGazeSample(sample)) {
+            CHECK(sample.confidence > 0.f && sample.confidence <= 1.f);
+        }
+        if (messageCount) {
+            *messageCount = count;
+        }
+        return isValid;
+    }
+
+    // A message with every argument type that the decoder knows how to skip or convert.
+    OscPacket allTypesMessage() {
+        OscPacket packet;
+        appendOscString(packet, "/tracking/eye/LeftRightPitchYaw");
+        appendOscString(packet, ",ifhdTFNIsbtcrm[]");
+        appendOscUint32(packet, (uint32_t)-3);
+        appendOscUint32(packet, 0x3f800000); // 1.f
+        appendOscUint64(packet, (uint64_t)-7);
+        appendOscUint64(packet, 0x4000000000000000ull); // 2.0
+        appendOscString(packet, "string");
+        appendOscUint32(packet, 5);
+        appendOscString(packet, "blob");
+        appendOscUint64(packet, osc::ImmediateTimetag);
+        appendOscUint32(packet, 'c');
+        appendOscUint32(packet, 0xff0000ff);
+        appendOscUint32(packet, 0x00904000);
+        return packet;
+    }
+
+    std::vector<OscPacket> makeCorpus() {
+        std::vector<OscPacket> corpus;
+        corpus.push_back(oscMessage("/tracking/eye/LeftRightPitchYaw", {1.f, -2.f, 3.f, -4.f}));
+        corpus.push_back(oscMessage("/tracking/eye/CenterPitchYaw", {5.f, 6.f}));
+        corpus.push_back(oscMessage("/tracking/eye/CenterVec", {0.1f, 0.2f, 0.9f}));
+        corpus.push_back(oscMessage("/tracking/eye/EyesClosedAmount", {0.1f}));
+        corpus.push_back(oscMessage("/avatar/parameters/LeftEyeX", {0.5f}));
+        corpus.push_back(oscMessage("/avatar/parameters/FT/v2/EyeY", {-0.5f}));
+        corpus.push_back(oscMessage("/avatar/parameters/Unrelated", {}));
+        corpus.push_back(allTypesMessage());
+        corpus.push_back(oscBundle(osc::ImmediateTimetag,
+                                   {oscMessage("/avatar/parameters/v2/EyeLeftX", {0.1f}),
+                                    oscMessage("/avatar/parameters/v2/EyeLeftY", {0.2f}),
+                                    oscMessage("/avatar/parameters/v2/EyeRightX", {0.3f}),
+                                    oscMessage("/avatar/parameters/v2/EyeRightY", {0.4f}),
+                                    oscMessage("/avatar/parameters/v2/EyeLidLeft", {1.f}),
+                                    oscMessage("/avatar/parameters/v2/EyeLidRight", {1.f})}));
+        corpus.push_back(oscBundle(
+            nanosecondsToTimetag(1'000'000'000),
+            {oscBundle(nanosecondsToTimetag(2'000'000'000),
+                       {oscMessage("/tracking/eye/CenterPitchYaw", {1.f, 2.f}), allTypesMessage()}),
+             oscMessage("/avatar/parameters/FT/EyesX", {0.7f})}));
+        return corpus;
+    }
+
+    // Same as libFuzzer: small structural edits, with a bias towards the size fields.
+    void mutate(OscPacket& packet, std::mt19937& random) {
+        const auto pick = [&](size_t count) { return std::uniform_int_distribution<size_t>(0, count - 1)(random); };
+        const int mutationCount = 1 + (int)pick(4);
+        for (int i = 0; i < mutationCount; i++) {
+            switch (pick(6)) {
+            case 0:
+                if (!packet.empty()) {
+                    packet[pick(packet.size())] ^= (uint8_t)(1 << pick(8));
+                }
+                break;
+            case 1:
+                if (!packet.empty()) {
+                    packet[pick(packet.size())] = (uint8_t)pick(256);
+                }
+                break;
+            case 2:
+                packet.resize(pick(packet.size() + 1));
+                break;
+            case 3:
+                for (size_t count = pick(16); count; count--) {
+                    packet.push_back((uint8_t)pick(256));
+                }
+                break;
+            case 4:
+                // Sizes and lengths are 32-bit aligned.
+                if (packet.size() >= 4) {
+                    static constexpr uint32_t interesting[] = {0, 1, 3, 4, 8, 16, 0x7fffffff, 0xfffffffc, 0xffffffff};
+                    const size_t offset = pick(packet.size() / 4) * 4;
+                    uint32_t value = interesting[pick(std::size(interesting))];
+                    if (pick(2)) {
+                        value = (uint32_t)packet.size() - (uint32_t)offset + (uint32_t)pick(9) - 4;
+                    }
+                    for (int byte = 0; byte < 4; byte++) {
+                        packet[offset + byte] = (uint8_t)(value >> (24 - 8 * byte));
+                    }
+                }
+                break;
+            case 5:
+                if (packet.size() >= 4) {
+                    const size_t offset = pick(packet.size() / 4) * 4;
+                    const size_t length = std::min(packet.size() - offset, 4 * (1 + pick(8)));
+                    const OscPacket chunk(packet.begin() + offset, packet.begin() + offset + length);
+                    packet.insert(packet.begin() + pick(packet.size() / 4 + 1) * 4, chunk.begin(), chunk.end());
+                }
+                break;
+            }
+        }
+    }
+
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    // Copy to an exact-size allocation, so that the sanitizer catches reads past the end.
+    const OscPacket packet(data, data + size);
+    decodeAndUpdate(packet.data(), packet.size());
+    return 0;
+}
+
+#ifndef PVREMU_LIBFUZZER
+
+namespace {
+
+    constexpr int MutationCount = 200'000;
+
+    void testCorpus(const std::vector<OscPacket>& corpus) {
+        for (const auto& packet : corpus) {
+            size_t messageCount = 0;
+            CHECK(decodeAndUpdate(packet.data(), packet.size(), &messageCount));
+            CHECK(messageCount > 0);
+        }
+
+        // Arguments are converted in order, and the unsupported types are skipped.
+        const OscPacket packet = allTypesMessage();
+        osc::Message decoded;
+        CHECK(osc::decodePacket(
+            packet.data(), packet.size(), [&](const osc::Message& message) { decoded = message; }));
+        CHECK(decoded.valueCount == 6);
+        CHECK(decoded.values[0] == -3.f && decoded.values[1] == 1.f && decoded.values[2] == -7.f);
+        CHECK(decoded.values[3] == 2.f && decoded.values[4] == 1.f && decoded.values[5] == 0.f);
+
+        CHECK(osc::lookupAddress("/avatar/parameters/FT/v2/EyeY") == osc::Address::V2EyeY);
+        CHECK(osc::lookupAddress("/avatar/parameters/LeftEyeX") == osc::Address::V1LeftEyeX);
+        CHECK(osc::lookupAddress("/avatar/parameters/v2/EyeY/") == osc::Address::Unknown);
+    }
+
+    void testMutations(const std::vector<OscPacket>& corpus) {
+        std::mt19937 random(1);
+        size_t rejected = 0;
+        for (int i = 0; i < MutationCount; i++) {
+            OscPacket packet = corpus[i % corpus.size()];
+            mutate(packet, random);
+            rejected += !decodeAndUpdate(packet.data(), packet.size());
+        }
+
+        // The mutations must reach past the validation, and also trip it.
+        CHECK(rejected > MutationCount / 10 && rejected < MutationCount * 9 / 10);
+    }
+
+    // Local stand-in for a sender: the packets go through a UDP socket like they would from VRCFaceTracking.
+    void testLoopbackSender(const std::vector<OscPacket>& corpus) {
+        const int receiver = socket(AF_INET, SOCK_DGRAM, 0);
+        const int sender = socket(AF_INET, SOCK_DGRAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t addressSize = sizeof(address);
+        const bool isOpen = receiver >= 0 && sender >= 0 &&
+                            !bind(receiver, (const sockaddr*)&address, sizeof(address)) &&
+                            !getsockname(receiver, (sockaddr*)&address, &addressSize);
+        CHECK(isOpen);
+        if (isOpen) {
+            std::mt19937 random(2);
+            size_t validCount = 0;
+            for (int i = 0; i < 64; i++) {
+                OscPacket packet = corpus[i % corpus.size()];
+                if (i % 2) {
+                    mutate(packet, random);
+                } else {
+                    validCount++;
+                }
+                sendto(sender, packet.data(), packet.size(), 0, (const sockaddr*)&address, sizeof(address));
+
+                uint8_t buffer[1536];
+                const ssize_t size = recv(receiver, buffer, sizeof(buffer), 0);
+                CHECK(size == (ssize_t)packet.size());
+                if (size >= 0 && decodeAndUpdate(buffer, (size_t)size) && i % 2 == 0) {
+                    validCount--;
+                }
+            }
+            CHECK(validCount == 0);
+        }
+        close(receiver);
+        close(sender);
+    }
+
+} // namespace
+
+int main() {
+    const std::vector<OscPacket> corpus = makeCorpus();
+    testCorpus(corpus);
+    testMutations(corpus);
+    testLoopbackSender(corpus);
+    return testResult();
+}
+
+#endif
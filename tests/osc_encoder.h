@@ -0,0 +1,103 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+// Encodes OSC packets, to stand in for the senders in the tests and tools.
+
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace pvremu_tests {
+
+    using OscPacket = std::vector<uint8_t>;
+
+    inline void appendOscUint32(OscPacket& packet, uint32_t value) {
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            packet.push_back((uint8_t)(value >> shift));
+        }
+    }
+
+    inline void appendOscUint64(OscPacket& packet, uint64_t value) {
+        appendOscUint32(packet, (uint32_t)(value >> 32));
+        appendOscUint32(packet, (uint32_t)value);
+    }
+
+    // Appended with resize() and memcpy(), since GCC 12 reports a bogus -Wstringop-overflow on vector::insert() once
+    // inlined at -O2.
+    inline void appendOscBytes(OscPacket& packet, const void* data, size_t size, size_t paddedSize) {
+        const size_t offset = packet.size();
+        packet.resize(offset + paddedSize);
+        if (size) {
+            std::memcpy(packet.data() + offset, data, size);
+        }
+    }
+
+    // Null-terminated and padded to 4 bytes.
+    inline void appendOscString(OscPacket& packet, std::string_view string) {
+        appendOscBytes(packet, string.data(), string.size(), (string.size() + 4) & ~size_t(3));
+    }
+
+    // A message with float arguments.
+    inline OscPacket oscMessage(std::string_view address, std::initializer_list<float> values) {
+        OscPacket packet;
+        appendOscString(packet, address);
+        std::string typeTags(",");
+        typeTags.append(values.size(), 'f');
+        appendOscString(packet, typeTags);
+        for (const float value : values) {
+            uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            appendOscUint32(packet, bits);
+        }
+        return packet;
+    }
+
+    // A bundle of messages (or of other bundles).
+    inline OscPacket oscBundle(uint64_t timetag, std::initializer_list<OscPacket> elements) {
+        OscPacket packet;
+        appendOscString(packet, "#bundle");
+        appendOscUint64(packet, timetag);
+        for (const auto& element : elements) {
+            appendOscUint32(packet, (uint32_t)element.size());
+            appendOscBytes(packet, element.data(), element.size(), element.size());
+        }
+        return packet;
+    }
+
+    // NTP format: seconds in the high 32 bits, fraction of a second in the low 32 bits.
+    inline uint64_t nanosecondsToTimetag(int64_t ns) {
+        const uint64_t seconds = (uint64_t)ns / 1'000'000'000ull;
+        const uint64_t remainder = (uint64_t)ns % 1'000'000'000ull;
+        return seconds << 32 | ((remainder << 32) / 1'000'000'000ull);
+    }
+
+    inline int64_t timetagToNanoseconds(uint64_t timetag) {
+        return (int64_t)((timetag >> 32) * 1'000'000'000ull + (((timetag & 0xffffffffull) * 1'000'000'000ull) >> 32));
+    }
+
+} // namespace pvremu_tests
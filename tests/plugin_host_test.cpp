@@ -0,0 +1,143 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Linux host for the eye tracker plugins. It loads a plugin the way PvrEmu does and checks that it follows the contract
+// of pvremu_eye_tracker_plugin.h. Without argument, it checks the sample plugin.
+//
+// Usage:
+//   plugin_host_test [<plugin.so>]
+
+#include "pch.h"
+
+#include <dlfcn.h>
+
+#include <pvremu_eye_tracker_plugin.h>
+
+#include "check.h"
+
+namespace {
+
+    constexpr auto PollDuration = std::chrono::milliseconds(200);
+    constexpr auto PollPeriod = std::chrono::milliseconds(2);
+
+    // The same checks as createPluginEyeTracker() in plugin.cpp.
+    bool isCompatible(const pvremu_eye_tracker_plugin* plugin) {
+        return plugin && plugin->abi_version == PVREMU_EYE_TRACKER_PLUGIN_ABI_VERSION &&
+               plugin->struct_size >= sizeof(pvremu_eye_tracker_plugin) && plugin->name && plugin->create &&
+               plugin->start && plugin->stop && plugin->poll_sample && plugin->destroy;
+    }
+
+    void testPlugin(const char* path) {
+        void* module = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+        CHECK(module);
+        if (!module) {
+            fprintf(stderr, "%s\n", dlerror());
+            return;
+        }
+
+        const auto getPlugin =
+            reinterpret_cast<pvremu_get_eye_tracker_plugin_fn>(dlsym(module, PVREMU_EYE_TRACKER_PLUGIN_ENTRY));
+        CHECK(getPlugin);
+        if (!getPlugin) {
+            dlclose(module);
+            return;
+        }
+
+        // A plugin must refuse a host it does not know.
+        CHECK(!getPlugin(PVREMU_EYE_TRACKER_PLUGIN_ABI_VERSION + 1));
+
+        const pvremu_eye_tracker_plugin* plugin = getPlugin(PVREMU_EYE_TRACKER_PLUGIN_ABI_VERSION);
+        CHECK(isCompatible(plugin));
+        if (!isCompatible(plugin)) {
+            dlclose(module);
+            return;
+        }
+        printf("Plugin: %s\n", plugin->name);
+
+        void* instance = plugin->create();
+        if (!instance) {
+            // Allowed when the device is not present.
+            printf("No device\n");
+            dlclose(module);
+            return;
+        }
+
+        pvremu_gaze_sample sample{};
+        sample.struct_size = sizeof(sample);
+        CHECK(!plugin->poll_sample(instance, &sample));
+
+        CHECK(plugin->start(instance));
+
+        // A host that knows a smaller structure must not get anything written past it.
+        pvremu_gaze_sample smallSample{};
+        smallSample.struct_size = offsetof(pvremu_gaze_sample, timestamp_ns);
+        smallSample.timestamp_ns = -1;
+        plugin->poll_sample(instance, &smallSample);
+        CHECK(smallSample.timestamp_ns == -1);
+
+        size_t validCount = 0;
+        int64_t lastTimestamp = 0;
+        const auto end = std::chrono::steady_clock::now() + PollDuration;
+        while (std::chrono::steady_clock::now() < end) {
+            sample = {};
+            sample.struct_size = sizeof(sample);
+            if (plugin->poll_sample(instance, &sample)) {
+                validCount++;
+
+                const float length = std::sqrt(sample.gaze[0] * sample.gaze[0] + sample.gaze[1] * sample.gaze[1] +
+                                               sample.gaze[2] * sample.gaze[2]);
+                CHECK(std::abs(length - 1.f) < 1e-3f);
+                CHECK(sample.confidence >= 0.f && sample.confidence <= 1.f);
+
+                // Timestamps are optional, but must be on the shared clock and never go back.
+                if (sample.timestamp_ns) {
+                    CHECK(sample.timestamp_ns <= pvremu_now_ns());
+                    CHECK(sample.timestamp_ns >= lastTimestamp);
+                    lastTimestamp = sample.timestamp_ns;
+                }
+            }
+            std::this_thread::sleep_for(PollPeriod);
+        }
+        printf("Valid samples: %zu\n", validCount);
+
+        plugin->stop(instance);
+        sample.struct_size = sizeof(sample);
+        CHECK(!plugin->poll_sample(instance, &sample));
+
+        plugin->destroy(instance);
+        dlclose(module);
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    // pvremu_now_ns() must be the same clock as std::chrono::steady_clock.
+    const int64_t before = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                               std::chrono::steady_clock::now().time_since_epoch())
+                               .count();
+    const int64_t now = pvremu_now_ns();
+    CHECK(now >= before && now - before < 10'000'000);
+
+    testPlugin(argc > 1 ? argv[1] : SAMPLE_PLUGIN_PATH);
+    return pvremu_tests::testResult();
+}
@@ -0,0 +1,97 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+// Portable replacement for the precompiled header of the layer (see CMakeLists.txt).
+
+// Standard library.
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <future>
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Trace logging is a Windows facility, the events are compiled out.
+#define TRACELOGGING_DECLARE_PROVIDER(provider) extern int provider
+template <int& Provider>
+struct TraceLoggingActivity {
+    TraceLoggingActivity() {
+    }
+};
+#define TraceLoggingProviderEnabled(...) false
+#define TraceLoggingValue(...) 0
+#define TraceLoggingPointer(...) 0
+#define TraceLoggingWrite(...) ((void)0)
+#define TraceLoggingWriteStart(...) ((void)0)
+#define TraceLoggingWriteStop(...) ((void)0)
+
+// The OpenXR basic types that the layer uses.
+typedef int64_t XrTime;
+typedef struct XrSession_T* XrSession;
+#define XR_NULL_HANDLE nullptr
+struct XrVector2f {
+    float x;
+    float y;
+};
+struct XrVector3f {
+    float x;
+    float y;
+    float z;
+};
+struct XrQuaternionf {
+    float x;
+    float y;
+    float z;
+    float w;
+};
+struct XrPosef {
+    XrQuaternionf orientation;
+    XrVector3f position;
+};
+
+// FMT formatter.
+#include <fmt/format.h>
+
+// OpenVR
+#include <openvr.h>
@@ -0,0 +1,54 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+// The subset of the tracker interface of the OpenXR-Eye-Trackers project (openxr-api-layer/trackers.h) that the layer
+// code builds against, without any of the tracker implementations.
+
+namespace openxr_api_layer {
+
+    enum class TrackerType {
+        Omnicept,
+        VirtualDesktop,
+        Varjo,
+        SteamLink,
+        PSVR2Toolkit,
+        VRChatOSC,
+    };
+
+    std::string getTrackerType(TrackerType type);
+
+    struct IEyeTracker {
+        virtual ~IEyeTracker() = default;
+
+        virtual void start(XrSession session) = 0;
+        virtual void stop() = 0;
+
+        virtual bool isGazeAvailable(XrTime time) const = 0;
+        virtual bool getGaze(XrTime time, XrVector3f& unitVector) = 0;
+
+        virtual TrackerType getType() const = 0;
+    };
+
+} // namespace openxr_api_layer
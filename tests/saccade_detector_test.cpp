@@ -0,0 +1,97 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "pch.h"
+
+#include <trackers.h>
+
+#include "check.h"
+#include "saccade.h"
+#include "synthetic_gaze.h"
+
+using namespace openxr_api_layer;
+using namespace pvremu_tests;
+
+namespace {
+
+    // Written by "saccade-eval --synthetic", see the tool for its content.
+    constexpr size_t SyntheticSaccadeCount = 50;
+
+    std::chrono::steady_clock::time_point at(double milliseconds) {
+        return std::chrono::steady_clock::time_point(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double, std::milli>(milliseconds)));
+    }
+
+    void testRepeatedSample() {
+        SaccadeDetector detector;
+        detector.update(SyntheticGaze::gazeFromAngles(0.f, 0.f), at(0));
+        detector.update(SyntheticGaze::gazeFromAngles(0.f, 0.f), at(10));
+
+        // 300 deg/s.
+        detector.update(SyntheticGaze::gazeFromAngles(3.f, 0.f), at(20));
+        CHECK(detector.isInSaccade());
+
+        // The same sample, queried again a frame later: the eye did not stop.
+        detector.update(SyntheticGaze::gazeFromAngles(3.f, 0.f), at(25));
+        CHECK(detector.isInSaccade());
+        CHECK(!detector.takeLanding());
+
+        detector.update(SyntheticGaze::gazeFromAngles(6.f, 0.f), at(30));
+        CHECK(detector.isInSaccade());
+
+        // Landing.
+        detector.update(SyntheticGaze::gazeFromAngles(6.1f, 0.f), at(40));
+        CHECK(!detector.isInSaccade());
+        const auto landing = detector.takeLanding();
+        CHECK(landing && std::abs(landing->amplitude - 6.1f) < 0.01f);
+    }
+
+    void testCommittedTrace() {
+        std::string names[2];
+        std::vector<GazeComparisonRecord> records;
+        CHECK(readGazeCapture(SACCADE_TRACE_PATH, names, records));
+        CHECK(!records.empty());
+
+        // A tracker faster than the queries.
+        const SaccadeEvaluation fast = evaluateSaccadeDetector(records, 0);
+        CHECK(fast.saccadeCount >= SyntheticSaccadeCount * 8 / 10 && fast.saccadeCount <= SyntheticSaccadeCount);
+
+        // The prediction must do better than foveating on the latest sample, or it is not worth moving the foveal
+        // region for.
+        CHECK(fast.medianPredictionError < fast.medianStaleGazeError);
+
+        // A tracker slower than the queries, whose samples are repeated. They must neither split the saccades nor be
+        // mistaken for landings.
+        const SaccadeEvaluation slow = evaluateSaccadeDetector(records, 1);
+        CHECK(slow.saccadeCount >= SyntheticSaccadeCount * 7 / 10 && slow.saccadeCount <= SyntheticSaccadeCount);
+        CHECK(slow.medianPredictionError < 2.0);
+        CHECK(slow.medianPredictionError <= slow.medianStaleGazeError);
+    }
+
+} // namespace
+
+int main() {
+    testRepeatedSample();
+    testCommittedTrace();
+    return testResult();
+}
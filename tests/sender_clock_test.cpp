@@ -0,0 +1,123 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "pch.h"
+
+#include <trackers.h>
+
+#include "check.h"
+#include "osc.h"
+#include "osc_encoder.h"
+
+using namespace openxr_api_layer;
+using namespace pvremu_tests;
+using namespace std::chrono_literals;
+
+namespace {
+
+    using Verdict = osc::SenderClock::Verdict;
+
+    constexpr int64_t NtpToUnixEpochNs = 2208988800ll * 1'000'000'000;
+
+    struct Clocks {
+        std::chrono::steady_clock::time_point now{std::chrono::steady_clock::now()};
+        std::chrono::system_clock::time_point wallNow{std::chrono::system_clock::now()};
+
+        // Timetag of a sender sharing our wall clock, for a capture at now + offset.
+        uint64_t timetag(std::chrono::nanoseconds offset) const {
+            return nanosecondsToTimetag(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(wallNow.time_since_epoch() + offset).count() +
+                NtpToUnixEpochNs);
+        }
+    };
+
+    double ageMs(std::chrono::steady_clock::time_point arrival, std::chrono::steady_clock::time_point sampleTime) {
+        return std::chrono::duration<double, std::milli>(arrival - sampleTime).count();
+    }
+
+    void testSplitFrame() {
+        const Clocks clocks;
+        osc::SenderClock clock;
+        std::chrono::steady_clock::time_point sampleTime;
+
+        const uint64_t frame = clocks.timetag(-20ms);
+        CHECK(clock.accept(frame, 1, clocks.now, clocks.wallNow, sampleTime) == Verdict::Accepted);
+        CHECK(std::abs(ageMs(clocks.now, sampleTime) - 20.0) < 0.01);
+
+        // The rest of the frame arrives later in other datagrams, and keeps the capture time of the frame.
+        const auto firstSampleTime = sampleTime;
+        CHECK(clock.accept(frame, 2, clocks.now + 1ms, clocks.wallNow + 1ms, sampleTime) == Verdict::Accepted);
+        CHECK(sampleTime == firstSampleTime);
+        CHECK(clock.accept(frame, 3, clocks.now + 1ms, clocks.wallNow + 1ms, sampleTime) == Verdict::Accepted);
+
+        // A datagram received twice.
+        CHECK(clock.accept(frame, 2, clocks.now + 2ms, clocks.wallNow + 2ms, sampleTime) == Verdict::Duplicate);
+
+        // Only the older frames are out of order.
+        CHECK(clock.accept(clocks.timetag(-30ms), 4, clocks.now, clocks.wallNow, sampleTime) == Verdict::OutOfOrder);
+        CHECK(clock.accept(clocks.timetag(-10ms), 5, clocks.now, clocks.wallNow, sampleTime) == Verdict::Accepted);
+
+        // The next frame may reuse the content of a previous one.
+        CHECK(clock.accept(clocks.timetag(-5ms), 1, clocks.now, clocks.wallNow, sampleTime) == Verdict::Accepted);
+    }
+
+    void testStaleFrame() {
+        const Clocks clocks;
+        osc::SenderClock clock;
+        std::chrono::steady_clock::time_point sampleTime;
+
+        const uint64_t frame = clocks.timetag(-600ms);
+        CHECK(clock.accept(frame, 1, clocks.now, clocks.wallNow, sampleTime) == Verdict::Stale);
+        CHECK(clock.accept(frame, 2, clocks.now, clocks.wallNow, sampleTime) == Verdict::Stale);
+    }
+
+    void testUnsynchronizedSender() {
+        const Clocks clocks;
+        osc::SenderClock clock;
+        std::chrono::steady_clock::time_point sampleTime;
+
+        // The sender clock is an hour ahead, the fastest bundle defines the transit time.
+        const double transitMs[] = {15, 15, 5, 15, 15};
+        for (int i = 0; i < 5; i++) {
+            const auto capture = std::chrono::milliseconds(10 * i);
+            const auto arrival = clocks.now + capture + std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                            std::chrono::duration<double, std::milli>(transitMs[i]));
+            CHECK(clock.accept(clocks.timetag(1h + capture), i, arrival, clocks.wallNow, sampleTime) ==
+                  Verdict::Accepted);
+            const double expected = i < 2 ? 0.0 : transitMs[i] - 5.0;
+            CHECK(std::abs(ageMs(arrival, sampleTime) - expected) < 0.01);
+        }
+
+        // The sender restarted with another clock.
+        CHECK(clock.accept(clocks.timetag(-5h), 0, clocks.now + 1s, clocks.wallNow, sampleTime) == Verdict::Accepted);
+        CHECK(std::abs(ageMs(clocks.now + 1s, sampleTime)) < 0.01);
+    }
+
+} // namespace
+
+int main() {
+    testSplitFrame();
+    testStaleFrame();
+    testUnsynchronizedSender();
+    return testResult();
+}
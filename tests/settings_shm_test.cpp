@@ -0,0 +1,164 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// The settings block of pvremu_settings_shm.h, on POSIX shared memory.
+
+#include "pch.h"
+
+#include <trackers.h>
+
+#include <pvremu_settings_shm.h>
+
+#include "check.h"
+
+using namespace pvremu_tests;
+
+namespace {
+
+    constexpr uint32_t PublishCount = 2'000'000;
+
+    // The writer waits for the reader to see every one of these publications, so that both threads overlap even when
+    // the writer would otherwise finish before the reader is scheduled.
+    constexpr uint32_t AckInterval = 10'000;
+
+    // A private block, so that a running layer or a concurrent test does not interfere.
+    std::string makeName() {
+        return fmt::format("/pvremu_settings_test_{}", getpid());
+    }
+
+    bool operator==(const pvremu::SettingsValues& a, const pvremu::SettingsValues& b) {
+        return a.mode == b.mode && a.ignoreEyeTracking == b.ignoreEyeTracking && a.invertYAxis == b.invertYAxis;
+    }
+
+    void testPublishAndPoll(const char* name) {
+        // Without a publisher, the layer falls back to the registry.
+        pvremu::SettingsReader reader;
+        CHECK(!reader.open(name));
+        CHECK(!reader.isOpen());
+
+        pvremu::SettingsPublisher publisher;
+        CHECK(publisher.open(name));
+        CHECK(reader.open(name));
+
+        // Nothing published yet.
+        pvremu::SettingsValues values{};
+        CHECK(!reader.poll(values));
+
+        publisher.publish({2, 0, 1});
+        CHECK(reader.poll(values));
+        CHECK((values == pvremu::SettingsValues{2, 0, 1}));
+        CHECK(!reader.poll(values));
+
+        // A reader opened later gets the current values on its first poll.
+        pvremu::SettingsReader lateReader;
+        CHECK(lateReader.open(name));
+        CHECK(lateReader.poll(values));
+        CHECK((values == pvremu::SettingsValues{2, 0, 1}));
+
+        // A restarted publisher continues the generation, so that the readers see its first change.
+        publisher.close();
+        pvremu::SettingsPublisher restartedPublisher;
+        CHECK(restartedPublisher.open(name));
+        CHECK(!reader.poll(values));
+        restartedPublisher.publish({3, 1, 0});
+        CHECK(reader.poll(values));
+        CHECK((values == pvremu::SettingsValues{3, 1, 0}));
+    }
+
+    void testIncompleteHeader(const char* name) {
+        // A block of the right size that nobody initialized (or from another version).
+        const int fd = shm_open(name, O_CREAT | O_RDWR, 0600);
+        CHECK(fd >= 0);
+        if (fd < 0) {
+            return;
+        }
+        CHECK(ftruncate(fd, sizeof(pvremu::SettingsSharedMemory)) == 0);
+        close(fd);
+
+        pvremu::SettingsReader reader;
+        CHECK(!reader.open(name));
+
+        pvremu::SettingsPublisher publisher;
+        CHECK(publisher.open(name));
+        CHECK(reader.open(name));
+    }
+
+    void testConcurrentPublisher(const char* name) {
+        pvremu::SettingsPublisher publisher;
+        pvremu::SettingsReader reader;
+        CHECK(publisher.open(name));
+        CHECK(reader.open(name));
+
+        // Every publication has the same value in all the fields, a torn read would mix two of them.
+        std::atomic<bool> isDone{false};
+        std::atomic<uint32_t> lastSeen{0};
+        std::thread writer([&] {
+            for (uint32_t i = 1; i <= PublishCount; i++) {
+                publisher.publish({i, i, i});
+                if (i % AckInterval == 0) {
+                    while (lastSeen < i) {
+                        std::this_thread::yield();
+                    }
+                }
+            }
+            isDone = true;
+        });
+
+        uint64_t changeCount = 0;
+        uint64_t tornCount = 0;
+        uint32_t lastMode = 0;
+        bool isMonotonic = true;
+        pvremu::SettingsValues values{};
+        while (!isDone) {
+            if (reader.poll(values)) {
+                changeCount++;
+                tornCount += values.mode != values.ignoreEyeTracking || values.mode != values.invertYAxis;
+                isMonotonic = isMonotonic && values.mode > lastMode;
+                lastMode = values.mode;
+                lastSeen = values.mode;
+            }
+        }
+        writer.join();
+
+        CHECK(tornCount == 0);
+        CHECK(isMonotonic);
+
+        // The last change is always observed.
+        reader.poll(values);
+        CHECK(values.mode == PublishCount);
+        CHECK(changeCount >= PublishCount / AckInterval);
+    }
+
+} // namespace
+
+int main() {
+    const std::string name = makeName();
+    shm_unlink(name.c_str());
+    testPublishAndPoll(name.c_str());
+    shm_unlink(name.c_str());
+    testIncompleteHeader(name.c_str());
+    shm_unlink(name.c_str());
+    testConcurrentPublisher(name.c_str());
+    shm_unlink(name.c_str());
+    return testResult();
+}
@@ -0,0 +1,159 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include <random>
+
+#include "comparison.h"
+
+namespace pvremu_tests {
+
+    // Synthetic eye movements: fixations joined by saccades, with the duration and the smooth velocity profile of real
+    // saccades. They stand in for recordings in the tests, they do not replace them to tune the detectors.
+    class SyntheticGaze {
+      public:
+        SyntheticGaze(uint32_t seed, size_t saccadeCount) {
+            std::mt19937 rng(seed);
+            std::uniform_real_distribution<float> unit(0.f, 1.f);
+
+            double time = 0;
+            float yaw = 0.f, pitch = 0.f;
+            for (size_t i = 0; i < saccadeCount; i++) {
+                time += 0.2 + 0.2 * unit(rng);
+
+                // Amplitudes from 5 to 20 degrees in any direction, staying within the field of view.
+                const float amplitude = 5.f + 15.f * unit(rng);
+                const float direction = (2.f * unit(rng) - 1.f) * (float)M_PI;
+                Saccade saccade;
+                saccade.start = time;
+                saccade.fromYaw = yaw;
+                saccade.fromPitch = pitch;
+                saccade.toYaw = std::clamp(yaw + amplitude * std::cos(direction), -25.f, 25.f);
+                saccade.toPitch = std::clamp(pitch + amplitude * std::sin(direction) * 0.5f, -15.f, 15.f);
+                const float actualAmplitude = std::hypot(saccade.toYaw - yaw, saccade.toPitch - pitch);
+                saccade.duration = 0.021 + 0.0022 * actualAmplitude;
+                m_saccades.push_back(saccade);
+
+                time += saccade.duration;
+                yaw = saccade.toYaw;
+                pitch = saccade.toPitch;
+            }
+            m_duration = time + 0.3;
+        }
+
+        double duration() const {
+            return m_duration;
+        }
+
+        // The noise-free gaze at the given time.
+        XrVector3f at(double time) const {
+            float yaw = 0.f, pitch = 0.f;
+            for (const auto& saccade : m_saccades) {
+                if (time < saccade.start) {
+                    break;
+                }
+                const double x = std::min((time - saccade.start) / saccade.duration, 1.0);
+                const float progress = (float)(x * x * (3 - 2 * x));
+                yaw = saccade.fromYaw + (saccade.toYaw - saccade.fromYaw) * progress;
+                pitch = saccade.fromPitch + (saccade.toPitch - saccade.fromPitch) * progress;
+            }
+            return gazeFromAngles(yaw, pitch);
+        }
+
+        // Fill one of the traces of a capture with samples at a fixed rate, delayed and with gaussian noise. The
+        // records are created when the vector is empty.
+        void sample(std::vector<openxr_api_layer::GazeComparisonRecord>& records,
+                    size_t trace,
+                    double rate,
+                    double delay,
+                    float noiseDegrees,
+                    uint32_t seed) const {
+            if (records.empty()) {
+                for (double time = 0; time < m_duration; time += 1.0 / rate) {
+                    records.push_back({time});
+                }
+            }
+
+            std::mt19937 rng(seed);
+            std::normal_distribution<float> noise(0.f, noiseDegrees);
+            for (auto& record : records) {
+                const XrVector3f gaze = at(record.time - delay);
+                const float yaw = std::atan2(gaze.x, -gaze.z) * 180.f / (float)M_PI;
+                const float pitch = std::asin(gaze.y) * 180.f / (float)M_PI;
+                record.isValid[trace] = true;
+                record.gaze[trace] = gazeFromAngles(yaw + noise(rng), pitch + noise(rng));
+            }
+        }
+
+        // Same as sample(), but for a tracker running at its own rate: each record gets the newest sample of the
+        // tracker, repeated as is until the next one, like when a slower tracker is queried every frame.
+        void sampleTracker(std::vector<openxr_api_layer::GazeComparisonRecord>& records,
+                           size_t trace,
+                           double queryRate,
+                           double trackerRate,
+                           float noiseDegrees,
+                           uint32_t seed) const {
+            if (records.empty()) {
+                for (double time = 0; time < m_duration; time += 1.0 / queryRate) {
+                    records.push_back({time});
+                }
+            }
+
+            std::mt19937 rng(seed);
+            std::normal_distribution<float> noise(0.f, noiseDegrees);
+            std::optional<int64_t> lastIndex;
+            XrVector3f sample{};
+            for (auto& record : records) {
+                const int64_t index = (int64_t)std::floor(record.time * trackerRate);
+                if (index != lastIndex) {
+                    const XrVector3f gaze = at(index / trackerRate);
+                    const float yaw = std::atan2(gaze.x, -gaze.z) * 180.f / (float)M_PI;
+                    const float pitch = std::asin(gaze.y) * 180.f / (float)M_PI;
+                    sample = gazeFromAngles(yaw + noise(rng), pitch + noise(rng));
+                    lastIndex = index;
+                }
+                record.isValid[trace] = true;
+                record.gaze[trace] = sample;
+            }
+        }
+
+        static XrVector3f gazeFromAngles(float yawDegrees, float pitchDegrees) {
+            const float yaw = yawDegrees * (float)M_PI / 180.f;
+            const float pitch = pitchDegrees * (float)M_PI / 180.f;
+            return {std::sin(yaw) * std::cos(pitch), std::sin(pitch), -std::cos(yaw) * std::cos(pitch)};
+        }
+
+      private:
+        struct Saccade {
+            double start;
+            double duration;
+            float fromYaw, fromPitch;
+            float toYaw, toPitch;
+        };
+
+        std::vector<Saccade> m_saccades;
+        double m_duration{0};
+    };
+
+} // namespace pvremu_tests
@@ -0,0 +1,133 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Offline analysis of the captures written by the eye tracker comparison mode (eye_tracker_compare).
+//
+// Usage:
+//   gaze-compare <capture.csv>
+//       Compare the two traces of a capture, including the latency estimate from the cross-correlation.
+//   gaze-compare <capture.csv>[|A|B] <capture.csv>[|A|B]
+//       Compare one trace from each of two captures, played back from their start like the replay tracker does.
+
+#include "pch.h"
+
+#include <trackers.h>
+
+#include "comparison.h"
+
+using namespace openxr_api_layer;
+
+namespace {
+
+    struct TraceSpecification {
+        std::filesystem::path path;
+        size_t trace{0};
+    };
+
+    TraceSpecification parseSpecification(const std::string& argument) {
+        TraceSpecification specification{argument};
+        const size_t separator = argument.rfind('|');
+        if (separator != std::string::npos) {
+            specification.path = argument.substr(0, separator);
+            specification.trace = argument.substr(separator + 1) == "B" ? 1 : 0;
+        }
+        return specification;
+    }
+
+    // Merge two traces on the union of their timestamps, holding the latest sample of each trace in between.
+    std::vector<GazeComparisonRecord> mergeTraces(const std::vector<GazeComparisonRecord> (&captures)[2],
+                                                  const size_t (&traces)[2]) {
+        std::vector<GazeComparisonRecord> merged;
+        size_t next[2]{};
+        const double start[2] = {captures[0].front().time, captures[1].front().time};
+        while (next[0] < captures[0].size() || next[1] < captures[1].size()) {
+            // Take the earliest of the next samples.
+            const auto timeOf = [&](size_t i) {
+                return next[i] < captures[i].size() ? captures[i][next[i]].time - start[i]
+                                                    : std::numeric_limits<double>::infinity();
+            };
+            const double time = std::min(timeOf(0), timeOf(1));
+            for (size_t i = 0; i < 2; i++) {
+                while (next[i] < captures[i].size() && timeOf(i) <= time) {
+                    next[i]++;
+                }
+            }
+
+            GazeComparisonRecord record;
+            record.time = time;
+            for (size_t i = 0; i < 2; i++) {
+                if (next[i] > 0) {
+                    const auto& sample = captures[i][next[i] - 1];
+                    record.isValid[i] = sample.isValid[traces[i]];
+                    record.gaze[i] = sample.gaze[traces[i]];
+                }
+            }
+            merged.push_back(record);
+        }
+        return merged;
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc != 2 && argc != 3) {
+        fprintf(stderr, "Usage: %s <capture.csv> | <capture.csv>[|A|B] <capture.csv>[|A|B]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    GazeComparisonReport report;
+    std::vector<GazeComparisonRecord> records;
+    if (argc == 2) {
+        std::string names[2];
+        if (!readGazeCapture(argv[1], names, records)) {
+            fprintf(stderr, "Cannot read %s\n", argv[1]);
+            return EXIT_FAILURE;
+        }
+        report = analyzeGazeComparison(records);
+        report.names[0] = names[0];
+        report.names[1] = names[1];
+    } else {
+        std::vector<GazeComparisonRecord> captures[2];
+        size_t traces[2]{};
+        std::string names[2];
+        for (size_t i = 0; i < 2; i++) {
+            const TraceSpecification specification = parseSpecification(argv[i + 1]);
+            std::string captureNames[2];
+            if (!readGazeCapture(specification.path, captureNames, captures[i])) {
+                fprintf(stderr, "Cannot read %s\n", specification.path.string().c_str());
+                return EXIT_FAILURE;
+            }
+            traces[i] = specification.trace;
+            names[i] = fmt::format("{} ({})", captureNames[specification.trace], specification.path.filename().string());
+        }
+        records = mergeTraces(captures, traces);
+        report = analyzeGazeComparison(records);
+        report.names[0] = names[0];
+        report.names[1] = names[1];
+    }
+
+    estimateGazeLatency(records, report);
+    printf("%s", formatGazeComparisonReport(report).c_str());
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,296 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Compares the two generic gaze ingest paths on Linux: the shared memory ring of pvremu_gaze_shm.h, and VRChat OSC over
+// loopback UDP, decoded the way the OSC tracker does.
+//
+// Usage:
+//   gaze-ingest-benchmark [rate-hz] [seconds]
+//
+// For each path, a producer thread publishes gaze at the given rate and a consumer thread picks it up. The latency is
+// from the producer timestamp to the moment the consumer holds the decoded sample. The shared memory consumer polls,
+// so its latency includes up to one poll period; the layer itself reads the ring on demand at frame time and does not
+// run any thread for it. The cost of reading (or decoding) one sample is then measured separately, without the
+// scheduling.
+
+#include "pch.h"
+
+#include <trackers.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <pvremu_gaze_shm.h>
+
+#include "osc.h"
+#include "osc_encoder.h"
+
+using namespace openxr_api_layer;
+using namespace pvremu_tests;
+
+namespace {
+
+    constexpr double DefaultRate = 120.0;
+    constexpr double DefaultSeconds = 5.0;
+
+    constexpr auto ShmPollPeriod = std::chrono::microseconds(250);
+    constexpr auto ReceiveTimeout = std::chrono::milliseconds(100);
+
+    constexpr int ReadCostIterations = 1'000'000;
+
+    struct PathResult {
+        std::string name;
+        uint64_t sent{0};
+        std::vector<int64_t> latenciesNs;
+        int64_t consumerCpuNs{0};
+        double seconds{0};
+        double readCostNs{0};
+    };
+
+    int64_t threadCpuNs() {
+        timespec now;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+        return (int64_t)now.tv_sec * 1'000'000'000 + now.tv_nsec;
+    }
+
+    // A slow sweep of both eyes, so that every sample differs from the previous one.
+    pvremu::GazeSample makeSample(uint64_t index) {
+        pvremu::GazeSample sample{};
+        const float yaw = 0.3f * std::sin(index * 0.05f);
+        for (int eye = 0; eye < 2; eye++) {
+            sample.gaze[eye][0] = std::sin(yaw);
+            sample.gaze[eye][1] = 0.f;
+            sample.gaze[eye][2] = -std::cos(yaw);
+            sample.openness[eye] = 1.f;
+            sample.confidence[eye] = 1.f;
+        }
+        sample.flags = pvremu::GazeSampleFlags_LeftValid | pvremu::GazeSampleFlags_RightValid;
+        return sample;
+    }
+
+    // Call produce(index) at the given rate until the duration elapses. Returns the number of calls.
+    template <typename Producer>
+    uint64_t runProducer(double rate, double seconds, Producer&& produce) {
+        const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(1.0 / rate));
+        const auto start = std::chrono::steady_clock::now();
+        const auto end = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                     std::chrono::duration<double>(seconds));
+        uint64_t index = 0;
+        for (auto next = start; next < end; next += period) {
+            std::this_thread::sleep_until(next);
+            produce(index++);
+        }
+        return index;
+    }
+
+    // Average CPU time of one call.
+    template <typename Work>
+    double measureCost(Work&& work) {
+        const int64_t start = threadCpuNs();
+        for (int i = 0; i < ReadCostIterations; i++) {
+            work();
+        }
+        return (double)(threadCpuNs() - start) / ReadCostIterations;
+    }
+
+    std::optional<PathResult> benchmarkSharedMemory(double rate, double seconds) {
+        PathResult result{"Shared memory"};
+
+        // A private name, so that a running layer does not pick up the benchmark.
+        const std::string name = fmt::format("/pvremu_gaze_benchmark_{}", getpid());
+        pvremu::GazeProducer producer;
+        if (!producer.open(name.c_str())) {
+            fprintf(stderr, "Cannot create the shared memory %s\n", name.c_str());
+            return {};
+        }
+        const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        shm_unlink(name.c_str());
+        if (fd < 0) {
+            return {};
+        }
+        void* view = mmap(nullptr, sizeof(pvremu::GazeSharedMemory), PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (view == MAP_FAILED) {
+            return {};
+        }
+        const auto& shm = *static_cast<const pvremu::GazeSharedMemory*>(view);
+
+        std::atomic<bool> stop{false};
+        std::thread consumer([&] {
+            const int64_t cpuStart = threadCpuNs();
+            uint64_t lastIndex = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                pvremu::GazeSample sample;
+                uint64_t index;
+                if (readNewestGazeSample(shm, sample, &index) && index != lastIndex) {
+                    result.latenciesNs.push_back(pvremu_now_ns() - sample.timestampNs);
+                    lastIndex = index;
+                }
+                std::this_thread::sleep_for(ShmPollPeriod);
+            }
+            result.consumerCpuNs = threadCpuNs() - cpuStart;
+        });
+
+        result.sent = runProducer(rate, seconds, [&](uint64_t index) {
+            pvremu::GazeSample sample = makeSample(index);
+            sample.timestampNs = pvremu_now_ns();
+            producer.publish(sample);
+        });
+        std::this_thread::sleep_for(ShmPollPeriod * 4);
+        stop = true;
+        consumer.join();
+        result.seconds = seconds;
+
+        result.readCostNs = measureCost([&] {
+            pvremu::GazeSample sample;
+            readNewestGazeSample(shm, sample);
+        });
+
+        munmap(view, sizeof(pvremu::GazeSharedMemory));
+        return result;
+    }
+
+    std::optional<PathResult> benchmarkOsc(double rate, double seconds) {
+        PathResult result{"OSC over UDP"};
+
+        const int receiver = socket(AF_INET, SOCK_DGRAM, 0);
+        const int sender = socket(AF_INET, SOCK_DGRAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t addressSize = sizeof(address);
+        const timeval timeout{0, (suseconds_t)std::chrono::microseconds(ReceiveTimeout).count()};
+        if (receiver < 0 || sender < 0 || bind(receiver, (const sockaddr*)&address, sizeof(address)) ||
+            getsockname(receiver, (sockaddr*)&address, &addressSize) ||
+            setsockopt(receiver, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout))) {
+            fprintf(stderr, "Cannot open the loopback sockets\n");
+            close(receiver);
+            close(sender);
+            return {};
+        }
+
+        std::atomic<bool> stop{false};
+        std::thread consumer([&] {
+            const int64_t cpuStart = threadCpuNs();
+            osc::GazeState state;
+            uint8_t buffer[1536];
+            while (!stop.load(std::memory_order_relaxed)) {
+                const ssize_t size = recv(receiver, buffer, sizeof(buffer), 0);
+                if (size <= 0) {
+                    continue;
+                }
+                const auto now = std::chrono::steady_clock::now();
+                uint64_t timetag = osc::ImmediateTimetag;
+                osc::decodePacket(buffer, (size_t)size, [&](const osc::Message& message) {
+                    state.update(message, now);
+                    timetag = message.timetag;
+                });
+                EyeGazeSample sample;
+                if (state.getGazeSample(sample)) {
+                    result.latenciesNs.push_back(pvremu_now_ns() - timetagToNanoseconds(timetag));
+                }
+            }
+            result.consumerCpuNs = threadCpuNs() - cpuStart;
+        });
+
+        // The timetag carries the producer timestamp instead of the wall clock, so that both paths are measured with
+        // the same clock.
+        const auto makePacket = [](uint64_t index) {
+            const pvremu::GazeSample sample = makeSample(index);
+            const float yaw = std::atan2(sample.gaze[0][0], -sample.gaze[0][2]) * 180.f / (float)M_PI;
+            return oscBundle(nanosecondsToTimetag(pvremu_now_ns()),
+                             {oscMessage("/tracking/eye/LeftRightPitchYaw", {0.f, yaw, 0.f, yaw}),
+                              oscMessage("/tracking/eye/EyesClosedAmount", {0.f})});
+        };
+        result.sent = runProducer(rate, seconds, [&](uint64_t index) {
+            const OscPacket packet = makePacket(index);
+            sendto(sender, packet.data(), packet.size(), 0, (const sockaddr*)&address, sizeof(address));
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        stop = true;
+        consumer.join();
+        result.seconds = seconds;
+
+        // Without the socket.
+        const OscPacket packet = makePacket(1);
+        result.readCostNs = measureCost([&] {
+            osc::GazeState state;
+            const auto now = std::chrono::steady_clock::now();
+            osc::decodePacket(
+                packet.data(), packet.size(), [&](const osc::Message& message) { state.update(message, now); });
+            EyeGazeSample sample;
+            state.getGazeSample(sample);
+        });
+
+        close(receiver);
+        close(sender);
+        return result;
+    }
+
+    void printResult(PathResult& result) {
+        auto& latencies = result.latenciesNs;
+        std::sort(latencies.begin(), latencies.end());
+        const auto percentile = [&](double p) {
+            return latencies[std::min(latencies.size() - 1, (size_t)(p * latencies.size()))] / 1000.0;
+        };
+        printf("%s:\n", result.name.c_str());
+        printf("  Samples:  %zu received of %llu sent\n", latencies.size(), (unsigned long long)result.sent);
+        if (!latencies.empty()) {
+            printf("  Latency:  p50 %.1fus  p99 %.1fus  max %.1fus\n",
+                   percentile(0.5),
+                   percentile(0.99),
+                   latencies.back() / 1000.0);
+            printf("  Consumer: %.2f%% of a CPU, %.1fus per sample (including the polling or the wake-ups)\n",
+                   100.0 * result.consumerCpuNs / (result.seconds * 1e9),
+                   result.consumerCpuNs / 1000.0 / latencies.size());
+        }
+        printf("  Read:     %.0fns per sample\n", result.readCostNs);
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const double rate = argc > 1 ? atof(argv[1]) : DefaultRate;
+    const double seconds = argc > 2 ? atof(argv[2]) : DefaultSeconds;
+    if (argc > 3 || rate <= 0.0 || seconds <= 0.0) {
+        fprintf(stderr, "Usage: %s [rate-hz] [seconds]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    printf("%.0f Hz for %.1fs\n", rate, seconds);
+    bool succeeded = true;
+    for (const auto benchmark : {benchmarkSharedMemory, benchmarkOsc}) {
+        std::optional<PathResult> result = benchmark(rate, seconds);
+        if (!result || result->latenciesNs.empty()) {
+            succeeded = false;
+            continue;
+        }
+        printResult(result.value());
+    }
+
+    return succeeded ? EXIT_SUCCESS : EXIT_FAILURE;
+}
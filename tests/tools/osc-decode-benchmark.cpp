@@ -0,0 +1,189 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Packet throughput of the OSC decoder, for the packet shapes that the eye tracking senders use.
+//
+// Usage:
+//   osc-decode-benchmark [seconds-per-case]
+//
+// Each packet is first decoded in a loop from memory, then pushed as fast as possible through a loopback UDP socket by
+// a local sender thread and decoded by the receiving thread, like the OSC tracker does.
+
+#include "pch.h"
+
+#include <trackers.h>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "osc.h"
+#include "osc_encoder.h"
+
+using namespace openxr_api_layer;
+using namespace pvremu_tests;
+
+namespace {
+
+    constexpr double DefaultSeconds = 1.0;
+
+    // Keep the sender from overflowing the receive buffer, we measure the decoder and not the packet loss.
+    constexpr int MaxPacketsInFlight = 64;
+
+    struct Case {
+        const char* name;
+        OscPacket packet;
+    };
+
+    std::vector<Case> makeCases() {
+        std::vector<Case> cases;
+        cases.push_back({"Native, one message",
+                         oscMessage("/tracking/eye/LeftRightPitchYaw", {1.f, 2.f, 3.f, 4.f})});
+        cases.push_back({"Native bundle",
+                         oscBundle(osc::ImmediateTimetag,
+                                   {oscMessage("/tracking/eye/LeftRightPitchYaw", {1.f, 2.f, 3.f, 4.f}),
+                                    oscMessage("/tracking/eye/EyesClosedAmount", {0.f})})});
+        cases.push_back({"VRCFT v2 bundle",
+                         oscBundle(osc::ImmediateTimetag,
+                                   {oscMessage("/avatar/parameters/FT/v2/EyeLeftX", {0.1f}),
+                                    oscMessage("/avatar/parameters/FT/v2/EyeLeftY", {0.2f}),
+                                    oscMessage("/avatar/parameters/FT/v2/EyeRightX", {0.3f}),
+                                    oscMessage("/avatar/parameters/FT/v2/EyeRightY", {0.4f}),
+                                    oscMessage("/avatar/parameters/FT/v2/EyeLidLeft", {1.f}),
+                                    oscMessage("/avatar/parameters/FT/v2/EyeLidRight", {1.f}),
+                                    oscMessage("/avatar/parameters/FT/v2/JawOpen", {0.5f}),
+                                    oscMessage("/avatar/parameters/FT/v2/MouthClosed", {0.5f})})});
+        cases.push_back({"Unrelated message", oscMessage("/avatar/parameters/VelocityX", {0.f})});
+        return cases;
+    }
+
+    struct Throughput {
+        double packetsPerSecond{0};
+        double messagesPerSecond{0};
+    };
+
+    size_t decode(const uint8_t* data, size_t size, osc::GazeState& state) {
+        const auto now = std::chrono::steady_clock::now();
+        size_t messageCount = 0;
+        osc::decodePacket(data, size, [&](const osc::Message& message) {
+            state.update(message, now);
+            messageCount++;
+        });
+        return messageCount;
+    }
+
+    Throughput measureMemory(const OscPacket& packet, double seconds) {
+        osc::GazeState state;
+        size_t packetCount = 0;
+        size_t messageCount = 0;
+        const auto start = std::chrono::steady_clock::now();
+        const auto end = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                     std::chrono::duration<double>(seconds));
+        auto now = start;
+        while (now < end) {
+            // Amortize the clock.
+            for (int i = 0; i < 1024; i++) {
+                messageCount += decode(packet.data(), packet.size(), state);
+            }
+            packetCount += 1024;
+            now = std::chrono::steady_clock::now();
+        }
+        const double elapsed = std::chrono::duration<double>(now - start).count();
+        return {packetCount / elapsed, messageCount / elapsed};
+    }
+
+    std::optional<Throughput> measureLoopback(const OscPacket& packet, double seconds) {
+        const int receiver = socket(AF_INET, SOCK_DGRAM, 0);
+        const int sender = socket(AF_INET, SOCK_DGRAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t addressSize = sizeof(address);
+        const timeval timeout{0, 100'000};
+        if (receiver < 0 || sender < 0 || bind(receiver, (const sockaddr*)&address, sizeof(address)) ||
+            getsockname(receiver, (sockaddr*)&address, &addressSize) ||
+            setsockopt(receiver, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout))) {
+            close(receiver);
+            close(sender);
+            return {};
+        }
+
+        std::atomic<bool> stop{false};
+        std::atomic<int64_t> received{0};
+        size_t messageCount = 0;
+        std::thread consumer([&] {
+            osc::GazeState state;
+            uint8_t buffer[1536];
+            while (!stop.load(std::memory_order_relaxed)) {
+                const ssize_t size = recv(receiver, buffer, sizeof(buffer), 0);
+                if (size > 0) {
+                    messageCount += decode(buffer, (size_t)size, state);
+                    received.fetch_add(1, std::memory_order_release);
+                }
+            }
+        });
+
+        const auto start = std::chrono::steady_clock::now();
+        const auto end = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                     std::chrono::duration<double>(seconds));
+        int64_t sent = 0;
+        while (std::chrono::steady_clock::now() < end) {
+            if (sent - received.load(std::memory_order_acquire) >= MaxPacketsInFlight) {
+                std::this_thread::yield();
+                continue;
+            }
+            sendto(sender, packet.data(), packet.size(), 0, (const sockaddr*)&address, sizeof(address));
+            sent++;
+        }
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        stop = true;
+        consumer.join();
+        close(receiver);
+        close(sender);
+
+        return Throughput{received / elapsed, messageCount / elapsed};
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const double seconds = argc > 1 ? atof(argv[1]) : DefaultSeconds;
+    if (argc > 2 || seconds <= 0.0) {
+        fprintf(stderr, "Usage: %s [seconds-per-case]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    printf("%-20s %6s %20s %20s %22s\n", "", "Bytes", "Memory (packets/s)", "Memory (messages/s)", "Loopback (packets/s)");
+    for (const auto& [name, packet] : makeCases()) {
+        const Throughput memory = measureMemory(packet, seconds);
+        const std::optional<Throughput> loopback = measureLoopback(packet, seconds);
+        printf("%-20s %6zu %20.0f %20.0f %22s\n",
+               name,
+               packet.size(),
+               memory.packetsPerSecond,
+               memory.messagesPerSecond,
+               loopback ? fmt::format("{:.0f}", loopback->packetsPerSecond).c_str() : "n/a");
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,298 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// How the CPU time of the OSC listener thread scales with the packet rate, with a local packet generator.
+//
+// Usage:
+//   osc-listener-benchmark [seconds-per-rate]
+//       Run the generator and a listener on loopback at increasing packet rates, once receiving one datagram per wakeup
+//       and once draining the socket in batches with recvmmsg(), like the OSC tracker does.
+//   osc-listener-benchmark send <ipv4-address> <port> <packets-per-second> [seconds]
+//       Only run the generator, for example towards a PC running the layer, whose listener logs its CPU usage.
+//
+// The generator sends one message per datagram, cycling through the eye parameters of VRCFaceTracking v2 and a few
+// unrelated face parameters, in bursts every millisecond.
+
+#include "pch.h"
+
+#include <trackers.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "osc.h"
+#include "osc_encoder.h"
+
+using namespace openxr_api_layer;
+using namespace pvremu_tests;
+
+namespace {
+
+    constexpr double DefaultSeconds = 2.0;
+    constexpr double Rates[] = {250, 500, 1000, 2000, 4000, 8000, 16000};
+
+    constexpr auto GeneratorTick = std::chrono::milliseconds(1);
+
+    // Same as the OSC tracker.
+    constexpr int ReceiveTimeoutMs = 100;
+    constexpr int MaxBatchSize = 256;
+    constexpr int ReceiveBufferSize = 1024 * 1024;
+
+    // Datagrams taken by one recvmmsg() call. Eye tracking packets are small.
+    constexpr int VectorCount = 32;
+    constexpr size_t DatagramSize = 2048;
+
+    constexpr const char* Parameters[] = {
+        "/avatar/parameters/FT/v2/EyeLeftX",
+        "/avatar/parameters/FT/v2/EyeLeftY",
+        "/avatar/parameters/FT/v2/EyeRightX",
+        "/avatar/parameters/FT/v2/EyeRightY",
+        "/avatar/parameters/FT/v2/EyeLidLeft",
+        "/avatar/parameters/FT/v2/EyeLidRight",
+        "/avatar/parameters/FT/v2/JawOpen",
+        "/avatar/parameters/FT/v2/MouthClosed",
+        "/avatar/parameters/FT/v2/CheekPuffLeft",
+        "/avatar/parameters/FT/v2/CheekPuffRight",
+        "/avatar/parameters/FT/v2/BrowInnerUpLeft",
+        "/avatar/parameters/FT/v2/BrowInnerUpRight",
+        "/avatar/parameters/FT/v2/LipFunnel",
+        "/avatar/parameters/FT/v2/LipPucker",
+        "/avatar/parameters/FT/v2/TongueOut",
+        "/avatar/parameters/FT/v2/SmileLeft",
+    };
+
+    enum class Mode { PerDatagram, Batched };
+
+    struct Measurement {
+        uint64_t sent{0};
+        uint64_t received{0};
+        uint64_t wakeups{0};
+        int64_t cpuNs{0};
+        double seconds{0};
+    };
+
+    int64_t threadCpuNs() {
+        timespec now;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+        return (int64_t)now.tv_sec * 1'000'000'000 + now.tv_nsec;
+    }
+
+    // Send at the given rate until the duration elapses or stop is set. Returns the number of datagrams sent.
+    uint64_t generate(int socket, const sockaddr_in& address, double rate, double seconds, std::atomic<bool>& stop) {
+        std::vector<OscPacket> packets;
+        for (size_t i = 0; i < std::size(Parameters); i++) {
+            packets.push_back(oscMessage(Parameters[i], {0.01f * i}));
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        const auto duration = std::chrono::duration<double>(seconds);
+        uint64_t sent = 0;
+        for (auto next = start; !stop; next += GeneratorTick) {
+            std::this_thread::sleep_until(next);
+            const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (elapsed >= duration.count()) {
+                break;
+            }
+            for (const uint64_t due = (uint64_t)(elapsed * rate); sent < due; sent++) {
+                const auto& packet = packets[sent % packets.size()];
+                sendto(socket, packet.data(), packet.size(), 0, (const sockaddr*)&address, sizeof(address));
+            }
+        }
+        return sent;
+    }
+
+    // The listener loop of the OSC tracker, reduced to what costs CPU.
+    class Listener {
+      public:
+        Listener(int socket, Mode mode) : m_socket(socket), m_mode(mode) {
+        }
+
+        void run(std::atomic<bool>& stop, Measurement& measurement) {
+            const int64_t cpuStart = threadCpuNs();
+            while (!stop) {
+                const int count = m_mode == Mode::Batched ? receiveBatch() : receiveOne();
+                if (count > 0) {
+                    std::unique_lock lock(m_stateMutex);
+                    m_publishedState = m_listenerState;
+                    measurement.received += count;
+                    measurement.wakeups++;
+                }
+            }
+            measurement.cpuNs = threadCpuNs() - cpuStart;
+        }
+
+      private:
+        int receiveOne() {
+            uint8_t buffer[DatagramSize];
+            const ssize_t size = recv(m_socket, buffer, sizeof(buffer), 0);
+            if (size <= 0) {
+                return 0;
+            }
+            decode(buffer, (size_t)size);
+            return 1;
+        }
+
+        int receiveBatch() {
+            pollfd descriptor{m_socket, POLLIN, 0};
+            if (poll(&descriptor, 1, ReceiveTimeoutMs) <= 0) {
+                return 0;
+            }
+
+            int count = 0;
+            while (count < MaxBatchSize) {
+                mmsghdr messages[VectorCount]{};
+                iovec vectors[VectorCount];
+                for (int i = 0; i < VectorCount; i++) {
+                    vectors[i] = {m_buffers[i], DatagramSize};
+                    messages[i].msg_hdr.msg_iov = &vectors[i];
+                    messages[i].msg_hdr.msg_iovlen = 1;
+                }
+                const int received =
+                    recvmmsg(m_socket, messages, std::min(VectorCount, MaxBatchSize - count), MSG_DONTWAIT, nullptr);
+                if (received <= 0) {
+                    break;
+                }
+                for (int i = 0; i < received; i++) {
+                    decode(m_buffers[i], messages[i].msg_len);
+                }
+                count += received;
+                if (received < VectorCount) {
+                    break;
+                }
+            }
+            return count;
+        }
+
+        void decode(const uint8_t* data, size_t size) {
+            const auto now = std::chrono::steady_clock::now();
+            osc::decodePacket(data, size, [&](const osc::Message& message) { m_listenerState.update(message, now); });
+        }
+
+        const int m_socket;
+        const Mode m_mode;
+
+        uint8_t m_buffers[VectorCount][DatagramSize];
+        osc::GazeState m_listenerState;
+
+        std::mutex m_stateMutex;
+        osc::GazeState m_publishedState;
+    };
+
+    std::optional<Measurement> measure(Mode mode, double rate, double seconds) {
+        const int receiver = socket(AF_INET, SOCK_DGRAM, 0);
+        const int sender = socket(AF_INET, SOCK_DGRAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t addressSize = sizeof(address);
+        const timeval timeout{0, ReceiveTimeoutMs * 1000};
+        if (receiver < 0 || sender < 0 || bind(receiver, (const sockaddr*)&address, sizeof(address)) ||
+            getsockname(receiver, (sockaddr*)&address, &addressSize) ||
+            setsockopt(receiver, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) ||
+            setsockopt(receiver, SOL_SOCKET, SO_RCVBUF, &ReceiveBufferSize, sizeof(ReceiveBufferSize))) {
+            close(receiver);
+            close(sender);
+            return {};
+        }
+
+        Measurement measurement;
+        std::atomic<bool> stop{false};
+        auto listener = std::make_unique<Listener>(receiver, mode);
+        std::thread listenerThread([&] { listener->run(stop, measurement); });
+
+        const auto start = std::chrono::steady_clock::now();
+        measurement.sent = generate(sender, address, rate, seconds, stop);
+        measurement.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        // Let the listener catch up.
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        stop = true;
+        listenerThread.join();
+        close(receiver);
+        close(sender);
+        return measurement;
+    }
+
+    int runScaling(double seconds) {
+        printf("%10s  %-14s %10s %10s %10s %12s\n", "Rate", "Listener", "Received", "Per wakeup", "CPU", "CPU/packet");
+        for (const double rate : Rates) {
+            for (const Mode mode : {Mode::PerDatagram, Mode::Batched}) {
+                const std::optional<Measurement> measurement = measure(mode, rate, seconds);
+                if (!measurement) {
+                    fprintf(stderr, "Cannot open the loopback sockets\n");
+                    return EXIT_FAILURE;
+                }
+                const Measurement& m = measurement.value();
+                printf("%10.0f  %-14s %9.1f%% %10.1f %9.2f%% %10.2fus\n",
+                       rate,
+                       mode == Mode::Batched ? "recvmmsg" : "per datagram",
+                       m.sent ? 100.0 * m.received / m.sent : 0.0,
+                       m.wakeups ? (double)m.received / m.wakeups : 0.0,
+                       100.0 * m.cpuNs / (m.seconds * 1e9),
+                       m.received ? m.cpuNs / 1000.0 / m.received : 0.0);
+            }
+        }
+        return EXIT_SUCCESS;
+    }
+
+    int runGenerator(const char* host, int port, double rate, double seconds) {
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons((uint16_t)port);
+        if (inet_pton(AF_INET, host, &address.sin_addr) != 1 || port <= 0 || port > 65535 || rate <= 0.0) {
+            fprintf(stderr, "Invalid destination or rate\n");
+            return EXIT_FAILURE;
+        }
+        const int sender = socket(AF_INET, SOCK_DGRAM, 0);
+        if (sender < 0) {
+            return EXIT_FAILURE;
+        }
+        std::atomic<bool> stop{false};
+        const uint64_t sent = generate(sender, address, rate, seconds, stop);
+        close(sender);
+        printf("Sent %llu packets to %s:%d\n", (unsigned long long)sent, host, port);
+        return EXIT_SUCCESS;
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc >= 5 && argc <= 6 && std::string_view(argv[1]) == "send") {
+        return runGenerator(argv[2], atoi(argv[3]), atof(argv[4]), argc > 5 ? atof(argv[5]) : 60.0);
+    }
+
+    const double seconds = argc == 2 ? atof(argv[1]) : DefaultSeconds;
+    if (argc > 2 || seconds <= 0.0) {
+        fprintf(stderr,
+                "Usage: %s [seconds-per-rate]\n"
+                "       %s send <ipv4-address> <port> <packets-per-second> [seconds]\n",
+                argv[0],
+                argv[0]);
+        return EXIT_FAILURE;
+    }
+    return runScaling(seconds);
+}
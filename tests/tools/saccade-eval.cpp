@@ -0,0 +1,77 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Offline evaluation of the saccade detector on the traces of a capture (see eye_tracker_compare).
+//
+// Usage:
+//   saccade-eval <capture.csv>
+//       Run the detector over both traces of the capture, and report the landing errors with and without prediction.
+//   saccade-eval --synthetic <capture.csv>
+//       Write the synthetic capture of tests/data: 50 saccades queried at 90Hz from a 120Hz tracker (A) and from a 30Hz
+//       tracker (B), both with 0.15deg of noise.
+
+#include "pch.h"
+
+#include <trackers.h>
+
+#include "comparison.h"
+#include "saccade.h"
+#include "synthetic_gaze.h"
+
+using namespace openxr_api_layer;
+using namespace pvremu_tests;
+
+int main(int argc, char** argv) {
+    if (argc == 3 && std::string_view(argv[1]) == "--synthetic") {
+        const SyntheticGaze gaze(1, 50);
+        std::vector<GazeComparisonRecord> records;
+        gaze.sampleTracker(records, 0, 90.0, 120.0, 0.15f, 2);
+        gaze.sampleTracker(records, 1, 90.0, 30.0, 0.15f, 3);
+        const std::string names[2] = {"Synthetic 120Hz tracker", "Synthetic 30Hz tracker"};
+        if (!writeGazeCapture(argv[2], names, records)) {
+            fprintf(stderr, "Cannot write %s\n", argv[2]);
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s <capture.csv> | --synthetic <capture.csv>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::string names[2];
+    std::vector<GazeComparisonRecord> records;
+    if (!readGazeCapture(argv[1], names, records)) {
+        fprintf(stderr, "Cannot read %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+    for (size_t trace = 0; trace < 2; trace++) {
+        if (std::none_of(records.cbegin(), records.cend(), [&](const auto& record) { return record.isValid[trace]; })) {
+            continue;
+        }
+        printf("%s:\n%s", names[trace].c_str(), formatSaccadeEvaluation(evaluateSaccadeDetector(records, trace)).c_str());
+    }
+
+    return EXIT_SUCCESS;
+}
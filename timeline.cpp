@@ -0,0 +1,135 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "log.h"
+using namespace openxr_api_layer::log;
+
+#include "timeline.h"
+
+namespace openxr_api_layer {
+
+    const char* getFoveationPhaseName(FoveationPhase phase) {
+        switch (phase) {
+        case FoveationPhase::Attach:
+            return "DllMain";
+        case FoveationPhase::GetInterface:
+            return "getPvrInterface";
+        case FoveationPhase::Initialise:
+            return "initialise";
+        case FoveationPhase::TrackerSelected:
+            return "tracker selected";
+        case FoveationPhase::CreateHmd:
+            return "createHmd";
+        case FoveationPhase::FoveationActive:
+            return "foveation active";
+        case FoveationPhase::FirstValidGaze:
+            return "first valid gaze";
+        default:
+            return "unknown";
+        }
+    }
+
+    void FoveationTimeline::mark(FoveationPhase phase) {
+        std::atomic<int64_t>& time = m_times[(size_t)phase];
+        if (time.load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        int64_t expected = 0;
+        if (!time.compare_exchange_strong(expected, std::chrono::steady_clock::now().time_since_epoch().count())) {
+            return;
+        }
+
+        if (isComplete()) {
+            report(true);
+        }
+    }
+
+    std::optional<std::chrono::milliseconds> FoveationTimeline::getTimeTo(FoveationPhase phase) const {
+        const int64_t attach = m_times[(size_t)FoveationPhase::Attach].load();
+        const int64_t time = m_times[(size_t)phase].load();
+        if (!attach || !time) {
+            return {};
+        }
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::duration(time - attach));
+    }
+
+    bool FoveationTimeline::isComplete() const {
+        return m_times[(size_t)FoveationPhase::FoveationActive].load() &&
+               m_times[(size_t)FoveationPhase::FirstValidGaze].load();
+    }
+
+    void FoveationTimeline::reportIncomplete() {
+        if (!isComplete()) {
+            report(false);
+        }
+    }
+
+    void FoveationTimeline::report(bool isComplete) {
+        if (m_isReported.exchange(true)) {
+            return;
+        }
+
+        int64_t timeTo[(size_t)FoveationPhase::Count];
+        std::vector<std::pair<std::chrono::milliseconds, FoveationPhase>> reached;
+        for (size_t i = 0; i < (size_t)FoveationPhase::Count; i++) {
+            const auto phase = (FoveationPhase)i;
+            const auto time = getTimeTo(phase);
+            timeTo[i] = time ? time->count() : -1;
+            if (time && phase != FoveationPhase::Attach) {
+                reached.push_back({time.value(), phase});
+            }
+        }
+
+        // Break down the total by phase, each phase being relative to the previous one. The gaze may very well come
+        // before foveation is activated, so go by time rather than by the usual order.
+        std::stable_sort(
+            reached.begin(), reached.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+        std::string breakdown;
+        std::chrono::milliseconds previous{0};
+        for (const auto& [time, phase] : reached) {
+            breakdown += fmt::format(
+                "{}{}: +{}ms", breakdown.empty() ? "" : ", ", getFoveationPhaseName(phase), (time - previous).count());
+            previous = time;
+        }
+
+        TraceLoggingWrite(g_traceProvider,
+                          "TimeToFoveation",
+                          TLArg(isComplete, "Complete"),
+                          TLArg(timeTo[(size_t)FoveationPhase::GetInterface], "GetInterfaceMs"),
+                          TLArg(timeTo[(size_t)FoveationPhase::Initialise], "InitialiseMs"),
+                          TLArg(timeTo[(size_t)FoveationPhase::TrackerSelected], "TrackerSelectedMs"),
+                          TLArg(timeTo[(size_t)FoveationPhase::CreateHmd], "CreateHmdMs"),
+                          TLArg(timeTo[(size_t)FoveationPhase::FoveationActive], "FoveationActiveMs"),
+                          TLArg(timeTo[(size_t)FoveationPhase::FirstValidGaze], "FirstValidGazeMs"));
+        if (isComplete) {
+            Log(fmt::format("Time to foveation: {}ms ({})\n", previous.count(), breakdown));
+        } else {
+            Log(fmt::format("Foveation never used the gaze, phases reached: {}\n",
+                            !breakdown.empty() ? breakdown : "none"));
+        }
+    }
+
+} // namespace openxr_api_layer
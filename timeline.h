@@ -0,0 +1,66 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+namespace openxr_api_layer {
+
+    // The milestones between the injection of the DLL and foveation actually following the gaze, in the order they
+    // normally happen.
+    enum class FoveationPhase {
+        Attach,
+        GetInterface,
+        Initialise,
+        TrackerSelected,
+        CreateHmd,
+        FoveationActive,
+        FirstValidGaze,
+
+        Count
+    };
+
+    const char* getFoveationPhaseName(FoveationPhase phase);
+
+    // Records when each phase is first reached, and reports the time to foveation once foveation is active and the
+    // first valid gaze sample was received. Marking a phase that was already reached is a single atomic load, so it
+    // can be done from the render thread on every frame.
+    class FoveationTimeline {
+      public:
+        void mark(FoveationPhase phase);
+
+        // Time from the attach to the phase, if it was reached.
+        std::optional<std::chrono::milliseconds> getTimeTo(FoveationPhase phase) const;
+        bool isComplete() const;
+
+        // Report the phases reached so far, when the session ends before foveation could use the gaze (eg: there is
+        // no eye tracker).
+        void reportIncomplete();
+
+      private:
+        void report(bool isComplete);
+
+        // In steady_clock ticks, 0 until the phase is reached.
+        std::atomic<int64_t> m_times[(size_t)FoveationPhase::Count]{};
+        std::atomic<bool> m_isReported{false};
+    };
+
+} // namespace openxr_api_layer
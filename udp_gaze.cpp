@@ -0,0 +1,300 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "pch.h"
+
+#include "log.h"
+using namespace openxr_api_layer::log;
+
+#include <trackers.h>
+#include <pvremu_gaze_udp.h>
+
+#include "eye_tracker.h"
+#include "shared_memory.h"
+#include "udp_gaze.h"
+
+namespace openxr_api_layer {
+
+    namespace {
+
+        // Senders stop sending when the user takes the headset off, do not keep using the last gaze forever.
+        constexpr auto MaxSampleAge = std::chrono::milliseconds(500);
+
+        // Capture timestamps this far in the future are from another machine, whose clock we do not know.
+        constexpr auto MaxClockSkew = std::chrono::milliseconds(5);
+
+        // How often the listener thread checks whether it must exit.
+        constexpr long ReceiveTimeoutMs = 100;
+
+        // Upper bound of datagrams drained before publishing, so that a flood cannot starve the render thread.
+        constexpr int MaxBatchSize = 256;
+
+        // A sequence number going back further than this means that the sender restarted.
+        constexpr uint32_t SenderResetThreshold = 1024;
+
+        class UdpGazeEyeTracker : public LocalEyeTracker {
+          public:
+            UdpGazeEyeTracker(SOCKET socket, uint16_t port, const std::string& multicastGroup)
+                : m_socket(socket), m_port(port), m_multicastGroup(multicastGroup) {
+                m_listenerThread = std::thread([&]() { listenerThread(); });
+            }
+
+            ~UdpGazeEyeTracker() override {
+                m_stopListener = true;
+                closesocket(m_socket);
+                m_listenerThread.join();
+                WSACleanup();
+            }
+
+            void start(XrSession session) override {
+            }
+
+            void stop() override {
+            }
+
+            std::string getName() const override {
+                if (m_multicastGroup.empty()) {
+                    return fmt::format("UDP gaze (port {})", m_port);
+                }
+                return fmt::format("UDP gaze ({}:{})", m_multicastGroup, m_port);
+            }
+
+            bool getGazeSample(EyeGazeSample& sample) override {
+                pvremu::GazeSample packetSample;
+                std::chrono::steady_clock::time_point arrival;
+                {
+                    std::unique_lock lock(m_stateMutex);
+                    if (!m_hasSample) {
+                        return false;
+                    }
+                    packetSample = m_publishedSample;
+                    arrival = m_publishedArrival;
+                }
+
+                // The capture time is only meaningful if the sender shares our clock (same machine).
+                const auto capture = std::chrono::steady_clock::time_point(
+                    std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                        std::chrono::nanoseconds(packetSample.timestampNs)));
+                const auto time =
+                    capture > arrival - MaxSampleAge && capture < arrival + MaxClockSkew ? std::min(capture, arrival)
+                                                                                         : arrival;
+                if (std::chrono::steady_clock::now() - time >= MaxSampleAge) {
+                    return false;
+                }
+
+                if (!combineGazeSample(packetSample, sample)) {
+                    return false;
+                }
+                sample.time = time;
+                return true;
+            }
+
+          private:
+            enum Dropped { Malformed, Duplicate, OutOfOrder, DroppedCount };
+
+            // Returns the number of datagrams received, or -1 on error.
+            int drainSocket() {
+                int count = 0;
+                bool hasNewSample = false;
+                while (count < MaxBatchSize) {
+                    uint8_t buffer[pvremu::GazePacketSize + 1];
+                    sockaddr_in from{};
+                    int fromLength = sizeof(from);
+                    const int received = recvfrom(m_socket,
+                                                  reinterpret_cast<char*>(buffer),
+                                                  (int)sizeof(buffer),
+                                                  0,
+                                                  reinterpret_cast<sockaddr*>(&from),
+                                                  &fromLength);
+                    if (received < 0) {
+                        const int error = WSAGetLastError();
+                        if (error == WSAEWOULDBLOCK) {
+                            break;
+                        }
+                        // Oversized datagrams and ICMP errors from a previous send do not affect the next ones.
+                        if (error == WSAEMSGSIZE) {
+                            m_droppedCount[Malformed]++;
+                            continue;
+                        }
+                        if (error == WSAECONNRESET) {
+                            continue;
+                        }
+                        return -1;
+                    }
+                    count++;
+
+                    pvremu::GazeSample sample;
+                    uint32_t sequence;
+                    if (!pvremu::decodeGazePacket(buffer, received, sample, sequence)) {
+                        m_droppedCount[Malformed]++;
+                        continue;
+                    }
+
+                    // Only the newest packet of a sender is of interest. Another sender takes over from the previous
+                    // one.
+                    const bool isSameSender =
+                        m_hasSender && from.sin_addr.s_addr == m_senderAddress && from.sin_port == m_senderPort;
+                    if (isSameSender && !pvremu::isGazeSequenceNewer(sequence, m_lastSequence) &&
+                        m_lastSequence - sequence < SenderResetThreshold) {
+                        m_droppedCount[sequence == m_lastSequence ? Duplicate : OutOfOrder]++;
+                        continue;
+                    }
+                    m_hasSender = true;
+                    m_senderAddress = from.sin_addr.s_addr;
+                    m_senderPort = from.sin_port;
+                    m_lastSequence = sequence;
+
+                    m_listenerSample = sample;
+                    hasNewSample = true;
+                }
+
+                if (hasNewSample) {
+                    const auto now = std::chrono::steady_clock::now();
+                    std::unique_lock lock(m_stateMutex);
+                    m_publishedSample = m_listenerSample;
+                    m_publishedArrival = now;
+                    m_hasSample = true;
+                }
+                return count;
+            }
+
+            void listenerThread() {
+                TraceLocalActivity(local);
+
+                TraceLoggingWriteStart(local,
+                                       "UdpGazeEyeTracker_Listener",
+                                       TLArg(m_port, "Port"),
+                                       TLArg(m_multicastGroup.c_str(), "MulticastGroup"));
+
+                uint64_t packetCount = 0;
+                while (!m_stopListener) {
+                    // Sleep until at least one datagram is pending, then take everything that is queued.
+                    fd_set readSet;
+                    FD_ZERO(&readSet);
+                    FD_SET(m_socket, &readSet);
+                    timeval timeout{0, ReceiveTimeoutMs * 1000};
+                    const int ready = select(0, &readSet, nullptr, nullptr, &timeout);
+
+                    const int count = ready > 0 ? drainSocket() : ready;
+                    if (count >= 0) {
+                        packetCount += count;
+                    } else if (!m_stopListener) {
+                        Log("UDP gaze receive error: %d\n", WSAGetLastError());
+                        std::this_thread::sleep_for(std::chrono::milliseconds(ReceiveTimeoutMs));
+                    }
+                }
+
+                Log(fmt::format("UDP gaze received {} packets, dropped {} malformed, {} duplicate, {} out-of-order\n",
+                                packetCount,
+                                m_droppedCount[Malformed],
+                                m_droppedCount[Duplicate],
+                                m_droppedCount[OutOfOrder]));
+
+                TraceLoggingWriteStop(local,
+                                      "UdpGazeEyeTracker_Listener",
+                                      TLArg(packetCount, "PacketCount"),
+                                      TLArg(m_droppedCount[Malformed], "Malformed"),
+                                      TLArg(m_droppedCount[Duplicate], "Duplicate"),
+                                      TLArg(m_droppedCount[OutOfOrder], "OutOfOrder"));
+            }
+
+            const SOCKET m_socket;
+            const uint16_t m_port;
+            const std::string m_multicastGroup;
+
+            // Only accessed by the listener thread.
+            pvremu::GazeSample m_listenerSample{};
+            bool m_hasSender{false};
+            uint32_t m_senderAddress{0};
+            uint16_t m_senderPort{0};
+            uint32_t m_lastSequence{0};
+            uint64_t m_droppedCount[DroppedCount]{};
+
+            // Newest sample after each batch.
+            std::mutex m_stateMutex;
+            pvremu::GazeSample m_publishedSample{};
+            std::chrono::steady_clock::time_point m_publishedArrival{};
+            bool m_hasSample{false};
+
+            std::thread m_listenerThread;
+            std::atomic<bool> m_stopListener{false};
+        };
+
+    } // namespace
+
+    std::unique_ptr<IEyeTracker> createUdpGazeEyeTracker(uint16_t port, const std::string& multicastGroup) {
+        WSADATA wsaData;
+        if (WSAStartup(MAKEWORD(2, 2), &wsaData)) {
+            return nullptr;
+        }
+
+        const SOCKET sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (sock == INVALID_SOCKET) {
+            WSACleanup();
+            return nullptr;
+        }
+
+        const auto fail = [&](const char* step) -> std::unique_ptr<IEyeTracker> {
+            Log("Failed to %s for UDP gaze on port %u: %d\n", step, port, WSAGetLastError());
+            closesocket(sock);
+            WSACleanup();
+            return nullptr;
+        };
+
+        // Every process with PvrEmu injected binds the same port to receive the multicast packets.
+        const BOOL reuseAddress = TRUE;
+        if (setsockopt(
+                sock, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuseAddress), sizeof(reuseAddress))) {
+            return fail("share the port");
+        }
+
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        address.sin_port = htons(port);
+        if (bind(sock, reinterpret_cast<const sockaddr*>(&address), sizeof(address))) {
+            return fail("listen");
+        }
+
+        if (!multicastGroup.empty()) {
+            ip_mreq membership{};
+            membership.imr_interface.s_addr = htonl(INADDR_ANY);
+            if (inet_pton(AF_INET, multicastGroup.c_str(), &membership.imr_multiaddr) != 1 ||
+                setsockopt(sock,
+                           IPPROTO_IP,
+                           IP_ADD_MEMBERSHIP,
+                           reinterpret_cast<const char*>(&membership),
+                           sizeof(membership))) {
+                return fail(fmt::format("join {}", multicastGroup).c_str());
+            }
+        }
+
+        u_long nonBlocking = 1;
+        if (ioctlsocket(sock, FIONBIO, &nonBlocking)) {
+            return fail("configure the socket");
+        }
+
+        return std::make_unique<UdpGazeEyeTracker>(sock, port, multicastGroup);
+    }
+
+} // namespace openxr_api_layer